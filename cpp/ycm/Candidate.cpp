@@ -16,10 +16,34 @@
 // along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Candidate.h"
+#include "QueryOptions.h"
+#include "QueryStatistics.h"
 #include "Result.h"
 
 namespace YouCompleteMe {
 
+namespace {
+
+inline bool IsAsciiUppercase( char byte ) {
+  return 'A' <= byte && byte <= 'Z';
+}
+
+} // unnamed namespace
+
+void Candidate::ComputeAsciiBases() {
+  ascii_bases_.reserve( Length() );
+  cased_ascii_bases_.reserve( Length() );
+  for ( const auto &character : Characters() ) {
+    char base = static_cast< char >( character->AsciiBase() );
+    ascii_bases_.push_back( base );
+    if ( 'a' <= base && base <= 'z' && character->IsUppercase() ) {
+      base = static_cast< char >( base - 'a' + 'A' );
+    }
+    cased_ascii_bases_.push_back( base );
+  }
+}
+
+
 void Candidate::ComputeCaseSwappedText() {
   for ( const auto &character : Characters() ) {
     case_swapped_text_.append( character->SwappedCase() );
@@ -69,13 +93,17 @@ void Candidate::ComputeTextIsLowercase() {
 
 Candidate::Candidate( std::string&& text )
   : Word( std::move( text ) ) {
+  ComputeAsciiBases();
   ComputeCaseSwappedText();
   ComputeWordBoundaryChars();
   ComputeTextIsLowercase();
 }
 
 
-Result Candidate::QueryMatchResult( const Word &query ) const {
+template< typename CharactersMatch >
+Result Candidate::QueryMatchResult( const Word &query,
+                                    bool set_features,
+                                    CharactersMatch characters_match ) const {
   // Check if the query is a subsequence of the candidate and return a result
   // accordingly. This is done by simultaneously going through the characters of
   // the query and the candidate. If both characters match, we move to the next
@@ -88,6 +116,35 @@ Result Candidate::QueryMatchResult( const Word &query ) const {
   // candidate where characters matched, and a boolean that is true if the query
   // is a prefix of the candidate.
 
+  size_t query_index = 0;
+  size_t index_sum = 0;
+  size_t query_length = query.Length();
+  size_t candidate_length = Length();
+
+  for ( size_t candidate_index = 0; candidate_index < candidate_length;
+        ++candidate_index ) {
+    if ( characters_match( query_index, candidate_index ) ) {
+      index_sum += candidate_index;
+
+      if ( query_index + 1 == query_length ) {
+        return Result( this,
+                       &query,
+                       index_sum,
+                       candidate_index == query_index,
+                       set_features );
+      }
+
+      ++query_index;
+    }
+  }
+
+  return Result();
+}
+
+
+
+Result Candidate::QueryMatchResult( const Word &query,
+                                    bool set_features ) const {
   if ( query.IsEmpty() ) {
     return Result( this, &query, 0, false );
   }
@@ -96,38 +153,118 @@ Result Candidate::QueryMatchResult( const Word &query ) const {
     return Result();
   }
 
-  size_t query_index = 0;
-  size_t candidate_index = 0;
-  size_t index_sum = 0;
+  // Select the matching predicate once for the whole query so that the
+  // per-character comparison is inlined in the loop. For ASCII queries, it
+  // reduces to byte comparisons against the ASCII bases of the candidate
+  // characters, which is equivalent to Character::MatchesSmart:
+  //  - a lowercase (or non-letter) character matches any character with the
+  //    same base or folded case;
+  //  - an uppercase letter matches uppercase characters with the same base.
+  switch ( query.GetCharacterClass() ) {
+    case CharacterClass::LOWERCASE_ASCII: {
+      const char *query_text = query.Text().data();
+      const char *bases = ascii_bases_.data();
+      return QueryMatchResult(
+        query,
+        set_features,
+        [ query_text, bases ]( size_t query_index, size_t candidate_index ) {
+          return query_text[ query_index ] == bases[ candidate_index ];
+        } );
+    }
+    case CharacterClass::ASCII: {
+      const char *query_text = query.Text().data();
+      const char *bases = ascii_bases_.data();
+      const char *cased_bases = cased_ascii_bases_.data();
+      return QueryMatchResult(
+        query,
+        set_features,
+        [ query_text, bases, cased_bases ]( size_t query_index,
+                                            size_t candidate_index ) {
+          char query_character = query_text[ query_index ];
+          const char *candidate_bases =
+            IsAsciiUppercase( query_character ) ? cased_bases : bases;
+          return query_character == candidate_bases[ candidate_index ];
+        } );
+    }
+    default: {
+      const CharacterSequence &query_characters = query.Characters();
+      const CharacterSequence &candidate_characters = Characters();
+      return QueryMatchResult(
+        query,
+        set_features,
+        [ &query_characters, &candidate_characters ](
+            size_t query_index, size_t candidate_index ) {
+          return query_characters[ query_index ]->MatchesSmart(
+                   *candidate_characters[ candidate_index ] );
+        } );
+    }
+  }
+}
 
-  const CharacterSequence &query_characters = query.Characters();
-  const CharacterSequence &candidate_characters = Characters();
 
-  auto query_character_pos = query_characters.begin();
-  auto candidate_character_pos = candidate_characters.begin();
+Result Candidate::FilteredQueryMatchResult(
+  const Word &query,
+  const QueryOptions &options,
+  bool set_features,
+  QueryStatistics *statistics ) const {
+  if ( statistics ) {
+    ++statistics->num_visited_candidates;
+  }
+  if ( IsEmpty() || !options.Accepts( *this, query ) ||
+       !ContainsBytes( query ) ) {
+    if ( statistics ) {
+      ++statistics->num_prefilter_rejections;
+    }
+    return Result();
+  }
 
-  for ( ; candidate_character_pos != candidate_characters.end();
-          ++candidate_character_pos, ++candidate_index ) {
+  Result result = QueryMatchResult( query, set_features );
+  if ( statistics ) {
+    if ( result.IsSubsequence() ) {
+      ++statistics->num_matches;
+    } else {
+      ++statistics->num_subsequence_failures;
+    }
+  }
+  return result;
+}
 
-    const auto &candidate_character = *candidate_character_pos;
-    const auto &query_character = *query_character_pos;
 
-    if ( query_character->MatchesSmart( *candidate_character ) ) {
-      index_sum += candidate_index;
+MatchPositions Candidate::QueryMatchPositions( const Word &query ) const {
+  const CharacterSequence &query_characters = query.Characters();
+  const CharacterSequence &candidate_characters = Characters();
 
-      ++query_character_pos;
-      if ( query_character_pos == query_characters.end() ) {
-        return Result( this,
-                       &query,
-                       index_sum,
-                       candidate_index == query_index );
-      }
+  std::vector< size_t > matched_indexes;
+  for ( size_t candidate_index = 0;
+        candidate_index < candidate_characters.size() &&
+        matched_indexes.size() < query_characters.size();
+        ++candidate_index ) {
+    if ( query_characters[ matched_indexes.size() ]->MatchesSmart(
+           *candidate_characters[ candidate_index ] ) ) {
+      matched_indexes.push_back( candidate_index );
+    }
+  }
 
-      ++query_index;
+  MatchPositions positions;
+  if ( matched_indexes.size() < query_characters.size() ) {
+    return positions;
+  }
+
+  const std::string &text = Text();
+  std::vector< size_t > character_offsets = CharacterByteOffsets();
+  size_t byte_offset = 0;
+  size_t code_point_offset = 0;
+  for ( auto index : matched_indexes ) {
+    for ( ; byte_offset < character_offsets[ index ]; ++byte_offset ) {
+      if ( ( static_cast< uint8_t >( text[ byte_offset ] ) & 0xc0 ) != 0x80 ) {
+        ++code_point_offset;
+      }
     }
+    positions.byte_offsets.push_back( byte_offset );
+    positions.code_point_offsets.push_back( code_point_offset );
   }
 
-  return Result();
+  return positions;
 }
 
 } // namespace YouCompleteMe
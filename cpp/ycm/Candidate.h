@@ -26,6 +26,15 @@
 namespace YouCompleteMe {
 
 class Result;
+struct QueryOptions;
+struct QueryStatistics;
+
+// Positions in the candidate text of the characters matched by a query, as
+// offsets in bytes and in code points.
+struct MatchPositions {
+  std::vector< size_t > byte_offsets;
+  std::vector< size_t > code_point_offsets;
+};
 
 class Candidate : public Word {
 public:
@@ -50,13 +59,42 @@ public:
     return text_is_lowercase_;
   }
 
-  YCM_EXPORT Result QueryMatchResult( const Word &query ) const;
+  // When |set_features| is false, the ranking features of a matching result
+  // must be set afterwards with Result::SetResultFeaturesFromQuery. This lets
+  // callers time the two steps separately.
+  YCM_EXPORT Result QueryMatchResult( const Word &query,
+                                      bool set_features = true ) const;
+
+  // Same as QueryMatchResult but the empty candidates, the ones discarded by
+  // |options| and the ones not containing the bytes of the query are rejected
+  // before matching. The outcome is counted in |statistics| if not null.
+  YCM_EXPORT Result FilteredQueryMatchResult(
+    const Word &query,
+    const QueryOptions &options,
+    bool set_features = true,
+    QueryStatistics *statistics = nullptr ) const;
+
+  // Returns the positions of the characters matched by the query in the same
+  // way as QueryMatchResult or empty positions if the query doesn't match.
+  // This is slower than QueryMatchResult and meant for the few results that
+  // are displayed.
+  YCM_EXPORT MatchPositions QueryMatchPositions( const Word &query ) const;
 
 private:
+  void ComputeAsciiBases();
   void ComputeCaseSwappedText();
   void ComputeTextIsLowercase();
   void ComputeWordBoundaryChars();
 
+  template< typename CharactersMatch >
+  Result QueryMatchResult( const Word &query,
+                           bool set_features,
+                           CharactersMatch characters_match ) const;
+
+  // ASCII bases of the characters (see Character::AsciiBase). In the cased
+  // version, the bases of uppercase letters are uppercase.
+  std::string ascii_bases_;
+  std::string cased_ascii_bases_;
   std::string case_swapped_text_;
   CharacterSequence word_boundary_chars_;
   bool text_is_lowercase_;
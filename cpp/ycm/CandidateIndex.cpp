@@ -0,0 +1,276 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CandidateIndex.h"
+#include "Candidate.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace YouCompleteMe {
+
+namespace {
+
+// Below this length, the posting lists are too long for the intersection to be
+// faster than a full scan.
+const size_t MIN_QUERY_LENGTH = 3;
+
+// Don't bother rebuilding small indexes.
+const size_t MIN_REMOVED_CANDIDATES_BEFORE_REBUILD = 1024;
+
+
+// Reduces a character to 8 bits. A query character matches a candidate one
+// only if they have the same ASCII base (see Character::AsciiBase). All other
+// characters share the NON_ASCII_BASE key.
+uint8_t CharacterKey( const Character &character ) {
+  return character.AsciiBase();
+}
+
+
+uint16_t PairKey( uint8_t first, uint8_t second ) {
+  return static_cast< uint16_t >( first << 8 | second );
+}
+
+
+class VarintDecoder {
+public:
+  explicit VarintDecoder( const std::string &bytes )
+    : position_( bytes.data() ),
+      end_( bytes.data() + bytes.size() ),
+      id_( 0 ) {
+  }
+
+  inline bool Next( uint32_t &id ) {
+    if ( position_ == end_ ) {
+      return false;
+    }
+    uint32_t delta = 0;
+    for ( int shift = 0; ; shift += 7 ) {
+      auto byte = static_cast< uint8_t >( *position_++ );
+      delta |= static_cast< uint32_t >( byte & 0x7f ) << shift;
+      if ( !( byte & 0x80 ) ) {
+        break;
+      }
+    }
+    id_ += delta;
+    id = id_;
+    return true;
+  }
+
+private:
+  const char *position_;
+  const char *end_;
+  uint32_t id_;
+};
+
+} // unnamed namespace
+
+
+void CandidateIndex::PostingList::Append( uint32_t id ) {
+  // The first id is stored as a delta from 0.
+  uint32_t delta = id - last_id_;
+  while ( delta >= 0x80 ) {
+    bytes_.push_back( static_cast< char >( ( delta & 0x7f ) | 0x80 ) );
+    delta >>= 7;
+  }
+  bytes_.push_back( static_cast< char >( delta ) );
+  last_id_ = id;
+  ++size_;
+}
+
+
+void CandidateIndex::PostingList::IntersectWith(
+  std::vector< uint32_t > &ids ) const {
+  VarintDecoder decoder( bytes_ );
+  uint32_t id;
+  auto kept = ids.begin();
+  auto current = ids.begin();
+
+  while ( current != ids.end() && decoder.Next( id ) ) {
+    while ( current != ids.end() && *current < id ) {
+      ++current;
+    }
+    if ( current != ids.end() && *current == id ) {
+      *kept++ = *current++;
+    }
+  }
+
+  ids.erase( kept, ids.end() );
+}
+
+
+std::vector< uint32_t > CandidateIndex::PostingList::Decode() const {
+  std::vector< uint32_t > ids;
+  ids.reserve( size_ );
+  VarintDecoder decoder( bytes_ );
+  uint32_t id;
+  while ( decoder.Next( id ) ) {
+    ids.push_back( id );
+  }
+  return ids;
+}
+
+
+void CandidateIndex::AddCandidate( const Candidate *candidate ) {
+  auto [ it, inserted ] = entries_.try_emplace( candidate, Entry{ 0, 0 } );
+  Entry &entry = it->second;
+  ++entry.count;
+
+  if ( !inserted ) {
+    return;
+  }
+
+  entry.id = static_cast< uint32_t >( candidates_.size() );
+  candidates_.push_back( candidate );
+  IndexCandidate( candidate, entry.id );
+}
+
+
+void CandidateIndex::RemoveCandidate( const Candidate *candidate ) {
+  auto it = entries_.find( candidate );
+  if ( it == entries_.end() ) {
+    return;
+  }
+
+  if ( --it->second.count > 0 ) {
+    return;
+  }
+
+  candidates_[ it->second.id ] = nullptr;
+  entries_.erase( it );
+  ++num_removed_;
+
+  if ( num_removed_ >= MIN_REMOVED_CANDIDATES_BEFORE_REBUILD &&
+       num_removed_ > entries_.size() ) {
+    Rebuild();
+  }
+}
+
+
+size_t CandidateIndex::NumCandidates() const {
+  return entries_.size();
+}
+
+
+bool CandidateIndex::CandidatesForQuery(
+  const Word &query,
+  std::vector< const Candidate * > &candidates ) const {
+  if ( query.Length() < MIN_QUERY_LENGTH ) {
+    return false;
+  }
+
+  const CharacterSequence &query_characters = query.Characters();
+  // A query character with a non-ASCII base may match candidate characters
+  // with different keys so the index can't be used.
+  if ( std::any_of( query_characters.begin(), query_characters.end(),
+                    []( const Character *character ) {
+                      return CharacterKey( *character ) == NON_ASCII_BASE;
+                    } ) ) {
+    return false;
+  }
+
+  std::vector< uint16_t > keys;
+  keys.reserve( query_characters.size() - 1 );
+  for ( size_t i = 1; i < query_characters.size(); ++i ) {
+    keys.push_back( PairKey( CharacterKey( *query_characters[ i - 1 ] ),
+                             CharacterKey( *query_characters[ i ] ) ) );
+  }
+  std::sort( keys.begin(), keys.end() );
+  keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+
+  std::vector< const PostingList * > posting_lists;
+  posting_lists.reserve( keys.size() );
+  for ( auto key : keys ) {
+    auto it = posting_lists_.find( key );
+    if ( it == posting_lists_.end() ) {
+      // No candidate contains this pair.
+      return true;
+    }
+    posting_lists.push_back( &it->second );
+  }
+
+  // Start from the shortest list so that the intermediate result is as small
+  // as possible.
+  std::sort( posting_lists.begin(), posting_lists.end(),
+             []( const PostingList *left, const PostingList *right ) {
+               return left->Size() < right->Size();
+             } );
+
+  std::vector< uint32_t > ids = posting_lists.front()->Decode();
+  for ( auto it = posting_lists.begin() + 1;
+        it != posting_lists.end() && !ids.empty(); ++it ) {
+    ( *it )->IntersectWith( ids );
+  }
+
+  candidates.reserve( candidates.size() + ids.size() );
+  for ( auto id : ids ) {
+    if ( const Candidate *candidate = candidates_[ id ] ) {
+      candidates.push_back( candidate );
+    }
+  }
+
+  return true;
+}
+
+
+void CandidateIndex::IndexCandidate( const Candidate *candidate,
+                                     uint32_t id ) {
+  const CharacterSequence &characters = candidate->Characters();
+  std::vector< uint8_t > character_keys;
+  character_keys.reserve( characters.size() );
+  for ( const auto &character : characters ) {
+    character_keys.push_back( CharacterKey( *character ) );
+  }
+
+  std::vector< uint16_t > keys;
+  keys.reserve( character_keys.size() * character_keys.size() / 2 );
+  for ( size_t i = 0; i < character_keys.size(); ++i ) {
+    for ( size_t j = i + 1; j < character_keys.size(); ++j ) {
+      keys.push_back( PairKey( character_keys[ i ], character_keys[ j ] ) );
+    }
+  }
+  std::sort( keys.begin(), keys.end() );
+  keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+
+  for ( auto key : keys ) {
+    posting_lists_[ key ].Append( id );
+  }
+}
+
+
+void CandidateIndex::Rebuild() {
+  std::vector< const Candidate * > candidates;
+  candidates.reserve( entries_.size() );
+  std::copy_if( candidates_.begin(), candidates_.end(),
+                std::back_inserter( candidates ),
+                []( const Candidate *candidate ) {
+                  return candidate != nullptr;
+                } );
+
+  posting_lists_.clear();
+  candidates_.clear();
+  num_removed_ = 0;
+
+  for ( const Candidate *candidate : candidates ) {
+    Entry &entry = entries_[ candidate ];
+    entry.id = static_cast< uint32_t >( candidates_.size() );
+    candidates_.push_back( candidate );
+    IndexCandidate( candidate, entry.id );
+  }
+}
+
+} // namespace YouCompleteMe
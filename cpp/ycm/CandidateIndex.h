@@ -0,0 +1,109 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CANDIDATEINDEX_H_R2VGK8QW
+#define CANDIDATEINDEX_H_R2VGK8QW
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace YouCompleteMe {
+
+class Candidate;
+class Word;
+
+
+// Inverted index from pairs of characters to the candidates containing them,
+// used to avoid scanning every candidate of a filetype for long queries.
+//
+// A candidate is indexed under every ordered pair of its characters, not only
+// adjacent ones (a "gapped" pair), with characters reduced to their
+// case-folded ASCII base. Since a query must be a subsequence of the candidate
+// to match, every pair of consecutive query characters is necessarily such a
+// pair in the candidate. Intersecting the posting lists of these pairs thus
+// gives a small superset of the matching candidates; exact matching must still
+// be done on the returned candidates.
+//
+// Posting lists are sorted lists of candidate ids stored as delta-encoded
+// variable-length integers. Ids are assigned in increasing order so that
+// adding a candidate only appends to the lists. Removed candidates are
+// tombstoned and the index is rebuilt when they outnumber the live ones.
+//
+// This class is not thread-safe.
+class CandidateIndex {
+public:
+  CandidateIndex() = default;
+  CandidateIndex( const CandidateIndex& ) = delete;
+  CandidateIndex& operator=( const CandidateIndex& ) = delete;
+
+  // Candidates are reference-counted: a candidate added N times must be
+  // removed N times before it is dropped from the index.
+  YCM_EXPORT void AddCandidate( const Candidate *candidate );
+
+  YCM_EXPORT void RemoveCandidate( const Candidate *candidate );
+
+  YCM_EXPORT size_t NumCandidates() const;
+
+  // Returns false if the query is too short for the index to be useful or
+  // contains characters with a non-ASCII base, in which case all candidates
+  // must be scanned. Otherwise, fills |candidates| with a superset of the
+  // candidates that may match the query.
+  YCM_EXPORT bool CandidatesForQuery(
+    const Word &query,
+    std::vector< const Candidate * > &candidates ) const;
+
+private:
+  class PostingList {
+  public:
+    void Append( uint32_t id );
+
+    inline size_t Size() const {
+      return size_;
+    }
+
+    // Keeps only the ids of |ids| that are in this list.
+    void IntersectWith( std::vector< uint32_t > &ids ) const;
+
+    std::vector< uint32_t > Decode() const;
+
+  private:
+    std::string bytes_;
+    uint32_t last_id_ = 0;
+    size_t size_ = 0;
+  };
+
+  struct Entry {
+    uint32_t id;
+    size_t count;
+  };
+
+  void IndexCandidate( const Candidate *candidate, uint32_t id );
+
+  void Rebuild();
+
+  std::unordered_map< uint16_t, PostingList > posting_lists_;
+  std::unordered_map< const Candidate *, Entry > entries_;
+  // Candidate for each id; nullptr if the candidate was removed.
+  std::vector< const Candidate * > candidates_;
+  size_t num_removed_ = 0;
+};
+
+} // namespace YouCompleteMe
+
+#endif /* end of include guard: CANDIDATEINDEX_H_R2VGK8QW */
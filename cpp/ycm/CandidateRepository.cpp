@@ -16,8 +16,12 @@
 // along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "CandidateRepository.h"
+#include "ThreadPool.h"
 #include "Utils.h"
 
+#include <algorithm>
+#include <future>
+
 #ifdef USE_CLANG_COMPLETER
 #  include "ClangCompleter/CompletionData.h"
 #endif // USE_CLANG_COMPLETER
@@ -30,6 +34,76 @@ namespace {
 // entering the database. Such large candidates are almost never desirable.
 const size_t MAX_CANDIDATE_SIZE = 80;
 
+// Below this number of candidates per task, scheduling a task costs more than
+// it saves.
+const size_t MIN_CANDIDATES_PER_TASK = 512;
+
+
+std::string_view CandidateText( std::string_view text ) {
+  return text.size() > MAX_CANDIDATE_SIZE ? std::string_view() : text;
+}
+
+
+std::string TakeCandidateText( std::string_view text ) {
+  return std::string( CandidateText( text ) );
+}
+
+
+// Moves the text out of |text| instead of copying it.
+std::string TakeCandidateText( std::string &text ) {
+  return text.size() > MAX_CANDIDATE_SIZE ? std::string() : std::move( text );
+}
+
+
+void BuildCandidates( std::vector< std::string >::iterator text_begin,
+                      std::vector< std::string >::iterator text_end,
+                      std::vector< std::unique_ptr< Candidate > >::iterator
+                        candidate_begin ) {
+  for ( auto text_pos = text_begin; text_pos != text_end; ++text_pos ) {
+    *candidate_begin++ =
+      std::make_unique< Candidate >( std::move( *text_pos ) );
+  }
+}
+
+
+// Builds the candidates for |texts|, splitting the work across the thread pool
+// if there are enough of them.
+std::vector< std::unique_ptr< Candidate > > BuildCandidates(
+  std::vector< std::string >&& texts ) {
+  std::vector< std::unique_ptr< Candidate > > candidates( texts.size() );
+
+  // The calling thread runs the tasks no worker started yet while waiting.
+  size_t num_tasks = std::min( ThreadPool::Instance().NumThreads() + 1,
+                               texts.size() / MIN_CANDIDATES_PER_TASK );
+  if ( num_tasks <= 1 ) {
+    BuildCandidates( texts.begin(), texts.end(), candidates.begin() );
+    return candidates;
+  }
+
+  // Building a candidate may throw on invalid UTF-8. Futures forward the
+  // exception to the caller.
+  TaskGroup tasks;
+  std::vector< std::future< void > > futures;
+  size_t chunk_size = ( texts.size() + num_tasks - 1 ) / num_tasks;
+  for ( size_t start = 0; start < texts.size(); start += chunk_size ) {
+    auto text_begin = texts.begin() + static_cast< std::ptrdiff_t >( start );
+    auto text_end = texts.begin() + static_cast< std::ptrdiff_t >(
+      std::min( start + chunk_size, texts.size() ) );
+    auto candidate_begin = candidates.begin() +
+                           static_cast< std::ptrdiff_t >( start );
+    futures.push_back( tasks.Submit( [ text_begin, text_end, candidate_begin ] {
+      BuildCandidates( text_begin, text_end, candidate_begin );
+    } ) );
+  }
+
+  tasks.Wait();
+  for ( auto &future : futures ) {
+    future.get();
+  }
+
+  return candidates;
+}
+
 }  // unnamed namespace
 
 
@@ -45,36 +119,93 @@ size_t CandidateRepository::NumStoredCandidates() const {
 }
 
 
-std::vector< const Candidate * > CandidateRepository::GetCandidatesForStrings(
-  std::vector< std::string >&& strings ) {
-  std::vector< const Candidate * > candidates;
-  candidates.reserve( strings.size() );
+template< typename Strings >
+std::vector< const Candidate * >
+CandidateRepository::GetCandidatesForStringsImpl( Strings &strings ) {
+  std::vector< const Candidate * > candidates( strings.size(), nullptr );
 
+  // First, look up the existing candidates. Readers are not blocked.
+  std::vector< size_t > missing_positions;
   {
-    std::lock_guard locker( candidate_holder_mutex_ );
-
-    for ( auto&& candidate_text : strings ) {
-      if ( candidate_text.size() > MAX_CANDIDATE_SIZE ) {
-        candidate_text = "";
+    std::shared_lock locker( candidate_holder_mutex_ );
+
+    for ( size_t i = 0; i < strings.size(); ++i ) {
+      auto it = candidate_holder_.find( CandidateText( strings[ i ] ) );
+      if ( it != candidate_holder_.end() ) {
+        candidates[ i ] = it->second.get();
+      } else {
+        missing_positions.push_back( i );
       }
+    }
+  }
 
-      std::unique_ptr< Candidate > &candidate = GetValueElseInsert(
-                                                  candidate_holder_,
-                                                  candidate_text,
-                                                  nullptr );
+  if ( missing_positions.empty() ) {
+    return candidates;
+  }
 
-      if ( !candidate ) {
-        candidate = std::make_unique< Candidate >( std::move( candidate_text ) );
+  // Then, build the missing candidates without holding the lock. The same
+  // string may be requested several times.
+  std::vector< size_t > missing_indexes;
+  missing_indexes.reserve( missing_positions.size() );
+  std::vector< size_t > new_text_positions;
+  {
+    std::unordered_map< std::string_view, size_t > new_text_indexes;
+    for ( auto position : missing_positions ) {
+      auto [ it, inserted ] = new_text_indexes.emplace(
+        CandidateText( strings[ position ] ), new_text_positions.size() );
+      if ( inserted ) {
+        new_text_positions.push_back( position );
       }
+      missing_indexes.push_back( it->second );
+    }
+  }
+
+  // The texts are moved out of |strings| if they are std::strings. Only the
+  // indexes computed above are used from now on.
+  std::vector< std::string > new_texts;
+  new_texts.reserve( new_text_positions.size() );
+  for ( auto position : new_text_positions ) {
+    new_texts.push_back( TakeCandidateText( strings[ position ] ) );
+  }
+
+  std::vector< std::unique_ptr< Candidate > > new_candidates =
+    BuildCandidates( std::move( new_texts ) );
+
+  // Finally, publish them. Another thread may have added some of them in the
+  // meantime, in which case the stored ones are kept.
+  std::vector< const Candidate * > stored_candidates;
+  stored_candidates.reserve( new_candidates.size() );
+  {
+    std::lock_guard locker( candidate_holder_mutex_ );
 
-      candidates.push_back( candidate.get() );
+    for ( auto &candidate : new_candidates ) {
+      std::string_view key = candidate->Text();
+      auto it = candidate_holder_.emplace( key, std::move( candidate ) ).first;
+      stored_candidates.push_back( it->second.get() );
     }
   }
 
+  for ( size_t i = 0; i < missing_positions.size(); ++i ) {
+    candidates[ missing_positions[ i ] ] =
+      stored_candidates[ missing_indexes[ i ] ];
+  }
+
   return candidates;
 }
 
 
+std::vector< const Candidate * > CandidateRepository::GetCandidatesForStrings(
+  std::vector< std::string >&& strings ) {
+  return GetCandidatesForStringsImpl( strings );
+}
+
+
+std::vector< const Candidate * > CandidateRepository::GetCandidatesForStrings(
+  const std::vector< std::string_view > &strings ) {
+  return GetCandidatesForStringsImpl( strings );
+}
+
+
 void CandidateRepository::ClearCandidates() {
   candidate_holder_.clear();
 }
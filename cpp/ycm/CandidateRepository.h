@@ -23,18 +23,21 @@
 #include <memory>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 namespace YouCompleteMe {
 
-using CandidateHolder = std::unordered_map< std::string,
+// Keys are views on the text of the candidate they map to.
+using CandidateHolder = std::unordered_map< std::string_view,
                                             std::unique_ptr< Candidate > >;
 
 
 // This singleton stores already built Candidate objects for candidate strings
 // that were already seen. If Candidates are requested for previously unseen
-// strings, new Candidate objects are built.
+// strings, new Candidate objects are built. Building is done without holding
+// the lock and in parallel when there are many new strings.
 //
 // This is shared by the identifier completer and the clang completer so that
 // work is not repeated.
@@ -47,11 +50,16 @@ public:
   CandidateRepository( const CandidateRepository& ) = delete;
   CandidateRepository& operator=( const CandidateRepository& ) = delete;
 
-  size_t NumStoredCandidates() const;
+  YCM_EXPORT size_t NumStoredCandidates() const;
 
   YCM_EXPORT std::vector< const Candidate * > GetCandidatesForStrings(
     std::vector< std::string >&& strings );
 
+  // Same as above but only copies the strings for which a new Candidate is
+  // built.
+  YCM_EXPORT std::vector< const Candidate * > GetCandidatesForStrings(
+    const std::vector< std::string_view > &strings );
+
   // This should only be used to isolate tests and benchmarks.
   YCM_EXPORT void ClearCandidates();
 
@@ -59,6 +67,10 @@ private:
   CandidateRepository() = default;
   ~CandidateRepository() = default;
 
+  template< typename Strings >
+  std::vector< const Candidate * > GetCandidatesForStringsImpl(
+    Strings &strings );
+
   // This data structure owns all the Candidate pointers
   CandidateHolder candidate_holder_;
   mutable std::shared_mutex candidate_holder_mutex_;
@@ -78,7 +78,8 @@ CodePointSequence CanonicalDecompose( std::string_view text ) {
 } // unnamed namespace
 
 Character::Character( std::string_view character )
-  : is_base_( true ),
+  : ascii_base_( NON_ASCII_BASE ),
+    is_base_( true ),
     is_letter_( false ),
     is_punctuation_( false ),
     is_uppercase_( false ) {
@@ -104,6 +105,12 @@ Character::Character( std::string_view character )
         base_.append( code_point->FoldedCase() );
     }
   }
+
+  if ( IsAsciiByte( base_ ) ) {
+    ascii_base_ = static_cast< uint8_t >( base_[ 0 ] );
+  } else if ( IsAsciiByte( folded_case_ ) ) {
+    ascii_base_ = static_cast< uint8_t >( folded_case_[ 0 ] );
+  }
 }
 
 } // namespace YouCompleteMe
@@ -18,12 +18,16 @@
 #ifndef CHARACTER_H_YTIET2HZ
 #define CHARACTER_H_YTIET2HZ
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
 
 namespace YouCompleteMe {
 
+// Value returned by Character::AsciiBase for characters without an ASCII base.
+const uint8_t NON_ASCII_BASE = 0x80;
+
 // This class represents a UTF-8 character. It takes a UTF-8 encoded string
 // corresponding to a grapheme cluster (see
 // https://www.unicode.org/glossary/#grapheme_cluster), normalize it through NFD
@@ -56,6 +60,19 @@ public:
     return swapped_case_;
   }
 
+  // Returns the case-folded base (or the folded case if the base is not ASCII)
+  // as a single byte. A character matches an ASCII query character if and only
+  // if that byte is equal to the query one (see MatchesSmart), modulo the case
+  // rules for uppercase query characters.
+  inline uint8_t AsciiBase() const {
+    return ascii_base_;
+  }
+
+  // Whether the character is a single ASCII byte.
+  inline bool IsAscii() const {
+    return IsAsciiByte( normal_ );
+  }
+
   inline bool IsBase() const {
     return is_base_;
   }
@@ -97,10 +114,15 @@ public:
   }
 
 private:
+  static bool IsAsciiByte( std::string_view text ) {
+    return text.size() == 1 && static_cast< uint8_t >( text[ 0 ] ) < 0x80;
+  }
+
   std::string normal_;
   std::string base_;
   std::string folded_case_;
   std::string swapped_case_;
+  uint8_t ascii_base_;
   bool is_base_;
   bool is_letter_;
   bool is_punctuation_;
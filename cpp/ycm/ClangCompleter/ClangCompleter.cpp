@@ -20,18 +20,81 @@
 #include "CandidateRepository.h"
 #include "ClangUtils.h"
 #include "CompletionData.h"
+#include "LatencyHistogram.h"
 #include "Result.h"
+#include "ThreadPool.h"
 #include "TranslationUnit.h"
 #include "Utils.h"
 
+#include <algorithm>
 #include <clang-c/Index.h>
 #include <memory>
+#include <string_view>
 
 
 using std::shared_ptr;
 
 namespace YouCompleteMe {
 
+namespace {
+
+// Hash of what the results of a completion request depend on. The text typed
+// on |line| of |filename| from |column| is left out since it's the query.
+size_t HashForCompletionRequest(
+  const std::string &filename,
+  int line,
+  int column,
+  const std::vector< UnsavedFile > &unsaved_files,
+  const std::vector< std::string > &flags ) {
+  // Same algorithm as HashForFlags in TranslationUnitStore.
+  size_t seed = 0;
+  auto combine = [ &seed ]( std::string_view text ) {
+    seed ^= std::hash< std::string_view >()( text ) +
+            ( seed << 6 ) + ( seed >> 2 );
+  };
+
+  for ( const auto &flag : flags ) {
+    combine( flag );
+  }
+
+  for ( const auto &unsaved_file : unsaved_files ) {
+    combine( unsaved_file.filename_ );
+    std::string_view contents( unsaved_file.contents_ );
+    contents = contents.substr( 0, unsaved_file.length_ );
+    if ( unsaved_file.filename_ != filename ) {
+      combine( contents );
+      continue;
+    }
+
+    size_t line_start = 0;
+    for ( int i = 1; i < line && line_start != std::string_view::npos; ++i ) {
+      line_start = contents.find( '\n', line_start );
+      if ( line_start != std::string_view::npos ) {
+        ++line_start;
+      }
+    }
+    line_start = std::min( line_start, contents.size() );
+    size_t query_start = std::min( line_start + std::max( column - 1, 0 ),
+                                   contents.size() );
+    size_t line_end = std::min( contents.find( '\n', query_start ),
+                                contents.size() );
+    combine( contents.substr( 0, query_start ) );
+    combine( contents.substr( line_end ) );
+  }
+
+  return seed;
+}
+
+
+template< typename T >
+bool IsReady( const std::shared_future< T > &future ) {
+  return future.wait_for( std::chrono::seconds( 0 ) ) ==
+         std::future_status::ready;
+}
+
+} // unnamed namespace
+
+
 ClangCompleter::ClangCompleter()
   : clang_index_( clang_createIndex( 0, 0 ) ),
     translation_unit_store_( clang_index_ ) {
@@ -39,10 +102,26 @@ ClangCompleter::ClangCompleter()
   // I'm pretty sure it's turned on by default, but I'm not going to take any
   // chances.
   clang_toggleCrashRecovery( true );
+
+  translation_unit_store_.SetEvictionCallback(
+    [ this ]( const std::string &translation_unit ) {
+      DropCachedCompletions( translation_unit );
+    } );
 }
 
 
 ClangCompleter::~ClangCompleter() {
+  // Updates on the thread pool use this object. Queued ones are discarded if
+  // the pool is shut down, which also makes their future ready.
+  std::vector< std::shared_future< std::vector< Diagnostic > > > updates;
+  {
+    std::lock_guard< std::mutex > lock( async_updates_mutex_ );
+    updates.swap( async_updates_ );
+  }
+  for ( const auto &update : updates ) {
+    update.wait();
+  }
+
   // We need to destroy all TUs before calling clang_disposeIndex because
   // the translation units need to be destroyed before the index is destroyed.
   // Technically, a thread could still be holding onto a shared_ptr<TU> object
@@ -55,8 +134,12 @@ ClangCompleter::~ClangCompleter() {
 }
 
 
-bool ClangCompleter::UpdatingTranslationUnit( const std::string &filename ) {
-  shared_ptr< TranslationUnit > unit = translation_unit_store_.Get( filename );
+bool ClangCompleter::UpdatingTranslationUnit( const std::string &filename,
+                                              int timeout_ms ) {
+  shared_ptr< TranslationUnit > unit = translation_unit_store_.Get(
+    filename,
+    std::chrono::steady_clock::now() +
+      std::chrono::milliseconds( timeout_ms ) );
 
   if ( !unit ) {
     return false;
@@ -73,6 +156,10 @@ std::vector< Diagnostic > ClangCompleter::UpdateTranslationUnit(
   const std::string &translation_unit,
   const std::vector< UnsavedFile > &unsaved_files,
   const std::vector< std::string > &flags ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "ClangCompleter::UpdateTranslationUnit" );
+  ScopedLatencyTimer timer( latency );
+  DropCachedCompletions( translation_unit );
   bool translation_unit_created;
   shared_ptr< TranslationUnit > unit = translation_unit_store_.GetOrCreate(
                                          translation_unit,
@@ -92,6 +179,77 @@ std::vector< Diagnostic > ClangCompleter::UpdateTranslationUnit(
 }
 
 
+DiagnosticsDelta ClangCompleter::UpdateTranslationUnitDelta(
+  const std::string &translation_unit,
+  const std::vector< UnsavedFile > &unsaved_files,
+  const std::vector< std::string > &flags,
+  size_t generation ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "ClangCompleter::UpdateTranslationUnitDelta" );
+  ScopedLatencyTimer timer( latency );
+  DropCachedCompletions( translation_unit );
+  bool translation_unit_created;
+  shared_ptr< TranslationUnit > unit = translation_unit_store_.GetOrCreate(
+                                         translation_unit,
+                                         unsaved_files,
+                                         flags,
+                                         translation_unit_created );
+
+  try {
+    return unit->Reparse( unsaved_files, generation );
+  } catch ( const ClangParseError & ) {
+    translation_unit_store_.Remove( translation_unit );
+    throw;
+  }
+}
+
+
+DiagnosticsFuture ClangCompleter::UpdateTranslationUnitAsync(
+  const std::string &translation_unit,
+  const std::vector< UnsavedFile > &unsaved_files,
+  const std::vector< std::string > &flags ) {
+  // Also dropped when the update runs.
+  DropCachedCompletions( translation_unit );
+  std::lock_guard< std::mutex > lock( async_updates_mutex_ );
+  shared_ptr< QueuedUpdate > &queued_update =
+    queued_updates_[ translation_unit ];
+  // The future of a queued update is only ready if the thread pool discarded
+  // it.
+  if ( queued_update && !IsReady( queued_update->diagnostics ) ) {
+    queued_update->unsaved_files = unsaved_files;
+    queued_update->flags = flags;
+    return DiagnosticsFuture( queued_update->diagnostics );
+  }
+
+  queued_update = std::make_shared< QueuedUpdate >();
+  queued_update->unsaved_files = unsaved_files;
+  queued_update->flags = flags;
+  // The task can't take the update before we release the lock.
+  queued_update->diagnostics = ThreadPool::Instance().Submit(
+    [ this, translation_unit ] {
+      shared_ptr< QueuedUpdate > update;
+      {
+        std::lock_guard< std::mutex > lock( async_updates_mutex_ );
+        auto it = queued_updates_.find( translation_unit );
+        update = std::move( it->second );
+        queued_updates_.erase( it );
+      }
+      return UpdateTranslationUnit( translation_unit,
+                                    update->unsaved_files,
+                                    update->flags );
+    } ).share();
+
+  async_updates_.erase(
+    std::remove_if( async_updates_.begin(),
+                    async_updates_.end(),
+                    IsReady< std::vector< Diagnostic > > ),
+    async_updates_.end() );
+  async_updates_.push_back( queued_update->diagnostics );
+
+  return DiagnosticsFuture( queued_update->diagnostics );
+}
+
+
 std::vector< CompletionData >
 ClangCompleter::CandidatesForLocationInFile(
   const std::string &translation_unit,
@@ -100,6 +258,9 @@ ClangCompleter::CandidatesForLocationInFile(
   int column,
   const std::vector< UnsavedFile > &unsaved_files,
   const std::vector< std::string > &flags ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "ClangCompleter::CandidatesForLocationInFile" );
+  ScopedLatencyTimer timer( latency );
   shared_ptr< TranslationUnit > unit =
     translation_unit_store_.GetOrCreate( translation_unit,
                                          unsaved_files,
@@ -112,6 +273,68 @@ ClangCompleter::CandidatesForLocationInFile(
 }
 
 
+std::vector< CompletionData >
+ClangCompleter::CandidatesForLocationInFile(
+  const std::string &translation_unit,
+  const std::string &filename,
+  int line,
+  int column,
+  const std::vector< UnsavedFile > &unsaved_files,
+  const std::vector< std::string > &flags,
+  std::string query,
+  size_t max_candidates,
+  size_t &num_completions ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "ClangCompleter::FilteredCandidatesForLocationInFile" );
+  ScopedLatencyTimer timer( latency );
+  size_t request_hash = HashForCompletionRequest( filename,
+                                                  line,
+                                                  column,
+                                                  unsaved_files,
+                                                  flags );
+
+  shared_ptr< const CompletionResults > results;
+  size_t cached_completions_generation;
+  {
+    std::lock_guard< std::mutex > lock( cached_completions_mutex_ );
+    cached_completions_generation = cached_completions_generation_;
+    auto cached = cached_completions_.find( translation_unit );
+    if ( cached != cached_completions_.end() &&
+         cached->second.filename == filename &&
+         cached->second.line == line &&
+         cached->second.column == column &&
+         cached->second.request_hash == request_hash ) {
+      results = cached->second.results;
+    }
+  }
+
+  if ( !results ) {
+    shared_ptr< TranslationUnit > unit =
+      translation_unit_store_.GetOrCreate( translation_unit,
+                                           unsaved_files,
+                                           flags );
+    results = std::make_shared< CompletionResults >(
+      unit->CodeCompleteResultsForLocation( filename,
+                                            line,
+                                            column,
+                                            unsaved_files ) );
+
+    // No completions may come from a TU being created. The TU may also have
+    // been updated meanwhile.
+    if ( results->NumCompletions() ) {
+      std::lock_guard< std::mutex > lock( cached_completions_mutex_ );
+      if ( cached_completions_generation == cached_completions_generation_ ) {
+        cached_completions_[ translation_unit ] =
+          { filename, line, column, request_hash, results };
+      }
+    }
+  }
+
+  num_completions = results->NumCompletions();
+  return results->FilterAndSort( std::move( query ), max_candidates );
+}
+
+
 Location ClangCompleter::GetDeclarationLocation(
   const std::string &translation_unit,
   const std::string &filename,
@@ -120,6 +343,9 @@ Location ClangCompleter::GetDeclarationLocation(
   const std::vector< UnsavedFile > &unsaved_files,
   const std::vector< std::string > &flags,
   bool reparse ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "ClangCompleter::GetDeclarationLocation" );
+  ScopedLatencyTimer timer( latency );
   shared_ptr< TranslationUnit > unit =
     translation_unit_store_.GetOrCreate( translation_unit,
                                          unsaved_files,
@@ -141,6 +367,9 @@ Location ClangCompleter::GetDefinitionLocation(
   const std::vector< UnsavedFile > &unsaved_files,
   const std::vector< std::string > &flags,
   bool reparse ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "ClangCompleter::GetDefinitionLocation" );
+  ScopedLatencyTimer timer( latency );
   shared_ptr< TranslationUnit > unit =
     translation_unit_store_.GetOrCreate( translation_unit,
                                          unsaved_files,
@@ -161,6 +390,9 @@ Location ClangCompleter::GetDefinitionOrDeclarationLocation(
   const std::vector< UnsavedFile > &unsaved_files,
   const std::vector< std::string > &flags,
   bool reparse ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "ClangCompleter::GetDefinitionOrDeclarationLocation" );
+  ScopedLatencyTimer timer( latency );
   shared_ptr< TranslationUnit > unit =
     translation_unit_store_.GetOrCreate( translation_unit,
                                          unsaved_files,
@@ -278,6 +510,49 @@ DocumentationData ClangCompleter::GetDocsForLocationInFile(
 
 void ClangCompleter::DeleteCachesForFile( const std::string &filename ) {
   translation_unit_store_.Remove( filename );
+  DropCachedCompletions( filename );
+}
+
+
+void ClangCompleter::SetTranslationUnitMemoryBudget( size_t memory_budget ) {
+  translation_unit_store_.SetMemoryBudget( memory_budget );
+}
+
+
+void ClangCompleter::SetPinnedTranslationUnits(
+  const std::vector< std::string > &filenames ) {
+  translation_unit_store_.SetPinnedFiles( filenames );
+}
+
+
+void ClangCompleter::SetDoubleBufferedTranslationUnits( bool double_buffered ) {
+  translation_unit_store_.SetDoubleBuffered( double_buffered );
+}
+
+
+void ClangCompleter::SetMaxDiagnostics( size_t max_diagnostics ) {
+  translation_unit_store_.SetMaxDiagnostics( max_diagnostics );
+}
+
+
+void ClangCompleter::SetTranslationUnitCacheDirectory(
+  const std::string &directory,
+  size_t max_size ) {
+  translation_unit_store_.SetCacheDirectory( directory, max_size );
+}
+
+
+void ClangCompleter::DropCachedCompletions(
+  const std::string &translation_unit ) {
+  // Destroyed after releasing the lock.
+  shared_ptr< const CompletionResults > results;
+  std::lock_guard< std::mutex > lock( cached_completions_mutex_ );
+  ++cached_completions_generation_;
+  auto cached = cached_completions_.find( translation_unit );
+  if ( cached != cached_completions_.end() ) {
+    results = std::move( cached->second.results );
+    cached_completions_.erase( cached );
+  }
 }
 
 
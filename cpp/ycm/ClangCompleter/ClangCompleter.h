@@ -18,12 +18,18 @@
 #ifndef CLANGCOMPLETE_H_WLKDU0ZV
 #define CLANGCOMPLETE_H_WLKDU0ZV
 
+#include "CompletionResults.h"
 #include "Diagnostic.h"
 #include "Documentation.h"
 #include "TranslationUnitStore.h"
 #include "UnsavedFile.h"
 
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 using CXTranslationUnit = CXTranslationUnitImpl*;
 
@@ -36,6 +42,36 @@ struct Location;
 using CompletionDatas = std::vector< CompletionData >;
 
 
+// Diagnostics of a translation unit update running in the background.
+class DiagnosticsFuture {
+public:
+  explicit DiagnosticsFuture(
+    std::shared_future< std::vector< Diagnostic > > diagnostics )
+    : diagnostics_( std::move( diagnostics ) ) {
+  }
+
+  // Whether Get() would return without blocking.
+  bool IsReady() const {
+    return WaitFor( 0 );
+  }
+
+  // Blocks for at most |timeout_ms| milliseconds. Returns IsReady().
+  bool WaitFor( int timeout_ms ) const {
+    return diagnostics_.wait_for( std::chrono::milliseconds( timeout_ms ) ) ==
+           std::future_status::ready;
+  }
+
+  // Blocks until the update is done. Rethrows the exception of a failed
+  // update, e.g. ClangParseError.
+  std::vector< Diagnostic > Get() const {
+    return diagnostics_.get();
+  }
+
+private:
+  std::shared_future< std::vector< Diagnostic > > diagnostics_;
+};
+
+
 // All filename parameters must be absolute paths.
 class ClangCompleter {
 public:
@@ -44,13 +80,33 @@ public:
   ClangCompleter( const ClangCompleter& ) = delete;
   ClangCompleter& operator=( const ClangCompleter& ) = delete;
 
-  bool UpdatingTranslationUnit( const std::string &filename );
+  // If the TU of |filename| is being created, waits at most |timeout_ms|
+  // milliseconds for it before checking.
+  YCM_EXPORT bool UpdatingTranslationUnit( const std::string &filename,
+                                           int timeout_ms = 0 );
 
   YCM_EXPORT std::vector< Diagnostic > UpdateTranslationUnit(
     const std::string &translation_unit,
     const std::vector< UnsavedFile > &unsaved_files,
     const std::vector< std::string > &flags );
 
+  // Same as UpdateTranslationUnit but only returns the diagnostics that
+  // changed since |generation|, the generation_ of a previous delta.
+  YCM_EXPORT DiagnosticsDelta UpdateTranslationUnitDelta(
+    const std::string &translation_unit,
+    const std::vector< UnsavedFile > &unsaved_files,
+    const std::vector< std::string > &flags,
+    size_t generation );
+
+  // Same as UpdateTranslationUnit but parses on the thread pool and returns
+  // immediately. If an update of the same translation unit is still queued,
+  // its files and flags are replaced by the given ones and its future is
+  // returned: only the latest contents get parsed.
+  YCM_EXPORT DiagnosticsFuture UpdateTranslationUnitAsync(
+    const std::string &translation_unit,
+    const std::vector< UnsavedFile > &unsaved_files,
+    const std::vector< std::string > &flags );
+
   YCM_EXPORT std::vector< CompletionData > CandidatesForLocationInFile(
     const std::string &translation_unit,
     const std::string &filename,
@@ -59,6 +115,23 @@ public:
     const std::vector< UnsavedFile > &unsaved_files,
     const std::vector< std::string > &flags );
 
+  // Same as above but only returns the |max_candidates| completions best
+  // matching |query|, sorted, or all the matching ones if |max_candidates| is
+  // 0. Only the CompletionData of these completions are built.
+  // |num_completions| is set to the number of completions before filtering.
+  // The completions of the last location of each translation unit are cached
+  // so that typing the query doesn't complete again.
+  YCM_EXPORT std::vector< CompletionData > CandidatesForLocationInFile(
+    const std::string &translation_unit,
+    const std::string &filename,
+    int line,
+    int column,
+    const std::vector< UnsavedFile > &unsaved_files,
+    const std::vector< std::string > &flags,
+    std::string query,
+    size_t max_candidates,
+    size_t &num_completions );
+
   YCM_EXPORT Location GetDeclarationLocation(
     const std::string &translation_unit,
     const std::string &filename,
@@ -124,7 +197,39 @@ public:
 
   void DeleteCachesForFile( const std::string &filename );
 
+  // See TranslationUnitStore::SetMemoryBudget.
+  void SetTranslationUnitMemoryBudget( size_t memory_budget );
+
+  // See TranslationUnitStore::SetPinnedFiles.
+  void SetPinnedTranslationUnits( const std::vector< std::string > &filenames );
+
+  // See TranslationUnitStore::SetDoubleBuffered.
+  void SetDoubleBufferedTranslationUnits( bool double_buffered );
+
+  // See TranslationUnitStore::SetMaxDiagnostics.
+  void SetMaxDiagnostics( size_t max_diagnostics );
+
+  // See TranslationUnitStore::SetCacheDirectory.
+  void SetTranslationUnitCacheDirectory( const std::string &directory,
+                                         size_t max_size );
+
 private:
+  struct CachedCompletions {
+    std::string filename;
+    int line;
+    int column;
+    size_t request_hash;
+    std::shared_ptr< const CompletionResults > results;
+  };
+
+  // The completions depend on the state of the TU.
+  void DropCachedCompletions( const std::string &translation_unit );
+
+  struct QueuedUpdate {
+    std::vector< UnsavedFile > unsaved_files;
+    std::vector< std::string > flags;
+    std::shared_future< std::vector< Diagnostic > > diagnostics;
+  };
 
   /////////////////////////////
   // PRIVATE MEMBER VARIABLES
@@ -133,6 +238,21 @@ private:
   CXIndex clang_index_;
 
   TranslationUnitStore translation_unit_store_;
+
+  // translation unit -> completions at its last completed location. Dropped
+  // when the TU is updated or evicted.
+  std::unordered_map< std::string, CachedCompletions > cached_completions_;
+  // Incremented when completions are dropped.
+  size_t cached_completions_generation_ = 0;
+  std::mutex cached_completions_mutex_;
+
+  // translation unit -> update not started yet
+  std::unordered_map< std::string,
+                      std::shared_ptr< QueuedUpdate > > queued_updates_;
+  // Updates that may still be running; waited for on destruction.
+  std::vector< std::shared_future< std::vector< Diagnostic > > >
+    async_updates_;
+  std::mutex async_updates_mutex_;
 };
 
 } // namespace YouCompleteMe
@@ -129,15 +129,6 @@ void BuildFullDiagnosticDataFromChildren(
   }
 }
 
-// Returns true when the provided completion string is available to the user;
-// unavailable completion strings refer to entities that are private/protected,
-// deprecated etc.
-bool CompletionStringAvailable( CXCompletionString completion_string ) {
-  return clang_getCompletionAvailability( completion_string ) ==
-         CXAvailability_Available;
-}
-
-
 std::vector< Range > GetRanges( const DiagnosticWrap &diagnostic_wrap ) {
   std::vector< Range > ranges;
   size_t num_ranges = clang_getDiagnosticNumRanges( diagnostic_wrap.get() );
@@ -204,43 +195,51 @@ std::vector< CXUnsavedFile > ToCXUnsavedFiles(
 }
 
 
+bool CompletionStringAvailable( CXCompletionString completion_string ) {
+  return clang_getCompletionAvailability( completion_string ) ==
+         CXAvailability_Available;
+}
+
+
 std::vector< CompletionData > ToCompletionDataVector(
-  CXCodeCompleteResults *results ) {
+  const CodeCompleteResultsWrap &results ) {
   std::vector< CompletionData > completions;
 
   if ( !results || !results->Results ) {
     return completions;
   }
 
-  completions.reserve( results->NumResults );
+  // If we see the same completion several times, then the other ones are
+  // overloads of a function we have seen. Their signatures are added to the
+  // detailed information of the first one.
+  std::vector< std::vector< size_t > > result_indices;
+  std::vector< std::string > texts;
   unordered_map< std::string, size_t > seen_data;
 
   for ( size_t i = 0; i < results->NumResults; ++i ) {
-    CXCompletionResult result = results->Results[ i ];
-    CXCompletionString completion_string = result.CompletionString;
+    CXCompletionString completion_string =
+      results->Results[ i ].CompletionString;
 
     if ( !completion_string ||
          !CompletionStringAvailable( completion_string ) ) {
       continue;
     }
 
-    CompletionData data( completion_string, result.CursorKind, results, i );
-    size_t index = GetValueElseInsert( seen_data,
-                                       data.original_string_,
-                                       completions.size() );
-
-    if ( index == completions.size() ) {
-      completions.push_back( std::move( data ) );
-    } else {
-      // If we have already seen this completion, then this is an overload of a
-      // function we have seen. We add the signature of the overload to the
-      // detailed information.
-      completions[ index ].detailed_info_
-      .append( data.return_type_ )
-      .append( " " )
-      .append( data.everything_except_return_type_ )
-      .append( "\n" );
+    std::string text = TextToInsertInBuffer( completion_string );
+    size_t index = GetValueElseInsert( seen_data, text, texts.size() );
+
+    if ( index == texts.size() ) {
+      result_indices.emplace_back();
+      texts.push_back( std::move( text ) );
     }
+    result_indices[ index ].push_back( i );
+  }
+
+  completions.reserve( texts.size() );
+  for ( size_t i = 0; i < texts.size(); ++i ) {
+    completions.emplace_back( results,
+                              std::move( result_indices[ i ] ),
+                              std::move( texts[ i ] ) );
   }
 
   return completions;
@@ -248,7 +247,8 @@ std::vector< CompletionData > ToCompletionDataVector(
 
 
 Diagnostic BuildDiagnostic( const DiagnosticWrap &diagnostic_wrap,
-                            CXTranslationUnit translation_unit ) {
+                            CXTranslationUnit translation_unit,
+                            bool full ) {
   Diagnostic diagnostic;
 
   if ( !diagnostic_wrap ) {
@@ -267,12 +267,18 @@ Diagnostic BuildDiagnostic( const DiagnosticWrap &diagnostic_wrap,
   CXSourceLocation source_location =
     clang_getDiagnosticLocation( diagnostic_wrap.get() );
   diagnostic.location_ = Location( source_location );
-  diagnostic.location_extent_ = GetLocationExtent( source_location,
-                                                   translation_unit );
   diagnostic.ranges_ = GetRanges( diagnostic_wrap );
   diagnostic.text_ = CXStringToString(
                        clang_getDiagnosticSpelling( diagnostic_wrap.get() ) );
 
+  if ( !full ) {
+    diagnostic.location_extent_ = Range( diagnostic.location_,
+                                         diagnostic.location_ );
+    return diagnostic;
+  }
+
+  diagnostic.location_extent_ = GetLocationExtent( source_location,
+                                                   translation_unit );
   BuildFullDiagnosticDataFromChildren( diagnostic.long_formatted_text_,
                                        diagnostic.fixits_,
                                        diagnostic_wrap.get() );
@@ -280,4 +286,15 @@ Diagnostic BuildDiagnostic( const DiagnosticWrap &diagnostic_wrap,
   return diagnostic;
 }
 
+
+std::vector< FixIt > BuildDiagnosticFixIts(
+  const DiagnosticWrap &diagnostic_wrap ) {
+  std::string full_diagnostic_text;
+  std::vector< FixIt > fixits;
+  BuildFullDiagnosticDataFromChildren( full_diagnostic_text,
+                                       fixits,
+                                       diagnostic_wrap.get() );
+  return fixits;
+}
+
 } // namespace YouCompleteMe
@@ -31,16 +31,30 @@ namespace YouCompleteMe {
 using DiagnosticWrap =
   std::shared_ptr< std::remove_pointer< CXDiagnostic >::type >;
 
+// Returns true when the provided completion string is available to the user;
+// unavailable completion strings refer to entities that are private/protected,
+// deprecated etc.
+bool CompletionStringAvailable( CXCompletionString completion_string );
+
 std::vector< CompletionData > ToCompletionDataVector(
-  CXCodeCompleteResults *results );
+  const CodeCompleteResultsWrap &results );
 
 // NOTE: CXUnsavedFiles store pointers to data in UnsavedFiles, so UnsavedFiles
 // need to outlive CXUnsavedFiles!
 std::vector< CXUnsavedFile > ToCXUnsavedFiles(
   const std::vector< UnsavedFile > &unsaved_files );
 
+// Unless |full| is true, only the location, kind, text and ranges of the
+// diagnostic are filled; the extent of the location is the location itself.
+// The real extent, the formatted text and the fixits are much more expensive
+// to get.
 Diagnostic BuildDiagnostic( const DiagnosticWrap &diagnostic_wrap,
-                            CXTranslationUnit translation_unit );
+                            CXTranslationUnit translation_unit,
+                            bool full = true );
+
+// The fixits of the diagnostic and of its child diagnostics.
+std::vector< FixIt > BuildDiagnosticFixIts(
+  const DiagnosticWrap &diagnostic_wrap );
 
 } // namespace YouCompleteMe
 
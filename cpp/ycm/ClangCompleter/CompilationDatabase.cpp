@@ -17,6 +17,7 @@
 
 #include "CompilationDatabase.h"
 #include "ClangUtils.h"
+#include "LatencyHistogram.h"
 #include "PythonSupport.h"
 
 #include <memory>
@@ -64,6 +65,9 @@ bool CompilationDatabase::AlreadyGettingFlags() {
 
 CompilationInfoForFile CompilationDatabase::GetCompilationInfoForFile(
   pybind11::object path_to_file ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "CompilationDatabase::GetCompilationInfoForFile" );
+  ScopedLatencyTimer timer( latency );
   CompilationInfoForFile info;
 
   if ( !is_loaded_ ) {
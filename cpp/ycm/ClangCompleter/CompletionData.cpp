@@ -17,6 +17,8 @@
 
 #include "CompletionData.h"
 #include "ClangUtils.h"
+#include "CompletionJson.h"
+#include "Utils.h"
 
 #include <utility>
 
@@ -171,102 +173,222 @@ std::string RemoveTrailingParens( std::string text ) {
   return text;
 }
 
-} // unnamed namespace
 
+const char *CompletionKindToString( CompletionKind kind ) {
+  switch ( kind ) {
+    case CompletionKind::STRUCT:
+      return "STRUCT";
+    case CompletionKind::CLASS:
+      return "CLASS";
+    case CompletionKind::ENUM:
+      return "ENUM";
+    case CompletionKind::TYPE:
+      return "TYPE";
+    case CompletionKind::MEMBER:
+      return "MEMBER";
+    case CompletionKind::FUNCTION:
+      return "FUNCTION";
+    case CompletionKind::VARIABLE:
+      return "VARIABLE";
+    case CompletionKind::MACRO:
+      return "MACRO";
+    case CompletionKind::PARAMETER:
+      return "PARAMETER";
+    case CompletionKind::NAMESPACE:
+      return "NAMESPACE";
+    case CompletionKind::UNKNOWN:
+      break;
+  }
+  return "UNKNOWN";
+}
 
-CompletionData::CompletionData( CXCompletionString completion_string,
-                                CXCursorKind kind,
-                                CXCodeCompleteResults *results,
-                                size_t index ) {
+
+// Extracts the return type of the completion and the rest of its signature.
+void ExtractSignature( CXCompletionString completion_string,
+                       std::string &return_type,
+                       std::string &everything_except_return_type ) {
   size_t num_chunks = clang_getNumCompletionChunks( completion_string );
   bool saw_left_paren = false;
   bool saw_function_params = false;
-  bool saw_placeholder = false;
-
-  for ( size_t j = 0; j < num_chunks; ++j ) {
-    ExtractDataFromChunk( completion_string,
-                          j,
-                          saw_left_paren,
-                          saw_function_params,
-                          saw_placeholder );
-  }
 
-  original_string_ = RemoveTrailingParens( std::move( original_string_ ) );
-  kind_ = CursorKindToCompletionKind( kind );
+  for ( size_t chunk_num = 0; chunk_num < num_chunks; ++chunk_num ) {
+    CXCompletionChunkKind kind = clang_getCompletionChunkKind(
+                                   completion_string, chunk_num );
+
+    if ( IsMainCompletionTextInfo( kind ) ) {
+      if ( kind == CXCompletionChunk_LeftParen ) {
+        saw_left_paren = true;
+      } else if ( saw_left_paren &&
+                  !saw_function_params &&
+                  kind != CXCompletionChunk_RightParen &&
+                  kind != CXCompletionChunk_Informative ) {
+        saw_function_params = true;
+        everything_except_return_type.append( " " );
+      } else if ( saw_function_params &&
+                  kind == CXCompletionChunk_RightParen ) {
+        everything_except_return_type.append( " " );
+      }
 
-  detailed_info_.append( return_type_ )
-  .append( " " )
-  .append( everything_except_return_type_ )
-  .append( "\n" );
+      if ( kind == CXCompletionChunk_Optional ) {
+        everything_except_return_type.append(
+          OptionalChunkToString( completion_string, chunk_num ) );
+      } else {
+        everything_except_return_type.append(
+          ChunkToString( completion_string, chunk_num ) );
+      }
+    }
 
-  doc_string_ = CXStringToString(
-    clang_getCompletionBriefComment( completion_string ) );
+    if ( kind == CXCompletionChunk_ResultType ) {
+      return_type = ChunkToString( completion_string, chunk_num );
+    }
+  }
+}
 
-  BuildCompletionFixIt( results, index );
+
+// Same as responses.BuildLocationData.
+void AppendLocationJson( const Location &location, std::string &json ) {
+  json.append( "{\"line_num\":" )
+      .append( std::to_string( location.line_number_ ) )
+      .append( ",\"column_num\":" )
+      .append( std::to_string( location.column_number_ ) )
+      .append( ",\"filepath\":" );
+  AppendJsonString( location.filename_.empty() ? std::string() :
+                    fs::path( location.filename_ ).lexically_normal().string(),
+                    json );
+  json.push_back( '}' );
 }
 
 
-void CompletionData::ExtractDataFromChunk( CXCompletionString completion_string,
-                                           size_t chunk_num,
-                                           bool &saw_left_paren,
-                                           bool &saw_function_params,
-                                           bool &saw_placeholder ) {
-  CXCompletionChunkKind kind = clang_getCompletionChunkKind(
-                                 completion_string, chunk_num );
-
-  if ( IsMainCompletionTextInfo( kind ) ) {
-    if ( kind == CXCompletionChunk_LeftParen ) {
-      saw_left_paren = true;
-    } else if ( saw_left_paren &&
-                !saw_function_params &&
-                kind != CXCompletionChunk_RightParen &&
-                kind != CXCompletionChunk_Informative ) {
-      saw_function_params = true;
-      everything_except_return_type_.append( " " );
-    } else if ( saw_function_params && kind == CXCompletionChunk_RightParen ) {
-      everything_except_return_type_.append( " " );
+// Same as clang_completer.BuildExtraData.
+std::string ExtraDataJson( const CompletionData &completion ) {
+  const FixIt &fixit = completion.CompletionFixIt();
+  std::string doc_string = completion.DocString();
+  if ( fixit.chunks.empty() && doc_string.empty() ) {
+    return {};
+  }
+
+  std::string json = "{";
+
+  if ( !fixit.chunks.empty() ) {
+    json.append( "\"fixits\":[{\"location\":" );
+    AppendLocationJson( fixit.location, json );
+    json.append( ",\"chunks\":[" );
+    for ( size_t i = 0; i < fixit.chunks.size(); ++i ) {
+      const FixItChunk &chunk = fixit.chunks[ i ];
+      if ( i > 0 ) {
+        json.push_back( ',' );
+      }
+      json.append( "{\"replacement_text\":" );
+      AppendJsonString( chunk.replacement_text, json );
+      json.append( ",\"range\":{\"start\":" );
+      AppendLocationJson( chunk.range.start_, json );
+      json.append( ",\"end\":" );
+      AppendLocationJson( chunk.range.end_, json );
+      json.append( "}}" );
     }
+    json.append( "],\"text\":" );
+    AppendJsonString( fixit.text, json );
+    json.append( ",\"resolve\":false}]" );
+  }
 
-    if ( kind == CXCompletionChunk_Optional ) {
-      everything_except_return_type_.append(
-        OptionalChunkToString( completion_string, chunk_num ) );
-    } else {
-      everything_except_return_type_.append(
-        ChunkToString( completion_string, chunk_num ) );
+  if ( !doc_string.empty() ) {
+    if ( !fixit.chunks.empty() ) {
+      json.push_back( ',' );
     }
+    json.append( "\"doc_string\":" );
+    AppendJsonString( doc_string, json );
   }
 
-  switch ( kind ) {
-    case CXCompletionChunk_ResultType:
-      return_type_ = ChunkToString( completion_string, chunk_num );
-      break;
+  json.push_back( '}' );
+  return json;
+}
 
-    case CXCompletionChunk_Placeholder:
-      saw_placeholder = true;
-      break;
+} // unnamed namespace
 
-    case CXCompletionChunk_TypedText:
-    case CXCompletionChunk_Text:
 
-      // need to add paren to insert string
-      // when implementing inherited methods or declared methods in objc.
-    case CXCompletionChunk_LeftParen:
-    case CXCompletionChunk_RightParen:
-    case CXCompletionChunk_HorizontalSpace:
-      if ( !saw_placeholder ) {
-        original_string_ += ChunkToString( completion_string, chunk_num );
-      }
+std::string TextToInsertInBuffer( CXCompletionString completion_string ) {
+  std::string text;
+  size_t num_chunks = clang_getNumCompletionChunks( completion_string );
 
-      break;
+  for ( size_t chunk_num = 0; chunk_num < num_chunks; ++chunk_num ) {
+    switch ( clang_getCompletionChunkKind( completion_string, chunk_num ) ) {
+      case CXCompletionChunk_Placeholder:
+        return RemoveTrailingParens( std::move( text ) );
 
-    default:
-      break;
+      case CXCompletionChunk_TypedText:
+      case CXCompletionChunk_Text:
+
+        // need to add paren to insert string
+        // when implementing inherited methods or declared methods in objc.
+      case CXCompletionChunk_LeftParen:
+      case CXCompletionChunk_RightParen:
+      case CXCompletionChunk_HorizontalSpace:
+        text += ChunkToString( completion_string, chunk_num );
+        break;
+
+      default:
+        break;
+    }
   }
+
+  return RemoveTrailingParens( std::move( text ) );
 }
 
 
-void CompletionData::BuildCompletionFixIt( CXCodeCompleteResults *results,
-                                           size_t index ) {
+CompletionData::CompletionData( CodeCompleteResultsWrap results,
+                                std::vector< size_t > result_indices,
+                                std::string text )
+  : kind_( CursorKindToCompletionKind(
+             results->Results[ result_indices.front() ].CursorKind ) ),
+    original_string_( std::move( text ) ),
+    results_( std::move( results ) ),
+    result_indices_( std::move( result_indices ) ) {
+}
+
+
+void CompletionData::ExtractLazyData() const {
+  const CXCompletionResult *results = results_->Results;
+  size_t index = result_indices_.front();
+  CXCompletionString completion_string = results[ index ].CompletionString;
+
+  ExtractSignature( completion_string,
+                    return_type_,
+                    everything_except_return_type_ );
+
+  detailed_info_.append( return_type_ )
+  .append( " " )
+  .append( everything_except_return_type_ )
+  .append( "\n" );
+
+  // If there are overloads of this completion, we add their signatures to the
+  // detailed information.
+  for ( auto overload = result_indices_.begin() + 1;
+        overload != result_indices_.end();
+        ++overload ) {
+    std::string return_type;
+    std::string everything_except_return_type;
+    ExtractSignature( results[ *overload ].CompletionString,
+                      return_type,
+                      everything_except_return_type );
+    detailed_info_.append( return_type )
+    .append( " " )
+    .append( everything_except_return_type )
+    .append( "\n" );
+  }
+
+  doc_string_ = CXStringToString(
+    clang_getCompletionBriefComment( completion_string ) );
+
+  BuildCompletionFixIt( index );
+
+  results_.reset();
+  result_indices_.clear();
+  result_indices_.shrink_to_fit();
+}
+
+
+void CompletionData::BuildCompletionFixIt( size_t index ) const {
+  CXCodeCompleteResults *results = results_.get();
   size_t num_chunks = clang_getCompletionNumFixIts( results, index );
   if ( !num_chunks ) {
     return;
@@ -288,4 +410,21 @@ void CompletionData::BuildCompletionFixIt( CXCodeCompleteResults *results,
   }
 }
 
+
+std::string CompletionDataToJson(
+  const std::vector< CompletionData > &completions ) {
+  CompletionJsonBuilder builder;
+
+  for ( const CompletionData &completion : completions ) {
+    builder.Add( completion.TextToInsertInBuffer(),
+                 completion.ExtraMenuInfo(),
+                 completion.MainCompletionText(),
+                 completion.DetailedInfoForPreviewWindow(),
+                 CompletionKindToString( completion.kind_ ),
+                 ExtraDataJson( completion ) );
+  }
+
+  return builder.Build();
+}
+
 } // namespace YouCompleteMe
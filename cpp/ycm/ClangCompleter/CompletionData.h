@@ -20,8 +20,17 @@
 
 #include "FixIt.h"
 
+#include <clang-c/Index.h>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
 namespace YouCompleteMe {
 
+using CodeCompleteResultsWrap =
+  std::shared_ptr< std::remove_pointer< CXCodeCompleteResults >::type >;
+
 enum class CompletionKind {
   STRUCT = 0,
   CLASS,
@@ -48,12 +57,20 @@ enum class CompletionKind {
 //
 // The user can also enable a "preview" window that will show extra information
 // about a completion at the top of the buffer.
+//
+// Only the text to insert and the kind are extracted when the completion is
+// built; the rest is extracted from the libclang results the first time it is
+// needed. Most completions are filtered out before that. The results are
+// released once all the data is extracted.
 struct CompletionData {
   CompletionData() = default;
-  CompletionData( CXCompletionString completion_string,
-                  CXCursorKind kind,
-                  CXCodeCompleteResults *results,
-                  size_t index );
+
+  // |result_indices| are the indices in |results| of the completion and of the
+  // overloads whose signatures are added to the detailed info. |text| is the
+  // TextToInsertInBuffer of the first one.
+  CompletionData( CodeCompleteResultsWrap results,
+                  std::vector< size_t > result_indices,
+                  std::string text );
 
   // What should actually be inserted into the buffer. For a function like
   // "int foo(int x)", this is just "foo". Same for a data member like "foo_":
@@ -68,6 +85,7 @@ struct CompletionData {
   // x)", this would be "foo(int x)". For a data member like "count_", it would
   // be just "count_".
   std::string MainCompletionText() const {
+    Resolve();
     return everything_except_return_type_;
   }
 
@@ -75,6 +93,7 @@ struct CompletionData {
   // completion text and the kind. Currently we put the return type of the
   // function here, if any.
   std::string ExtraMenuInfo() const {
+    Resolve();
     return return_type_;
   }
 
@@ -82,42 +101,67 @@ struct CompletionData {
   // window that vim usually shows at the top of the buffer. This should be used
   // for extra information about the completion.
   std::string DetailedInfoForPreviewWindow() const {
+    Resolve();
     return detailed_info_;
   }
 
   std::string DocString() const {
+    Resolve();
     return doc_string_;
   }
 
-  std::string detailed_info_;
-
-  std::string return_type_;
+  const FixIt &CompletionFixIt() const {
+    Resolve();
+    return fixit_;
+  }
 
   CompletionKind kind_;
 
+private:
+  // Extracts the lazy data if not done yet. Not thread-safe.
+  void Resolve() const {
+    if ( results_ ) {
+      ExtractLazyData();
+    }
+  }
+
+  void ExtractLazyData() const;
+
+  void BuildCompletionFixIt( size_t index ) const;
+
   // The original, raw completion string. For a function like "int foo(int x)",
   // the original string is "foo". For a member data variable like "foo_", this
   // is just "foo_". This corresponds to clang's TypedText chunk of the
   // completion string.
   std::string original_string_;
 
-  std::string everything_except_return_type_;
+  // Null once the lazy data below is extracted.
+  mutable CodeCompleteResultsWrap results_;
+  mutable std::vector< size_t > result_indices_;
 
-  std::string doc_string_;
+  mutable std::string detailed_info_;
 
-  FixIt fixit_;
+  mutable std::string return_type_;
 
-private:
+  mutable std::string everything_except_return_type_;
 
-  void ExtractDataFromChunk( CXCompletionString completion_string,
-                             size_t chunk_num,
-                             bool &saw_left_paren,
-                             bool &saw_function_params,
-                             bool &saw_placeholder );
+  mutable std::string doc_string_;
 
-  void BuildCompletionFixIt( CXCodeCompleteResults *results, size_t index );
+  mutable FixIt fixit_;
 };
 
+
+// Same as CompletionData::TextToInsertInBuffer but without building the rest
+// of the completion data, e.g. for filtering the completions first.
+YCM_EXPORT std::string TextToInsertInBuffer(
+  CXCompletionString completion_string );
+
+
+// Returns the completions as a JSON array with the same contents as the
+// responses built by clang_completer.ConvertCompletionData.
+YCM_EXPORT std::string CompletionDataToJson(
+  const std::vector< CompletionData > &completions );
+
 } // namespace YouCompleteMe
 
 
@@ -0,0 +1,111 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CompletionResults.h"
+#include "Candidate.h"
+#include "CandidateRepository.h"
+#include "QueryOptions.h"
+#include "QueryStatistics.h"
+#include "Result.h"
+#include "Utils.h"
+
+#include <unordered_map>
+
+namespace YouCompleteMe {
+
+CompletionResults::CompletionResults( CodeCompleteResultsWrap results )
+  : results_( std::move( results ) ) {
+  if ( !results_ || !results_->Results ) {
+    return;
+  }
+
+  std::vector< std::string > texts;
+  std::unordered_map< std::string, size_t > seen_texts;
+
+  for ( size_t i = 0; i < results_->NumResults; ++i ) {
+    CXCompletionString completion_string =
+      results_->Results[ i ].CompletionString;
+
+    if ( !completion_string ||
+         !CompletionStringAvailable( completion_string ) ) {
+      continue;
+    }
+
+    std::string text = TextToInsertInBuffer( completion_string );
+    size_t index = GetValueElseInsert( seen_texts,
+                                       text,
+                                       result_indices_.size() );
+
+    if ( index == result_indices_.size() ) {
+      result_indices_.emplace_back();
+      texts.push_back( std::move( text ) );
+    }
+    result_indices_[ index ].push_back( i );
+  }
+
+  candidates_ = CandidateRepository::Instance().GetCandidatesForStrings(
+                  std::move( texts ) );
+}
+
+
+size_t CompletionResults::NumCompletions() const {
+  return candidates_.size();
+}
+
+
+std::vector< CompletionData > CompletionResults::FilterAndSort(
+  std::string query,
+  size_t max_candidates ) const {
+  std::vector< ResultAnd< size_t > > result_and_indices;
+  QueryStatistics statistics;
+  statistics.source = "clang";
+  statistics.query = query;
+  statistics.num_queries = 1;
+  QueryTimer timer;
+  Word query_object( std::move( query ) );
+  QueryOptions options;
+
+  for ( size_t i = 0; i < candidates_.size(); ++i ) {
+    Result result = candidates_[ i ]->FilteredQueryMatchResult(
+      query_object, options, false, &statistics );
+    if ( result.IsSubsequence() ) {
+      result_and_indices.emplace_back( result, i );
+    }
+  }
+  statistics.matching_ns = timer.Lap();
+
+  for ( auto &result_and_index : result_and_indices ) {
+    result_and_index.result_.SetResultFeaturesFromQuery();
+  }
+  statistics.lcs_ns = timer.Lap();
+
+  PartialSort( result_and_indices, max_candidates );
+  statistics.sort_ns = timer.Lap();
+  QueryStatisticsRegistry::Instance().Record( std::move( statistics ) );
+
+  std::vector< CompletionData > completions;
+  completions.reserve( result_and_indices.size() );
+  for ( const auto &result_and_index : result_and_indices ) {
+    size_t index = result_and_index.extra_object_;
+    completions.emplace_back( results_,
+                              result_indices_[ index ],
+                              candidates_[ index ]->Text() );
+  }
+  return completions;
+}
+
+} // namespace YouCompleteMe
@@ -0,0 +1,65 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef COMPLETIONRESULTS_H_R8XTQ2MD
+#define COMPLETIONRESULTS_H_R8XTQ2MD
+
+#include "ClangHelpers.h"
+#include "CompletionData.h"
+
+#include <string>
+#include <vector>
+
+namespace YouCompleteMe {
+
+class Candidate;
+
+
+// Results of a clang_codeCompleteAt call, indexed by the text they insert in
+// the buffer. Filtering and sorting are done on that text so that only the
+// CompletionData of the kept completions are built. As in
+// ToCompletionDataVector, the overloads of a function make a single
+// completion.
+//
+// This class is thread-safe.
+class CompletionResults {
+public:
+  YCM_EXPORT explicit CompletionResults( CodeCompleteResultsWrap results );
+  CompletionResults( const CompletionResults& ) = delete;
+  CompletionResults& operator=( const CompletionResults& ) = delete;
+
+  // Number of completions before filtering.
+  YCM_EXPORT size_t NumCompletions() const;
+
+  // Returns the |max_candidates| completions best matching |query|, sorted.
+  // If |max_candidates| is 0, all the matching completions are returned.
+  YCM_EXPORT std::vector< CompletionData > FilterAndSort(
+    std::string query,
+    size_t max_candidates ) const;
+
+private:
+  CodeCompleteResultsWrap results_;
+
+  // For each completion, the indices in results_ of the function and its
+  // overloads.
+  std::vector< std::vector< size_t > > result_indices_;
+  std::vector< const Candidate * > candidates_;
+};
+
+} // namespace YouCompleteMe
+
+#endif /* end of include guard: COMPLETIONRESULTS_H_R8XTQ2MD */
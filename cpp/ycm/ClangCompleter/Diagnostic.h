@@ -48,6 +48,35 @@ struct Diagnostic {
   /// FixIts for the main reported diagnostic. These are typically notes,
   /// offering alternative ways to fix the error.
   std::vector< FixIt > fixits_;
+
+  /// Identifies the diagnostic across the reparses of its TU: it only changes
+  /// if the diagnostic does.
+  size_t id_ = 0;
+};
+
+
+/// The changes of the diagnostics of a TU since a given generation. Each
+/// change of the diagnostics of any TU gets a new generation; zero is never
+/// used.
+struct DiagnosticsDelta {
+  /// Generation of the current diagnostics.
+  size_t generation_ = 0;
+
+  /// Whether the diagnostics didn't change since the given generation. Only
+  /// generation_ is set then.
+  bool unchanged_ = false;
+
+  /// Whether the given generation is unknown, e.g. too old or from another TU.
+  /// added_ then contains all the current diagnostics.
+  bool full_ = false;
+
+  std::vector< Diagnostic > added_;
+
+  /// Ids of the removed diagnostics.
+  std::vector< size_t > removed_;
+
+  /// Ids of the current diagnostics, in order.
+  std::vector< size_t > ids_;
 };
 
 } // namespace YouCompleteMe
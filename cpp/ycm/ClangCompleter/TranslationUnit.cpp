@@ -25,17 +25,30 @@
 #include <cstdlib>
 #include <filesystem>
 #include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
 using std::unique_lock;
 using std::mutex;
 using std::try_to_lock_t;
-using std::shared_ptr;
-using std::remove_pointer;
 
 namespace YouCompleteMe {
 
 namespace {
 
+// Number of generations of diagnostics remembered per translation unit.
+const size_t MAX_DIAGNOSTICS_HISTORY = 4;
+
+// Diagnostics that ycmd never displays. Keep in sync with clang_completer.py.
+const char *const PRAGMA_DIAG_TEXT_TO_IGNORE = "#pragma once in main file";
+const char *const TOO_MANY_ERRORS_DIAG_TEXT_TO_IGNORE =
+  "too many errors emitted, stopping now";
+
+// Shared by all the translation units so that a generation from a unit is
+// never mistaken for one of another unit, e.g. after the flags changed.
+std::atomic< size_t > last_diagnostics_generation( 0 );
+
 unsigned EditingOptions() {
   // See cpp/llvm/include/clang-c/Index.h file for detail on these options.
   return CXTranslationUnit_DetailedPreprocessingRecord |
@@ -65,48 +78,190 @@ void EnsureCompilerNamePresent( std::vector< const char * > &flags ) {
   }
 }
 
-}  // unnamed namespace
 
-using CodeCompleteResultsWrap =
-  shared_ptr< remove_pointer< CXCodeCompleteResults >::type >;
+// Doesn't depend on the order of the files.
+size_t HashForUnsavedFiles(
+  const std::vector< CXUnsavedFile > &unsaved_files ) {
+  size_t hash = unsaved_files.size();
+  for ( const CXUnsavedFile &unsaved_file : unsaved_files ) {
+    size_t seed = std::hash< std::string_view >()( unsaved_file.Filename );
+    seed ^= std::hash< std::string_view >()(
+              std::string_view( unsaved_file.Contents, unsaved_file.Length ) ) +
+            ( seed << 6 ) + ( seed >> 2 );
+    hash += seed;
+  }
+  return hash;
+}
+
+
+fs::file_time_type LastWriteTime( const std::string &filename ) {
+  std::error_code error;
+  fs::file_time_type time = fs::last_write_time( filename, error );
+  return error ? fs::file_time_type::min() : time;
+}
+
+
+bool HasFatalDiagnostic( CXTranslationUnit translation_unit ) {
+  size_t num_diagnostics = clang_getNumDiagnostics( translation_unit );
+  for ( size_t i = 0; i < num_diagnostics; ++i ) {
+    DiagnosticWrap diagnostic( clang_getDiagnostic( translation_unit, i ),
+                               clang_disposeDiagnostic );
+    if ( clang_getDiagnosticSeverity( diagnostic.get() ) ==
+         CXDiagnostic_Fatal ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+bool IsIgnoredDiagnostic( const Diagnostic &diagnostic ) {
+  return diagnostic.text_ == PRAGMA_DIAG_TEXT_TO_IGNORE ||
+         diagnostic.text_ == TOO_MANY_ERRORS_DIAG_TEXT_TO_IGNORE;
+}
+
+
+size_t HashCombine( size_t seed, size_t value ) {
+  return seed ^ ( value + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 ) );
+}
+
+
+size_t HashForLocation( size_t seed, const Location &location ) {
+  seed = HashCombine( seed, std::hash< std::string >()( location.filename_ ) );
+  seed = HashCombine( seed, location.line_number_ );
+  return HashCombine( seed, location.column_number_ );
+}
+
+
+size_t HashForDiagnostic( const Diagnostic &diagnostic ) {
+  size_t hash = std::hash< std::string >()( diagnostic.text_ );
+  hash = HashCombine( hash, static_cast< size_t >( diagnostic.kind_ ) );
+  hash = HashForLocation( hash, diagnostic.location_ );
+  hash = HashForLocation( hash, diagnostic.location_extent_.start_ );
+  hash = HashForLocation( hash, diagnostic.location_extent_.end_ );
+  for ( const Range &range : diagnostic.ranges_ ) {
+    hash = HashForLocation( hash, range.start_ );
+    hash = HashForLocation( hash, range.end_ );
+  }
+  // Only fully built diagnostics have notes and fixits; these can change on
+  // their own, e.g. the candidates of an overload after a header edit.
+  hash = HashCombine( hash, std::hash< std::string >()(
+                              diagnostic.long_formatted_text_ ) );
+  for ( const FixIt &fixit : diagnostic.fixits_ ) {
+    hash = HashCombine( hash, fixit.chunks.size() );
+    for ( const FixItChunk &chunk : fixit.chunks ) {
+      hash = HashCombine( hash, std::hash< std::string >()(
+                                  chunk.replacement_text ) );
+      hash = HashForLocation( hash, chunk.range.start_ );
+      hash = HashForLocation( hash, chunk.range.end_ );
+    }
+  }
+  return hash;
+}
+
+
+// Gives each diagnostic an id that only depends on its contents and on the
+// number of identical diagnostics before it.
+std::vector< size_t > AssignDiagnosticIds(
+  std::vector< Diagnostic > &diagnostics ) {
+  std::vector< size_t > ids;
+  ids.reserve( diagnostics.size() );
+  std::unordered_map< size_t, size_t > occurrences;
+  for ( Diagnostic &diagnostic : diagnostics ) {
+    size_t hash = HashForDiagnostic( diagnostic );
+    diagnostic.id_ = HashCombine( hash, occurrences[ hash ]++ );
+    ids.push_back( diagnostic.id_ );
+  }
+  return ids;
+}
+
+
+void AddInclusion( CXFile included_file,
+                   CXSourceLocation*,
+                   unsigned,
+                   CXClientData client_data ) {
+  static_cast< std::vector< std::string > * >( client_data )->push_back(
+    CXStringToString( clang_getFileName( included_file ) ) );
+}
+
+}  // unnamed namespace
 
 TranslationUnit::TranslationUnit()
-  : clang_translation_unit_( nullptr ) {
+  : clang_index_( nullptr ),
+    double_buffered_( false ),
+    max_diagnostics_( 0 ),
+    back_translation_unit_( nullptr ),
+    clang_translation_unit_( nullptr ),
+    loaded_from_ast_file_( false ),
+    memory_usage_( 0 ),
+    parse_inputs_valid_( false ),
+    unsaved_files_hash_( 0 ) {
 }
 
 TranslationUnit::TranslationUnit(
   const std::string &filename,
   const std::vector< UnsavedFile > &unsaved_files,
   const std::vector< std::string > &flags,
-  CXIndex clang_index )
-  : clang_translation_unit_( nullptr ) {
-  std::vector< const char * > pointer_flags;
-  pointer_flags.reserve( flags.size() );
+  CXIndex clang_index,
+  bool double_buffered,
+  size_t max_diagnostics )
+  : filename_( filename ),
+    flags_( flags ),
+    clang_index_( clang_index ),
+    double_buffered_( double_buffered ),
+    max_diagnostics_( max_diagnostics ),
+    back_translation_unit_( nullptr ),
+    clang_translation_unit_( nullptr ),
+    loaded_from_ast_file_( false ),
+    memory_usage_( 0 ),
+    parse_inputs_valid_( false ),
+    unsaved_files_hash_( 0 ) {
+  std::vector< CXUnsavedFile > cxunsaved_files =
+    ToCXUnsavedFiles( unsaved_files );
 
-  for ( const std::string & flag : flags ) {
-    pointer_flags.push_back( flag.c_str() );
+  // Actually parse the translation unit.
+  CXErrorCode failure = Parse( cxunsaved_files, clang_translation_unit_ );
+  if ( failure != CXError_Success ) {
+    throw ClangParseError( failure );
   }
 
-  EnsureCompilerNamePresent( pointer_flags );
+  UpdateMemoryUsage();
+  UpdateParseInputs( cxunsaved_files );
+  UpdateLatestDiagnostics();
+}
 
-  std::vector< CXUnsavedFile > cxunsaved_files =
-    ToCXUnsavedFiles( unsaved_files );
-  const CXUnsavedFile *unsaved = cxunsaved_files.empty()
-                                 ? nullptr : &cxunsaved_files[ 0 ];
 
-  // Actually parse the translation unit.
-  CXErrorCode failure = clang_parseTranslationUnit2FullArgv(
-                          clang_index,
-                          filename.c_str(),
-                          &pointer_flags[ 0 ],
-                          pointer_flags.size(),
-                          const_cast<CXUnsavedFile *>( unsaved ),
-                          cxunsaved_files.size(),
-                          EditingOptions(),
+TranslationUnit::TranslationUnit(
+  const std::string &filename,
+  const std::vector< std::string > &flags,
+  CXIndex clang_index,
+  const std::string &ast_file,
+  bool double_buffered,
+  size_t max_diagnostics )
+  : filename_( filename ),
+    flags_( flags ),
+    clang_index_( clang_index ),
+    double_buffered_( double_buffered ),
+    max_diagnostics_( max_diagnostics ),
+    back_translation_unit_( nullptr ),
+    clang_translation_unit_( nullptr ),
+    loaded_from_ast_file_( true ),
+    memory_usage_( 0 ),
+    parse_inputs_valid_( false ),
+    unsaved_files_hash_( 0 ) {
+  CXErrorCode failure = clang_createTranslationUnit2(
+                          clang_index_,
+                          ast_file.c_str(),
                           &clang_translation_unit_ );
   if ( failure != CXError_Success ) {
     throw ClangParseError( failure );
   }
+
+  UpdateMemoryUsage();
+  // Only to know the dependencies; the next reparse is never skipped.
+  UpdateParseInputs( {} );
+  parse_inputs_valid_ = false;
+  UpdateLatestDiagnostics();
 }
 
 
@@ -115,12 +270,49 @@ TranslationUnit::~TranslationUnit() {
 }
 
 void TranslationUnit::Destroy() {
+  unique_lock< mutex > back_lock( back_translation_unit_mutex_ );
   unique_lock< mutex > lock( clang_access_mutex_ );
 
+  if ( back_translation_unit_ ) {
+    clang_disposeTranslationUnit( back_translation_unit_ );
+    back_translation_unit_ = nullptr;
+  }
+
   if ( clang_translation_unit_ ) {
     clang_disposeTranslationUnit( clang_translation_unit_ );
     clang_translation_unit_ = nullptr;
+    memory_usage_ = 0;
   }
+
+  parse_inputs_valid_ = false;
+  dependency_times_.clear();
+}
+
+
+CXErrorCode TranslationUnit::Parse(
+  std::vector< CXUnsavedFile > &unsaved_files,
+  CXTranslationUnit &translation_unit ) {
+  std::vector< const char * > pointer_flags;
+  pointer_flags.reserve( flags_.size() );
+
+  for ( const std::string & flag : flags_ ) {
+    pointer_flags.push_back( flag.c_str() );
+  }
+
+  EnsureCompilerNamePresent( pointer_flags );
+
+  const CXUnsavedFile *unsaved = unsaved_files.empty()
+                                 ? nullptr : &unsaved_files[ 0 ];
+
+  return clang_parseTranslationUnit2FullArgv(
+           clang_index_,
+           filename_.c_str(),
+           &pointer_flags[ 0 ],
+           pointer_flags.size(),
+           const_cast<CXUnsavedFile *>( unsaved ),
+           unsaved_files.size(),
+           EditingOptions(),
+           &translation_unit );
 }
 
 
@@ -136,6 +328,39 @@ bool TranslationUnit::IsCurrentlyUpdating() const {
 }
 
 
+size_t TranslationUnit::MemoryUsage() const {
+  return memory_usage_;
+}
+
+
+bool TranslationUnit::Save( const std::string &ast_file ) {
+  unique_lock< mutex > lock( clang_access_mutex_ );
+
+  if ( !clang_translation_unit_ ) {
+    return false;
+  }
+
+  return clang_saveTranslationUnit(
+           clang_translation_unit_,
+           ast_file.c_str(),
+           clang_defaultSaveOptions( clang_translation_unit_ ) ) ==
+         CXSaveError_None;
+}
+
+
+bool TranslationUnit::DependenciesModifiedAfter( fs::file_time_type time ) {
+  unique_lock< mutex > lock( back_translation_unit_mutex_ );
+
+  for ( const auto &filename_and_time : dependency_times_ ) {
+    if ( filename_and_time.second == fs::file_time_type::min() ||
+         filename_and_time.second > time ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
 std::vector< Diagnostic > TranslationUnit::Reparse(
   const std::vector< UnsavedFile > &unsaved_files ) {
   std::vector< CXUnsavedFile > cxunsaved_files =
@@ -148,15 +373,94 @@ std::vector< Diagnostic > TranslationUnit::Reparse(
 }
 
 
+DiagnosticsDelta TranslationUnit::Reparse(
+  const std::vector< UnsavedFile > &unsaved_files,
+  size_t generation ) {
+  std::vector< CXUnsavedFile > cxunsaved_files =
+    ToCXUnsavedFiles( unsaved_files );
+
+  Reparse( cxunsaved_files );
+
+  DiagnosticsDelta delta;
+  unique_lock< mutex > lock( diagnostics_mutex_ );
+  if ( diagnostics_history_.empty() ) {
+    delta.full_ = true;
+    return delta;
+  }
+
+  const auto &[ current_generation, current_ids ] = diagnostics_history_.back();
+  delta.generation_ = current_generation;
+
+  auto previous = std::find_if(
+    diagnostics_history_.begin(),
+    diagnostics_history_.end(),
+    [ generation ]( const auto &entry ) { return entry.first == generation; } );
+  if ( previous == diagnostics_history_.end() ) {
+    delta.full_ = true;
+    delta.added_ = latest_diagnostics_;
+    delta.ids_ = current_ids;
+    return delta;
+  }
+
+  // The diagnostics may have changed and changed back since then.
+  const std::vector< size_t > &previous_ids = previous->second;
+  if ( previous_ids == current_ids ) {
+    delta.unchanged_ = true;
+    return delta;
+  }
+
+  std::unordered_set< size_t > previous_id_set( previous_ids.begin(),
+                                                previous_ids.end() );
+  for ( const Diagnostic &diagnostic : latest_diagnostics_ ) {
+    if ( !previous_id_set.count( diagnostic.id_ ) ) {
+      delta.added_.push_back( diagnostic );
+    }
+  }
+
+  std::unordered_set< size_t > current_id_set( current_ids.begin(),
+                                               current_ids.end() );
+  for ( size_t id : previous_ids ) {
+    if ( !current_id_set.count( id ) ) {
+      delta.removed_.push_back( id );
+    }
+  }
+
+  delta.ids_ = current_ids;
+  return delta;
+}
+
+
 std::vector< CompletionData > TranslationUnit::CandidatesForLocation(
   const std::string &filename,
   int line,
   int column,
   const std::vector< UnsavedFile > &unsaved_files ) {
   unique_lock< mutex > lock( clang_access_mutex_ );
+  CodeCompleteResultsWrap results = CodeCompleteAt( filename,
+                                                    line,
+                                                    column,
+                                                    unsaved_files );
+  return ToCompletionDataVector( results );
+}
 
+
+CodeCompleteResultsWrap TranslationUnit::CodeCompleteResultsForLocation(
+  const std::string &filename,
+  int line,
+  int column,
+  const std::vector< UnsavedFile > &unsaved_files ) {
+  unique_lock< mutex > lock( clang_access_mutex_ );
+  return CodeCompleteAt( filename, line, column, unsaved_files );
+}
+
+
+CodeCompleteResultsWrap TranslationUnit::CodeCompleteAt(
+  const std::string &filename,
+  int line,
+  int column,
+  const std::vector< UnsavedFile > &unsaved_files ) {
   if ( !clang_translation_unit_ ) {
-    return std::vector< CompletionData >();
+    return CodeCompleteResultsWrap();
   }
 
   std::vector< CXUnsavedFile > cxunsaved_files =
@@ -174,7 +478,7 @@ std::vector< CompletionData > TranslationUnit::CandidatesForLocation(
   // in the open-source world don't realize this (I checked). Some don't even
   // call reparse*, but parse* which is even less efficient.
 
-  CodeCompleteResultsWrap results(
+  return CodeCompleteResultsWrap(
     clang_codeCompleteAt( clang_translation_unit_,
                           filename.c_str(),
                           line,
@@ -183,10 +487,6 @@ std::vector< CompletionData > TranslationUnit::CandidatesForLocation(
                           cxunsaved_files.size(),
                           CompletionOptions() ),
     clang_disposeCodeCompleteResults );
-
-  std::vector< CompletionData > candidates = ToCompletionDataVector(
-                                               results.get() );
-  return candidates;
 }
 
 Location TranslationUnit::GetDeclarationLocationForCursor( CXCursor cursor ) {
@@ -212,7 +512,7 @@ Location TranslationUnit::GetDeclarationLocation(
   const std::vector< UnsavedFile > &unsaved_files,
   bool reparse ) {
   if ( reparse ) {
-    Reparse( unsaved_files );
+    ReparseForQuery( unsaved_files );
   }
 
   unique_lock< mutex > lock( clang_access_mutex_ );
@@ -247,7 +547,7 @@ Location TranslationUnit::GetDefinitionLocation(
   const std::vector< UnsavedFile > &unsaved_files,
   bool reparse ) {
   if ( reparse ) {
-    Reparse( unsaved_files );
+    ReparseForQuery( unsaved_files );
   }
 
   unique_lock< mutex > lock( clang_access_mutex_ );
@@ -272,7 +572,7 @@ Location TranslationUnit::GetDefinitionOrDeclarationLocation(
   const std::vector< UnsavedFile > &unsaved_files,
   bool reparse ) {
   if ( reparse ) {
-    Reparse( unsaved_files );
+    ReparseForQuery( unsaved_files );
   }
 
   unique_lock< mutex > lock( clang_access_mutex_ );
@@ -314,7 +614,7 @@ std::string TranslationUnit::GetTypeAtLocation(
   bool reparse ) {
 
   if ( reparse ) {
-    Reparse( unsaved_files );
+    ReparseForQuery( unsaved_files );
   }
 
   unique_lock< mutex > lock( clang_access_mutex_ );
@@ -394,7 +694,7 @@ std::string TranslationUnit::GetEnclosingFunctionAtLocation(
   bool reparse ) {
 
   if ( reparse ) {
-    Reparse( unsaved_files );
+    ReparseForQuery( unsaved_files );
   }
 
   unique_lock< mutex > lock( clang_access_mutex_ );
@@ -426,6 +726,11 @@ std::string TranslationUnit::GetEnclosingFunctionAtLocation(
 // param though.
 void TranslationUnit::Reparse(
   std::vector< CXUnsavedFile > &unsaved_files ) {
+  if ( double_buffered_ ) {
+    ReparseBackBuffer( unsaved_files, true );
+    return;
+  }
+
   unsigned options = ( clang_translation_unit_
                        ? ReparseOptions( clang_translation_unit_ )
                        : static_cast<unsigned>( CXReparse_None ) );
@@ -441,22 +746,39 @@ void TranslationUnit::Reparse( std::vector< CXUnsavedFile > &unsaved_files,
                                size_t parse_options ) {
   CXErrorCode failure;
   {
+    unique_lock< mutex > back_lock( back_translation_unit_mutex_ );
     unique_lock< mutex > lock( clang_access_mutex_ );
 
-    if ( !clang_translation_unit_ ) {
+    if ( !clang_translation_unit_ ||
+         ParseInputsUnchanged( unsaved_files ) ) {
       return;
     }
 
-    CXUnsavedFile *unsaved = unsaved_files.empty()
-                             ? nullptr : &unsaved_files[ 0 ];
+    if ( loaded_from_ast_file_ ) {
+      CXTranslationUnit translation_unit = nullptr;
+      failure = Parse( unsaved_files, translation_unit );
+      if ( failure == CXError_Success ) {
+        clang_disposeTranslationUnit( clang_translation_unit_ );
+        clang_translation_unit_ = translation_unit;
+        loaded_from_ast_file_ = false;
+      }
+    } else {
+      CXUnsavedFile *unsaved = unsaved_files.empty()
+                               ? nullptr : &unsaved_files[ 0 ];
+
+      // This function should technically return a CXErrorCode enum but return
+      // an int instead.
+      failure = static_cast< CXErrorCode >(
+        clang_reparseTranslationUnit( clang_translation_unit_,
+                                      unsaved_files.size(),
+                                      unsaved,
+                                      parse_options ) );
+    }
 
-    // This function should technically return a CXErrorCode enum but return an
-    // int instead.
-    failure = static_cast< CXErrorCode >(
-      clang_reparseTranslationUnit( clang_translation_unit_,
-                                    unsaved_files.size(),
-                                    unsaved,
-                                    parse_options ) );
+    if ( failure == CXError_Success ) {
+      UpdateMemoryUsage();
+      UpdateParseInputs( unsaved_files );
+    }
   }
 
   if ( failure != CXError_Success ) {
@@ -467,25 +789,205 @@ void TranslationUnit::Reparse( std::vector< CXUnsavedFile > &unsaved_files,
   UpdateLatestDiagnostics();
 }
 
+void TranslationUnit::ReparseBackBuffer(
+  std::vector< CXUnsavedFile > &unsaved_files,
+  bool wait ) {
+  CXErrorCode failure;
+  {
+    unique_lock< mutex > back_lock( back_translation_unit_mutex_,
+                                    std::defer_lock );
+    if ( wait ) {
+      back_lock.lock();
+    } else if ( !back_lock.try_lock() ) {
+      return;
+    }
+
+    if ( !clang_translation_unit_ ||
+         ParseInputsUnchanged( unsaved_files ) ) {
+      return;
+    }
+
+    // The back TU is one version behind the front one, if any.
+    if ( back_translation_unit_ ) {
+      CXUnsavedFile *unsaved = unsaved_files.empty()
+                               ? nullptr : &unsaved_files[ 0 ];
+      unsigned options = ReparseOptions( back_translation_unit_ );
+      failure = static_cast< CXErrorCode >(
+        clang_reparseTranslationUnit( back_translation_unit_,
+                                      unsaved_files.size(),
+                                      unsaved,
+                                      options ) );
+    } else {
+      failure = Parse( unsaved_files, back_translation_unit_ );
+    }
+
+    if ( failure == CXError_Success ) {
+      unique_lock< mutex > lock( clang_access_mutex_ );
+      std::swap( back_translation_unit_, clang_translation_unit_ );
+      // A TU loaded from an AST file can't be reparsed.
+      if ( loaded_from_ast_file_ ) {
+        clang_disposeTranslationUnit( back_translation_unit_ );
+        back_translation_unit_ = nullptr;
+        loaded_from_ast_file_ = false;
+      }
+      UpdateMemoryUsage();
+      UpdateParseInputs( unsaved_files );
+    }
+  }
+
+  if ( failure != CXError_Success ) {
+    Destroy();
+    throw ClangParseError( failure );
+  }
+
+  UpdateLatestDiagnostics();
+}
+
+
+void TranslationUnit::ReparseForQuery(
+  const std::vector< UnsavedFile > &unsaved_files ) {
+  std::vector< CXUnsavedFile > cxunsaved_files =
+    ToCXUnsavedFiles( unsaved_files );
+
+  if ( double_buffered_ ) {
+    ReparseBackBuffer( cxunsaved_files, false );
+  } else {
+    Reparse( cxunsaved_files );
+  }
+}
+
+
+void TranslationUnit::UpdateMemoryUsage() {
+  size_t memory_usage = 0;
+  for ( CXTranslationUnit translation_unit : { clang_translation_unit_,
+                                               back_translation_unit_ } ) {
+    if ( !translation_unit ) {
+      continue;
+    }
+
+    CXTUResourceUsage usage = clang_getCXTUResourceUsage( translation_unit );
+    for ( unsigned i = 0; i < usage.numEntries; ++i ) {
+      const CXTUResourceUsageEntry &entry = usage.entries[ i ];
+      if ( entry.kind >= CXTUResourceUsage_MEMORY_IN_BYTES_BEGIN &&
+           entry.kind <= CXTUResourceUsage_MEMORY_IN_BYTES_END ) {
+        memory_usage += entry.amount;
+      }
+    }
+    clang_disposeCXTUResourceUsage( usage );
+  }
+  memory_usage_ = memory_usage;
+}
+
+
+void TranslationUnit::UpdateParseInputs(
+  const std::vector< CXUnsavedFile > &unsaved_files ) {
+  ++parse_sequence_;
+  dependency_times_.clear();
+  unsaved_files_hash_ = HashForUnsavedFiles( unsaved_files );
+  // A fatal error like a missing header may go away without any of the
+  // current dependencies changing.
+  parse_inputs_valid_ = !HasFatalDiagnostic( clang_translation_unit_ );
+
+  std::vector< std::string > included_files;
+  clang_getInclusions( clang_translation_unit_,
+                       AddInclusion,
+                       &included_files );
+
+  std::sort( included_files.begin(), included_files.end() );
+  included_files.erase( std::unique( included_files.begin(),
+                                     included_files.end() ),
+                        included_files.end() );
+
+  // The contents of the unsaved files are compared instead.
+  for ( const CXUnsavedFile &unsaved_file : unsaved_files ) {
+    auto included_file = std::lower_bound( included_files.begin(),
+                                           included_files.end(),
+                                           unsaved_file.Filename );
+    if ( included_file != included_files.end() &&
+         *included_file == unsaved_file.Filename ) {
+      included_file->clear();
+    }
+  }
+
+  dependency_times_.reserve( included_files.size() );
+  for ( std::string &included_file : included_files ) {
+    if ( !included_file.empty() ) {
+      fs::file_time_type time = LastWriteTime( included_file );
+      dependency_times_.emplace_back( std::move( included_file ), time );
+    }
+  }
+}
+
+
+bool TranslationUnit::ParseInputsUnchanged(
+  const std::vector< CXUnsavedFile > &unsaved_files ) const {
+  if ( !parse_inputs_valid_ ||
+       unsaved_files_hash_ != HashForUnsavedFiles( unsaved_files ) ) {
+    return false;
+  }
+
+  for ( const auto &[ filename, time ] : dependency_times_ ) {
+    if ( LastWriteTime( filename ) != time ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
 void TranslationUnit::UpdateLatestDiagnostics() {
-  unique_lock< mutex > lock1( clang_access_mutex_ );
-  unique_lock< mutex > lock2( diagnostics_mutex_ );
+  std::vector< Diagnostic > diagnostics;
+  size_t parse_sequence;
+  {
+    unique_lock< mutex > lock( clang_access_mutex_ );
+    parse_sequence = parse_sequence_;
+
+    size_t num_diagnostics = clang_getNumDiagnostics( clang_translation_unit_ );
+    diagnostics.reserve( num_diagnostics );
+
+    // Only the diagnostics that can be displayed are fully built. The ignored
+    // ones are dropped before the list is truncated so they don't count.
+    size_t num_displayed_diagnostics = 0;
+    for ( size_t i = 0; i < num_diagnostics; ++i ) {
+      bool full = !max_diagnostics_ ||
+                  num_displayed_diagnostics < max_diagnostics_;
+      Diagnostic diagnostic =
+        BuildDiagnostic(
+          DiagnosticWrap( clang_getDiagnostic( clang_translation_unit_, i ),
+                          clang_disposeDiagnostic ),
+          clang_translation_unit_,
+          full );
+
+      if ( diagnostic.kind_ == DiagnosticKind::INFORMATION ) {
+        continue;
+      }
+      if ( !IsIgnoredDiagnostic( diagnostic ) ) {
+        ++num_displayed_diagnostics;
+      }
+      diagnostics.push_back( std::move( diagnostic ) );
+    }
+  }
 
-  latest_diagnostics_.clear();
-  size_t num_diagnostics = clang_getNumDiagnostics( clang_translation_unit_ );
-  latest_diagnostics_.reserve( num_diagnostics );
+  std::vector< size_t > ids = AssignDiagnosticIds( diagnostics );
 
-  for ( size_t i = 0; i < num_diagnostics; ++i ) {
-    Diagnostic diagnostic =
-      BuildDiagnostic(
-        DiagnosticWrap( clang_getDiagnostic( clang_translation_unit_, i ),
-                        clang_disposeDiagnostic ),
-        clang_translation_unit_ );
-
-    if ( diagnostic.kind_ != DiagnosticKind::INFORMATION ) {
-      latest_diagnostics_.push_back( diagnostic );
+  unique_lock< mutex > lock( diagnostics_mutex_ );
+  // Concurrent reparses may get here out of order; a build from an older
+  // parse than the published one is dropped.
+  if ( parse_sequence < published_parse_sequence_ ) {
+    return;
+  }
+  published_parse_sequence_ = parse_sequence;
+
+  // Only a change of the diagnostics starts a new generation.
+  if ( diagnostics_history_.empty() ||
+       diagnostics_history_.back().second != ids ) {
+    diagnostics_history_.emplace_back( ++last_diagnostics_generation,
+                                       std::move( ids ) );
+    if ( diagnostics_history_.size() > MAX_DIAGNOSTICS_HISTORY ) {
+      diagnostics_history_.pop_front();
     }
   }
+  latest_diagnostics_ = std::move( diagnostics );
 }
 
 namespace {
@@ -518,7 +1020,7 @@ std::vector< FixIt > TranslationUnit::GetFixItsForLocationInFile(
   bool reparse ) {
 
   if ( reparse ) {
-    Reparse( unsaved_files );
+    ReparseForQuery( unsaved_files );
   }
 
   std::vector< FixIt > fixits;
@@ -526,24 +1028,37 @@ std::vector< FixIt > TranslationUnit::GetFixItsForLocationInFile(
   auto normal_filename = fs::weakly_canonical( filename );
 
   {
-    unique_lock< mutex > lock( diagnostics_mutex_ );
+    // The fixits are not built with the diagnostics past max_diagnostics_ so
+    // get them from the TU.
+    unique_lock< mutex > lock( clang_access_mutex_ );
+
+    size_t num_diagnostics =
+      clang_translation_unit_ ?
+      clang_getNumDiagnostics( clang_translation_unit_ ) : 0;
 
-    for ( const Diagnostic& diagnostic : latest_diagnostics_ ) {
-      auto this_filename = fs::weakly_canonical( diagnostic.location_.filename_ );
+    for ( size_t i = 0; i < num_diagnostics; ++i ) {
+      DiagnosticWrap diagnostic(
+        clang_getDiagnostic( clang_translation_unit_, i ),
+        clang_disposeDiagnostic );
 
-      if ( normal_filename != this_filename ) {
+      CXDiagnosticSeverity severity =
+        clang_getDiagnosticSeverity( diagnostic.get() );
+      if ( severity == CXDiagnostic_Ignored || severity == CXDiagnostic_Note ) {
         continue;
       }
 
       // Find all diagnostics for the supplied line which have FixIts attached
-      if ( diagnostic.location_.line_number_ !=
-             static_cast< size_t >( line ) ) {
+      Location location( clang_getDiagnosticLocation( diagnostic.get() ) );
+      if ( location.line_number_ != static_cast< size_t >( line ) ||
+           normal_filename != fs::weakly_canonical( location.filename_ ) ) {
         continue;
       }
 
+      std::vector< FixIt > diagnostic_fixits =
+        BuildDiagnosticFixIts( diagnostic );
       fixits.insert( fixits.end(),
-                     diagnostic.fixits_.begin(),
-                     diagnostic.fixits_.end() );
+                     diagnostic_fixits.begin(),
+                     diagnostic_fixits.end() );
     }
   }
 
@@ -561,7 +1076,7 @@ DocumentationData TranslationUnit::GetDocsForLocation(
   bool reparse ) {
 
   if ( reparse ) {
-    Reparse( unsaved_files );
+    ReparseForQuery( unsaved_files );
   }
 
   unique_lock< mutex > lock( clang_access_mutex_ );
@@ -18,15 +18,20 @@
 #ifndef TRANSLATIONUNIT_H_XQ7I6SVA
 #define TRANSLATIONUNIT_H_XQ7I6SVA
 
+#include "ClangHelpers.h"
 #include "Diagnostic.h"
 #include "Documentation.h"
 #include "Location.h"
 #include "UnsavedFile.h"
+#include "Utils.h"
 
 #include <clang-c/Index.h>
 
+#include <atomic>
+#include <deque>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace YouCompleteMe {
@@ -43,11 +48,35 @@ public:
   TranslationUnit( const TranslationUnit& ) = delete;
   TranslationUnit& operator=( const TranslationUnit& ) = delete;
 
+  // A double-buffered TU keeps a second libclang TU on which reparses happen.
+  // Queries run on the first one meanwhile and both are swapped when the
+  // reparse is done. Queries asking for a reparse while one is running don't
+  // wait for it: they get slightly stale but instant answers. This costs
+  // twice the memory.
+  //
+  // Only the first |max_diagnostics| diagnostics returned by Reparse have
+  // their extent, formatted text and fixits; zero means all of them. The
+  // others are not displayed anyway. Diagnostics that ycmd never displays,
+  // like "#pragma once in main file", don't count. GetFixItsForLocationInFile
+  // is not affected.
   YCM_EXPORT TranslationUnit(
     const std::string &filename,
     const std::vector< UnsavedFile > &unsaved_files,
     const std::vector< std::string > &flags,
-    CXIndex clang_index );
+    CXIndex clang_index,
+    bool double_buffered = false,
+    size_t max_diagnostics = 0 );
+
+  // Loads a TU saved with Save. libclang can't reparse nor complete such a TU
+  // so the next reparse parses |filename| from scratch. Meanwhile, the other
+  // queries are answered from the saved TU.
+  YCM_EXPORT TranslationUnit(
+    const std::string &filename,
+    const std::vector< std::string > &flags,
+    CXIndex clang_index,
+    const std::string &ast_file,
+    bool double_buffered = false,
+    size_t max_diagnostics = 0 );
 
   YCM_EXPORT ~TranslationUnit();
 
@@ -55,15 +84,40 @@ public:
 
   YCM_EXPORT bool IsCurrentlyUpdating() const;
 
+  // Memory used by clang for this TU in bytes, as measured after the last
+  // parse. Zero for an invalid TU.
+  YCM_EXPORT size_t MemoryUsage() const;
+
+  // Saves the TU to |ast_file|. Returns false on failure.
+  YCM_EXPORT bool Save( const std::string &ast_file );
+
+  // Whether a file the TU depends on was modified after |time|, or no longer
+  // exists.
+  YCM_EXPORT bool DependenciesModifiedAfter( fs::file_time_type time );
+
   YCM_EXPORT std::vector< Diagnostic > Reparse(
     const std::vector< UnsavedFile > &unsaved_files );
 
+  // Same as above but only returns the diagnostics that changed since
+  // |generation|. The last few generations are remembered.
+  YCM_EXPORT DiagnosticsDelta Reparse(
+    const std::vector< UnsavedFile > &unsaved_files,
+    size_t generation );
+
   YCM_EXPORT std::vector< CompletionData > CandidatesForLocation(
     const std::string &filename,
     int line,
     int column,
     const std::vector< UnsavedFile > &unsaved_files );
 
+  // Same as above but returns the raw libclang results, e.g. for filtering
+  // them before building the CompletionData. Null for an invalid TU.
+  YCM_EXPORT CodeCompleteResultsWrap CodeCompleteResultsForLocation(
+    const std::string &filename,
+    int line,
+    int column,
+    const std::vector< UnsavedFile > &unsaved_files );
+
   YCM_EXPORT Location GetDeclarationLocation(
     const std::string &filename,
     int line,
@@ -114,14 +168,46 @@ public:
   bool LocationIsInSystemHeader( const Location &location );
 
 private:
+  CXErrorCode Parse( std::vector< CXUnsavedFile > &unsaved_files,
+                     CXTranslationUnit &translation_unit );
+
   void Reparse( std::vector< CXUnsavedFile > &unsaved_files );
 
+  // Parses or reparses the back TU then swaps it with the front one. When
+  // |wait| is false, returns right away if another reparse is running.
+  void ReparseBackBuffer( std::vector< CXUnsavedFile > &unsaved_files,
+                          bool wait );
+
+  // Called by the queries asking for a reparse.
+  void ReparseForQuery( const std::vector< UnsavedFile > &unsaved_files );
+
   void Reparse( std::vector< CXUnsavedFile > &unsaved_files,
                 size_t parse_options );
 
   void UpdateLatestDiagnostics();
 
-  // These four methods must be called under the clang_access_mutex_ lock.
+  // Must be called under the back_translation_unit_mutex_ and
+  // clang_access_mutex_ locks.
+  void UpdateMemoryUsage();
+
+  // Records what the front TU was parsed from: the contents of the unsaved
+  // files and the modification times of the files it depends on, and gives it
+  // a new parse sequence number. Must be called under the
+  // back_translation_unit_mutex_ and clang_access_mutex_ locks.
+  void UpdateParseInputs( const std::vector< CXUnsavedFile > &unsaved_files );
+
+  // Whether a reparse with |unsaved_files| would give the same front TU. Must
+  // be called under the back_translation_unit_mutex_ lock.
+  bool ParseInputsUnchanged(
+    const std::vector< CXUnsavedFile > &unsaved_files ) const;
+
+  // These five methods must be called under the clang_access_mutex_ lock.
+  CodeCompleteResultsWrap CodeCompleteAt(
+    const std::string &filename,
+    int line,
+    int column,
+    const std::vector< UnsavedFile > &unsaved_files );
+
   CXSourceLocation GetSourceLocation( const std::string& filename,
                                       int line,
                                       int column );
@@ -138,9 +224,40 @@ private:
 
   std::mutex diagnostics_mutex_;
   std::vector< Diagnostic > latest_diagnostics_;
+  // The ids of the diagnostics of the last generations, latest last.
+  std::deque< std::pair< size_t, std::vector< size_t > > >
+    diagnostics_history_;
+  // The parse sequence number of latest_diagnostics_.
+  size_t published_parse_sequence_ = 0;
+
+  std::string filename_;
+  std::vector< std::string > flags_;
+  CXIndex clang_index_;
+  bool double_buffered_;
+  size_t max_diagnostics_;
+
+  // Must be acquired before clang_access_mutex_. Also serializes reparses of
+  // double-buffered TUs.
+  std::mutex back_translation_unit_mutex_;
+  CXTranslationUnit back_translation_unit_;
 
   mutable std::mutex clang_access_mutex_;
   CXTranslationUnit clang_translation_unit_;
+  // Whether clang_translation_unit_ was loaded by clang_createTranslationUnit2.
+  // Guarded by both locks above.
+  bool loaded_from_ast_file_;
+  // Numbers the parses of clang_translation_unit_ so their diagnostics are
+  // published in order. Guarded by both locks above.
+  size_t parse_sequence_ = 0;
+
+  std::atomic< size_t > memory_usage_;
+
+  // Guarded by back_translation_unit_mutex_. The inputs are unknown if
+  // parse_inputs_valid_ is false, e.g. when a header was not found.
+  bool parse_inputs_valid_;
+  size_t unsaved_files_hash_;
+  std::vector< std::pair< std::string, fs::file_time_type > >
+    dependency_times_;
 };
 
 } // namespace YouCompleteMe
@@ -19,12 +19,16 @@
 #include "TranslationUnit.h"
 #include "Utils.h"
 
+#include <algorithm>
 #include <functional>
+#include <random>
+#include <system_error>
 
 using std::lock_guard;
 using std::shared_ptr;
 using std::make_shared;
 using std::mutex;
+using std::unique_lock;
 
 namespace YouCompleteMe {
 
@@ -41,11 +45,128 @@ std::size_t HashForFlags( const std::vector< std::string > &flags ) {
   return seed;
 }
 
+
+fs::path CacheFileFor( const std::string &directory,
+                       const std::string &filename,
+                       std::size_t flags_hash ) {
+  size_t seed = std::hash< std::string >()( filename );
+  seed ^= flags_hash + ( seed << 6 ) + ( seed >> 2 );
+  return fs::path( directory ) / ( std::to_string( seed ) + ".ast" );
+}
+
+
+// Deletes the least recently saved TUs until the directory is not bigger than
+// |max_size| bytes.
+void PruneCache( const fs::path &directory, size_t max_size ) {
+  if ( !max_size ) {
+    return;
+  }
+
+  struct CacheFile {
+    fs::file_time_type time;
+    std::uintmax_t size;
+    fs::path path;
+  };
+  std::vector< CacheFile > cache_files;
+  std::uintmax_t total_size = 0;
+  std::error_code error;
+
+  for ( fs::directory_iterator it( directory, error ), end;
+        !error && it != end;
+        it.increment( error ) ) {
+    const fs::path &path = it->path();
+    if ( path.extension() != ".ast" ) {
+      continue;
+    }
+    std::uintmax_t size = fs::file_size( path, error );
+    fs::file_time_type time = fs::last_write_time( path, error );
+    if ( error ) {
+      // The file may have been removed by another instance.
+      error.clear();
+      continue;
+    }
+    cache_files.push_back( { time, size, path } );
+    total_size += size;
+  }
+
+  std::sort( cache_files.begin(), cache_files.end(),
+             []( const CacheFile &a, const CacheFile &b ) {
+               return a.time < b.time;
+             } );
+
+  for ( const CacheFile &cache_file : cache_files ) {
+    if ( total_size <= max_size ) {
+      break;
+    }
+    fs::remove( cache_file.path, error );
+    total_size -= cache_file.size;
+  }
+}
+
+
+void SaveToCache( TranslationUnit &unit,
+                  const fs::path &cache_file,
+                  size_t max_size ) {
+  std::error_code error;
+  fs::create_directories( cache_file.parent_path(), error );
+
+  // Don't let a concurrent GetOrCreate load a partially written file. Saves of
+  // the same TU may run concurrently.
+  std::random_device random_device;
+  fs::path temporary_file = cache_file;
+  temporary_file += "." + std::to_string( random_device() ) + ".tmp";
+  if ( unit.Save( temporary_file.string() ) ) {
+    fs::rename( temporary_file, cache_file, error );
+  }
+  fs::remove( temporary_file, error );
+
+  PruneCache( cache_file.parent_path(), max_size );
+}
+
+
+// Returns null if there is no saved TU or if it is stale, in which case it is
+// deleted.
+shared_ptr< TranslationUnit > LoadFromCache(
+  const fs::path &cache_file,
+  const std::string &filename,
+  const std::vector< std::string > &flags,
+  CXIndex clang_index,
+  bool double_buffered,
+  size_t max_diagnostics ) {
+  std::error_code error;
+  fs::file_time_type saved_time = fs::last_write_time( cache_file, error );
+  if ( error ) {
+    return nullptr;
+  }
+
+  try {
+    auto unit = make_shared< TranslationUnit >( filename,
+                                                flags,
+                                                clang_index,
+                                                cache_file.string(),
+                                                double_buffered,
+                                                max_diagnostics );
+    if ( !unit->DependenciesModifiedAfter( saved_time ) ) {
+      return unit;
+    }
+  } catch ( const ClangParseError & ) {
+    // Fall through to delete the file.
+  }
+
+  fs::remove( cache_file, error );
+  return nullptr;
+}
+
 }  // unnamed namespace
 
 
 TranslationUnitStore::TranslationUnitStore( CXIndex clang_index )
-  : clang_index_( clang_index ) {
+  : clang_index_( clang_index ),
+    access_counter_( 0 ),
+    memory_budget_( 0 ),
+    double_buffered_( false ),
+    max_diagnostics_( 0 ),
+    cache_size_( 0 ) {
 }
 
 
@@ -68,14 +189,46 @@ shared_ptr< TranslationUnit > TranslationUnitStore::GetOrCreate(
   const std::vector< UnsavedFile > &unsaved_files,
   const std::vector< std::string > &flags,
   bool &translation_unit_created ) {
+  return GetOrCreate( filename,
+                      unsaved_files,
+                      flags,
+                      std::chrono::steady_clock::time_point::min(),
+                      translation_unit_created );
+}
+
+
+shared_ptr< TranslationUnit > TranslationUnitStore::GetOrCreate(
+  const std::string &filename,
+  const std::vector< UnsavedFile > &unsaved_files,
+  const std::vector< std::string > &flags,
+  std::chrono::steady_clock::time_point deadline,
+  bool &translation_unit_created ) {
   translation_unit_created = false;
+  std::vector< shared_ptr< TranslationUnit > > evicted_units;
+  bool double_buffered;
+  size_t max_diagnostics;
+  std::string cache_directory;
+  size_t cache_size;
   {
-    lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+    unique_lock< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+    filename_to_access_time_[ filename ] = ++access_counter_;
     shared_ptr< TranslationUnit > current_unit = GetNoLock( filename );
 
-    if ( current_unit &&
-         HashForFlags( flags ) == filename_to_flags_hash_[ filename ] ) {
-      return current_unit;
+    while ( current_unit &&
+            HashForFlags( flags ) == filename_to_flags_hash_[ filename ] ) {
+      if ( !WaitForCreation( lock, filename, deadline ) ) {
+        // The sentinel TU.
+        return current_unit;
+      }
+
+      // The TU may have been replaced or removed while waiting.
+      shared_ptr< TranslationUnit > unit = GetNoLock( filename );
+      if ( unit == current_unit ) {
+        // The TU may have grown since the last call.
+        EvictNoLock( evicted_units );
+        return current_unit;
+      }
+      current_unit = std::move( unit );
     }
 
     // We create and store an invalid, sentinel TU so that other threads don't
@@ -84,28 +237,61 @@ shared_ptr< TranslationUnit > TranslationUnitStore::GetOrCreate(
     // with the valid object.
     filename_to_translation_unit_[ filename ] =
       make_shared< TranslationUnit >();
+    filenames_being_created_.insert( filename );
 
     // We need to store the flags for the sentinel TU so that other threads end
     // up returning the sentinel TU while the real one is being created.
     filename_to_flags_hash_[ filename ] = HashForFlags( flags );
+    double_buffered = double_buffered_;
+    max_diagnostics = max_diagnostics_;
+    cache_directory = cache_directory_;
+    cache_size = cache_size_;
   }
 
   shared_ptr< TranslationUnit > unit;
+  fs::path cache_file;
 
-  try {
-    unit = make_shared< TranslationUnit >( filename,
-                                           unsaved_files,
-                                           flags,
-                                           clang_index_ );
-  } catch ( const ClangParseError & ) {
-    Remove( filename );
-    throw;
+  if ( !cache_directory.empty() && double_buffered ) {
+    cache_file = CacheFileFor( cache_directory,
+                               filename,
+                               HashForFlags( flags ) );
+    unit = LoadFromCache( cache_file,
+                          filename,
+                          flags,
+                          clang_index_,
+                          double_buffered,
+                          max_diagnostics );
+  }
+
+  if ( !unit ) {
+    try {
+      unit = make_shared< TranslationUnit >( filename,
+                                             unsaved_files,
+                                             flags,
+                                             clang_index_,
+                                             double_buffered,
+                                             max_diagnostics );
+    } catch ( const ClangParseError & ) {
+      Remove( filename );
+      throw;
+    }
+  } else {
+    // Already saved.
+    cache_file.clear();
   }
 
   {
     lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
     filename_to_translation_unit_[ filename ] = unit;
+    filenames_being_created_.erase( filename );
     // Flags have already been stored.
+    EvictNoLock( evicted_units );
+  }
+  translation_unit_created_.notify_all();
+
+  // Saving can take longer than parsing so it's done once the TU is usable.
+  if ( !cache_file.empty() ) {
+    SaveToCacheAsync( unit, std::move( cache_file ), cache_size );
   }
 
   translation_unit_created = true;
@@ -120,17 +306,103 @@ shared_ptr< TranslationUnit > TranslationUnitStore::Get(
 }
 
 
+shared_ptr< TranslationUnit > TranslationUnitStore::Get(
+  const std::string &filename,
+  std::chrono::steady_clock::time_point deadline ) {
+  unique_lock< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+  WaitForCreation( lock, filename, deadline );
+  return GetNoLock( filename );
+}
+
+
 bool TranslationUnitStore::Remove( const std::string &filename ) {
-  lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
-  Erase( filename_to_flags_hash_, filename );
-  return Erase( filename_to_translation_unit_, filename );
+  shared_ptr< TranslationUnit > unit;
+  fs::path cache_file;
+  size_t cache_size;
+  {
+    lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+    unit = GetNoLock( filename );
+    if ( unit && !cache_directory_.empty() && double_buffered_ &&
+         !ContainsKey( filenames_being_created_, filename ) ) {
+      cache_file = CacheFileFor( cache_directory_,
+                                 filename,
+                                 filename_to_flags_hash_[ filename ] );
+      cache_size = cache_size_;
+    }
+    Erase( filename_to_flags_hash_, filename );
+    Erase( filename_to_access_time_, filename );
+    Erase( filenames_being_created_, filename );
+    Erase( filename_to_translation_unit_, filename );
+  }
+  translation_unit_created_.notify_all();
+
+  // Invalid TUs are not saved.
+  bool removed = unit != nullptr;
+  if ( !cache_file.empty() ) {
+    SaveToCacheAsync( std::move( unit ), std::move( cache_file ), cache_size );
+  }
+  return removed;
 }
 
 
 void TranslationUnitStore::RemoveAll() {
+  {
+    lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+    filename_to_translation_unit_.clear();
+    filename_to_flags_hash_.clear();
+    filename_to_access_time_.clear();
+    filenames_being_created_.clear();
+  }
+  translation_unit_created_.notify_all();
+  WaitForCacheSaves();
+}
+
+
+void TranslationUnitStore::SetMemoryBudget( size_t memory_budget ) {
+  std::vector< shared_ptr< TranslationUnit > > evicted_units;
+  lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+  memory_budget_ = memory_budget;
+  EvictNoLock( evicted_units );
+}
+
+
+void TranslationUnitStore::SetEvictionCallback(
+  std::function< void( const std::string & ) > callback ) {
+  lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+  eviction_callback_ = std::move( callback );
+}
+
+
+void TranslationUnitStore::SetPinnedFiles(
+  const std::vector< std::string > &filenames ) {
+  lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+  pinned_filenames_ = { filenames.begin(), filenames.end() };
+}
+
+
+void TranslationUnitStore::SetDoubleBuffered( bool double_buffered ) {
+  lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+  double_buffered_ = double_buffered;
+}
+
+
+void TranslationUnitStore::SetMaxDiagnostics( size_t max_diagnostics ) {
+  lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
+  max_diagnostics_ = max_diagnostics;
+}
+
+
+void TranslationUnitStore::SetCacheDirectory( const std::string &directory,
+                                              size_t max_size ) {
   lock_guard< mutex > lock( filename_to_translation_unit_and_flags_mutex_ );
-  filename_to_translation_unit_.clear();
-  filename_to_flags_hash_.clear();
+  cache_directory_ = directory;
+  cache_size_ = max_size;
+}
+
+
+void TranslationUnitStore::WaitForCacheSaves() {
+  lock_guard< mutex > lock( cache_saves_mutex_ );
+  cache_saves_.Wait();
 }
 
 
@@ -141,4 +413,77 @@ shared_ptr< TranslationUnit > TranslationUnitStore::GetNoLock(
                           shared_ptr< TranslationUnit >() );
 }
 
+
+bool TranslationUnitStore::WaitForCreation(
+  unique_lock< mutex > &lock,
+  const std::string &filename,
+  std::chrono::steady_clock::time_point deadline ) {
+  auto is_created = [ & ] {
+    return !ContainsKey( filenames_being_created_, filename );
+  };
+  if ( deadline <= std::chrono::steady_clock::now() ) {
+    return is_created();
+  }
+  return translation_unit_created_.wait_until( lock, deadline, is_created );
+}
+
+
+void TranslationUnitStore::EvictNoLock(
+  std::vector< shared_ptr< TranslationUnit > > &evicted_units ) {
+  if ( !memory_budget_ ) {
+    return;
+  }
+
+  size_t memory_usage = 0;
+  for ( const auto &filename_and_unit : filename_to_translation_unit_ ) {
+    memory_usage += filename_and_unit.second->MemoryUsage();
+  }
+
+  while ( memory_usage > memory_budget_ ) {
+    // A TU is in use if referenced outside the store. New references can only
+    // be taken under the lock. Sentinel TUs are always updating.
+    auto lru_unit = filename_to_translation_unit_.end();
+    std::uint64_t lru_access_time = 0;
+    for ( auto it = filename_to_translation_unit_.begin();
+          it != filename_to_translation_unit_.end(); ++it ) {
+      std::uint64_t access_time = filename_to_access_time_[ it->first ];
+      if ( ContainsKey( pinned_filenames_, it->first ) ||
+           it->second.use_count() > 1 ||
+           it->second->IsCurrentlyUpdating() ||
+           ( lru_unit != filename_to_translation_unit_.end() &&
+             access_time >= lru_access_time ) ) {
+        continue;
+      }
+      lru_unit = it;
+      lru_access_time = access_time;
+    }
+
+    if ( lru_unit == filename_to_translation_unit_.end() ) {
+      return;
+    }
+
+    memory_usage -= lru_unit->second->MemoryUsage();
+    if ( eviction_callback_ ) {
+      eviction_callback_( lru_unit->first );
+    }
+    Erase( filename_to_flags_hash_, lru_unit->first );
+    Erase( filename_to_access_time_, lru_unit->first );
+    evicted_units.push_back( std::move( lru_unit->second ) );
+    filename_to_translation_unit_.erase( lru_unit );
+  }
+}
+
+
+void TranslationUnitStore::SaveToCacheAsync(
+  shared_ptr< TranslationUnit > unit,
+  fs::path cache_file,
+  size_t cache_size ) {
+  lock_guard< mutex > lock( cache_saves_mutex_ );
+  cache_saves_.Submit(
+    [ unit = std::move( unit ), cache_file = std::move( cache_file ),
+      cache_size ] {
+      SaveToCache( *unit, cache_file, cache_size );
+    }, TaskPriority::LOW );
+}
+
 } // namespace YouCompleteMe
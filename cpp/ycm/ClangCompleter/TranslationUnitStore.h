@@ -18,13 +18,19 @@
 #ifndef TRANSLATIONUNITSTORE_H_NGN0MCKB
 #define TRANSLATIONUNITSTORE_H_NGN0MCKB
 
+#include "ThreadPool.h"
 #include "TranslationUnit.h"
 #include "UnsavedFile.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 using CXIndex = void*;
@@ -51,31 +57,128 @@ public:
     const std::vector< std::string > &flags,
     bool &translation_unit_created );
 
+  // While a TU is being created, the functions above return an invalid,
+  // sentinel TU to the other callers. This one instead waits for the TU being
+  // created with the same flags until |deadline| and only returns the sentinel
+  // TU if it passes.
+  YCM_EXPORT std::shared_ptr< TranslationUnit > GetOrCreate(
+    const std::string &filename,
+    const std::vector< UnsavedFile > &unsaved_files,
+    const std::vector< std::string > &flags,
+    std::chrono::steady_clock::time_point deadline,
+    bool &translation_unit_created );
+
   // Careful here! While GetOrCreate makes sure to take into account the flags
   // for the file before returning a stored TU (if the flags changed, the TU is
   // not really valid anymore and a new one should be built), this function does
   // not. You might end up getting a stale TU.
   std::shared_ptr< TranslationUnit > Get( const std::string &filename );
 
+  // Same as above but waits until |deadline| if the TU is being created.
+  YCM_EXPORT std::shared_ptr< TranslationUnit > Get(
+    const std::string &filename,
+    std::chrono::steady_clock::time_point deadline );
+
   bool Remove( const std::string &filename );
 
   void RemoveAll();
 
+  // When the memory used by the stored TUs exceeds |memory_budget| bytes, the
+  // least recently used TUs that are not pinned nor in use are evicted. They
+  // are created again by the next GetOrCreate call for their file. Zero means
+  // no limit, which is the default.
+  YCM_EXPORT void SetMemoryBudget( size_t memory_budget );
+
+  // Called with the filename of each evicted TU, under the lock of the store:
+  // it must not call the store.
+  YCM_EXPORT void SetEvictionCallback(
+    std::function< void( const std::string & ) > callback );
+
+  // The TUs of these files are never evicted, e.g. those of visible buffers.
+  // Replaces the previously pinned files.
+  YCM_EXPORT void SetPinnedFiles( const std::vector< std::string > &filenames );
+
+  // Whether the TUs created from now on are double-buffered. See the
+  // TranslationUnit constructor. Disabled by default.
+  YCM_EXPORT void SetDoubleBuffered( bool double_buffered );
+
+  // The |max_diagnostics| argument of the TUs created from now on. See the
+  // TranslationUnit constructor. Zero by default.
+  YCM_EXPORT void SetMaxDiagnostics( size_t max_diagnostics );
+
+  // When |directory| is not empty, the double-buffered TUs parsed by
+  // GetOrCreate and those removed with Remove are saved in it on the thread
+  // pool. GetOrCreate then loads the saved TU instead of parsing the file,
+  // e.g. after a restart, if none of the files it depends on was modified
+  // since it was saved. The least recently saved TUs are deleted when the
+  // directory grows over |max_size| bytes; zero means no limit. Disabled by
+  // default.
+  //
+  // libclang can neither reparse nor complete a loaded TU: the first reparse
+  // parses the file from scratch and, until it is done, the loaded TU reflects
+  // the files on disk, not the unsaved ones. Only double-buffered TUs keep
+  // answering queries from the loaded TU during that parse, so the TUs of the
+  // other ones are neither saved nor loaded.
+  YCM_EXPORT void SetCacheDirectory( const std::string &directory,
+                                     size_t max_size );
+
+  // Waits for the TUs being saved in the cache directory. Saves that didn't
+  // start yet are run on the calling thread.
+  YCM_EXPORT void WaitForCacheSaves();
+
 private:
 
   // WARNING: This accesses filename_to_translation_unit_ without a lock!
   std::shared_ptr< TranslationUnit > GetNoLock( const std::string &filename );
 
+  // Waits until the TU of |filename| is not being created anymore or until
+  // |deadline|. Returns false if the deadline passed.
+  bool WaitForCreation( std::unique_lock< std::mutex > &lock,
+                        const std::string &filename,
+                        std::chrono::steady_clock::time_point deadline );
+
+  // WARNING: This accesses filename_to_translation_unit_ without a lock!
+  // Evicted TUs are moved to |evicted_units| so that they are destroyed after
+  // releasing the lock.
+  void EvictNoLock(
+    std::vector< std::shared_ptr< TranslationUnit > > &evicted_units );
+
+  // Saves |unit| in |cache_file| on the thread pool.
+  void SaveToCacheAsync( std::shared_ptr< TranslationUnit > unit,
+                         fs::path cache_file,
+                         size_t cache_size );
+
 
   using TranslationUnitForFilename =
     std::unordered_map< std::string, std::shared_ptr< TranslationUnit > >;
 
   using FlagsHashForFilename = std::unordered_map< std::string, std::size_t >;
 
+  using AccessTimeForFilename =
+    std::unordered_map< std::string, std::uint64_t >;
+
   CXIndex clang_index_;
   TranslationUnitForFilename filename_to_translation_unit_;
   FlagsHashForFilename filename_to_flags_hash_;
+  // Value of access_counter_ at the last GetOrCreate call for the file.
+  AccessTimeForFilename filename_to_access_time_;
+  std::uint64_t access_counter_;
+  size_t memory_budget_;
+  std::unordered_set< std::string > pinned_filenames_;
+  std::function< void( const std::string & ) > eviction_callback_;
+  bool double_buffered_;
+  size_t max_diagnostics_;
+  std::string cache_directory_;
+  size_t cache_size_;
+  // Files whose TU is being created; their stored TU is a sentinel.
+  std::unordered_set< std::string > filenames_being_created_;
   std::mutex filename_to_translation_unit_and_flags_mutex_;
+  // Notified when a TU creation finishes, successfully or not.
+  std::condition_variable translation_unit_created_;
+
+  // They hold the TUs they save, which must be destroyed before the index.
+  TaskGroup cache_saves_;
+  std::mutex cache_saves_mutex_;
 };
 
 } // namespace YouCompleteMe
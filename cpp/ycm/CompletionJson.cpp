@@ -0,0 +1,180 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CompletionJson.h"
+
+namespace YouCompleteMe {
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+
+// Returns the length of the valid UTF-8 sequence at the start of |text| or 0 if
+// there is none.
+size_t Utf8SequenceLength( std::string_view text ) {
+  auto byte = [ &text ]( size_t index ) {
+    return static_cast< uint8_t >( text[ index ] );
+  };
+  auto is_continuation = [ &text, &byte ]( size_t index ) {
+    return index < text.size() && ( byte( index ) & 0xc0 ) == 0x80;
+  };
+
+  uint8_t lead = byte( 0 );
+  if ( lead < 0x80 ) {
+    return 1;
+  }
+  if ( 0xc2 <= lead && lead <= 0xdf ) {
+    return is_continuation( 1 ) ? 2 : 0;
+  }
+  if ( 0xe0 <= lead && lead <= 0xef ) {
+    if ( !is_continuation( 1 ) || !is_continuation( 2 ) ||
+         // Overlong encodings.
+         ( lead == 0xe0 && byte( 1 ) < 0xa0 ) ||
+         // Surrogates.
+         ( lead == 0xed && byte( 1 ) > 0x9f ) ) {
+      return 0;
+    }
+    return 3;
+  }
+  if ( 0xf0 <= lead && lead <= 0xf4 ) {
+    if ( !is_continuation( 1 ) || !is_continuation( 2 ) ||
+         !is_continuation( 3 ) ||
+         // Overlong encodings.
+         ( lead == 0xf0 && byte( 1 ) < 0x90 ) ||
+         // Code points above U+10FFFF.
+         ( lead == 0xf4 && byte( 1 ) > 0x8f ) ) {
+      return 0;
+    }
+    return 4;
+  }
+  return 0;
+}
+
+
+void AppendJsonField( std::string_view key,
+                      std::string_view value,
+                      std::string &json ) {
+  json.push_back( ',' );
+  AppendJsonString( key, json );
+  json.push_back( ':' );
+  AppendJsonString( value, json );
+}
+
+} // unnamed namespace
+
+
+void AppendJsonString( std::string_view text, std::string &json ) {
+  json.reserve( json.size() + text.size() + 2 );
+  json.push_back( '"' );
+
+  while ( !text.empty() ) {
+    auto character = static_cast< uint8_t >( text[ 0 ] );
+
+    switch ( character ) {
+      case '"':
+        json.append( "\\\"" );
+        break;
+      case '\\':
+        json.append( "\\\\" );
+        break;
+      case '\b':
+        json.append( "\\b" );
+        break;
+      case '\f':
+        json.append( "\\f" );
+        break;
+      case '\n':
+        json.append( "\\n" );
+        break;
+      case '\r':
+        json.append( "\\r" );
+        break;
+      case '\t':
+        json.append( "\\t" );
+        break;
+      default:
+        if ( character < 0x20 ) {
+          json.append( "\\u00" );
+          json.push_back( HEX_DIGITS[ character >> 4 ] );
+          json.push_back( HEX_DIGITS[ character & 0xf ] );
+          break;
+        }
+
+        size_t length = Utf8SequenceLength( text );
+        if ( length == 0 ) {
+          json.append( "\\ufffd" );
+          length = 1;
+        } else {
+          json.append( text.substr( 0, length ) );
+        }
+        text.remove_prefix( length );
+        continue;
+    }
+
+    text.remove_prefix( 1 );
+  }
+
+  json.push_back( '"' );
+}
+
+
+void CompletionJsonBuilder::Add( std::string_view insertion_text,
+                                 std::string_view extra_menu_info,
+                                 std::string_view menu_text,
+                                 std::string_view detailed_info,
+                                 std::string_view kind,
+                                 std::string_view extra_data ) {
+  if ( size_ > 0 ) {
+    json_.push_back( ',' );
+  }
+  ++size_;
+
+  json_.append( "{\"insertion_text\":" );
+  AppendJsonString( insertion_text, json_ );
+
+  if ( !extra_menu_info.empty() ) {
+    AppendJsonField( "extra_menu_info", extra_menu_info, json_ );
+  }
+  if ( !menu_text.empty() ) {
+    AppendJsonField( "menu_text", menu_text, json_ );
+  }
+  if ( !detailed_info.empty() ) {
+    AppendJsonField( "detailed_info", detailed_info, json_ );
+  }
+  if ( !kind.empty() ) {
+    AppendJsonField( "kind", kind, json_ );
+  }
+  if ( !extra_data.empty() ) {
+    json_.append( ",\"extra_data\":" );
+    json_.append( extra_data );
+  }
+
+  json_.push_back( '}' );
+}
+
+
+std::string CompletionJsonBuilder::Build() const {
+  std::string json;
+  json.reserve( json_.size() + 2 );
+  json.push_back( '[' );
+  json.append( json_ );
+  json.push_back( ']' );
+  return json;
+}
+
+} // namespace YouCompleteMe
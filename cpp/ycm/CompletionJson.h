@@ -0,0 +1,64 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef COMPLETIONJSON_H_Q5XN8ZBE
+#define COMPLETIONJSON_H_Q5XN8ZBE
+
+#include <string>
+#include <string_view>
+
+namespace YouCompleteMe {
+
+// Appends |text| to |json| as a JSON string. Invalid UTF-8 sequences are
+// replaced by U+FFFD.
+YCM_EXPORT void AppendJsonString( std::string_view text, std::string &json );
+
+
+// Builds a JSON array of completions with the same keys as
+// responses.BuildCompletionData so that it can be spliced as is into a
+// completion response instead of building a Python dict per completion.
+class CompletionJsonBuilder {
+public:
+  CompletionJsonBuilder() = default;
+  CompletionJsonBuilder( const CompletionJsonBuilder& ) = delete;
+  CompletionJsonBuilder& operator=( const CompletionJsonBuilder& ) = delete;
+
+  // Like in BuildCompletionData, empty fields are omitted. |extra_data| must be
+  // a JSON object or empty.
+  YCM_EXPORT void Add( std::string_view insertion_text,
+                       std::string_view extra_menu_info = {},
+                       std::string_view menu_text = {},
+                       std::string_view detailed_info = {},
+                       std::string_view kind = {},
+                       std::string_view extra_data = {} );
+
+  inline size_t Size() const {
+    return size_;
+  }
+
+  // Returns the JSON array of the added completions.
+  YCM_EXPORT std::string Build() const;
+
+private:
+  // The comma-separated completions, without the enclosing brackets.
+  std::string json_;
+  size_t size_ = 0;
+};
+
+} // namespace YouCompleteMe
+
+#endif /* end of include guard: COMPLETIONJSON_H_Q5XN8ZBE */
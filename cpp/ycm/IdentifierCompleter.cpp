@@ -18,12 +18,29 @@
 #include "IdentifierCompleter.h"
 
 #include "Candidate.h"
+#include "CompletionJson.h"
 #include "IdentifierUtils.h"
+#include "LatencyHistogram.h"
 #include "Result.h"
 #include "Utils.h"
 
 namespace YouCompleteMe {
 
+namespace {
+
+std::vector< std::string > ResultTexts( const std::vector< Result > &results ) {
+  std::vector< std::string > candidates;
+  candidates.reserve( results.size() );
+
+  for ( const Result & result : results ) {
+    candidates.emplace_back( result.Text() );
+  }
+
+  return candidates;
+}
+
+} // unnamed namespace
+
 
 IdentifierCompleter::IdentifierCompleter(
   std::vector< std::string > candidates ) {
@@ -72,6 +89,36 @@ void IdentifierCompleter::AddIdentifiersToDatabaseFromTagFiles(
 }
 
 
+bool IdentifierCompleter::SaveSnapshot(
+  const std::string &path_to_snapshot ) const {
+  return WriteIdentifiersToSnapshotFile( identifier_database_.GetIdentifiers(),
+                                         path_to_snapshot );
+}
+
+
+bool IdentifierCompleter::LoadSnapshot( const std::string &path_to_snapshot ) {
+  FiletypeIdentifierMap filetype_identifier_map =
+    ReadIdentifiersFromSnapshotFile( path_to_snapshot );
+
+  if ( filetype_identifier_map.empty() ) {
+    return false;
+  }
+
+  identifier_database_.AddIdentifiers( std::move( filetype_identifier_map ) );
+  return true;
+}
+
+
+void IdentifierCompleter::SetCandidateIndexEnabled( bool enabled ) {
+  identifier_database_.SetUseCandidateIndex( enabled );
+}
+
+
+void IdentifierCompleter::SetSpeculativeQueriesEnabled( bool enabled ) {
+  identifier_database_.SetUseSpeculativeQueries( enabled );
+}
+
+
 std::vector< std::string > IdentifierCompleter::CandidatesForQuery(
   std::string&& query,
   const size_t max_candidates ) const {
@@ -82,22 +129,122 @@ std::vector< std::string > IdentifierCompleter::CandidatesForQuery(
 std::vector< std::string > IdentifierCompleter::CandidatesForQueryAndType(
   std::string query,
   const std::string &filetype,
-  const size_t max_candidates ) const {
+  const size_t max_candidates,
+  const QueryOptions &options ) const {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "IdentifierCompleter::CandidatesForQueryAndType" );
+  ScopedLatencyTimer timer( latency );
 
   std::vector< Result > results =
     identifier_database_.ResultsForQueryAndType( std::move( query ),
                                                  filetype,
-                                                 max_candidates );
+                                                 max_candidates,
+                                                 options );
 
-  std::vector< std::string > candidates;
+  return ResultTexts( results );
+}
+
+
+std::vector< std::pair< std::string, MatchPositions > >
+IdentifierCompleter::CandidatesWithMatchPositionsForQueryAndType(
+  std::string query,
+  const std::string &filetype,
+  const size_t max_candidates,
+  const QueryOptions &options ) const {
+
+  // Results don't own their query so keep one for computing the positions.
+  Word query_object{ std::string( query ) };
+  std::vector< Result > results =
+    identifier_database_.ResultsForQueryAndType( std::move( query ),
+                                                 filetype,
+                                                 max_candidates,
+                                                 options );
+
+  std::vector< std::pair< std::string, MatchPositions > > candidates;
   candidates.reserve( results.size() );
 
   for ( const Result & result : results ) {
-    candidates.emplace_back( result.Text() );
+    candidates.emplace_back(
+      result.Text(),
+      result.GetCandidate()->QueryMatchPositions( query_object ) );
   }
 
   return candidates;
 }
 
 
+std::pair< std::vector< std::string >, bool >
+IdentifierCompleter::CandidatesForQueryAndTypeWithDeadline(
+  std::string query,
+  const std::string &filetype,
+  const std::string &filepath,
+  const size_t max_candidates,
+  const size_t time_budget_ms ) const {
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds( time_budget_ms );
+  bool is_complete;
+  std::vector< Result > results =
+    identifier_database_.ResultsForQueryAndTypeWithDeadline( std::move( query ),
+                                                             filetype,
+                                                             filepath,
+                                                             max_candidates,
+                                                             deadline,
+                                                             is_complete );
+
+  return { ResultTexts( results ), is_complete };
+}
+
+
+std::vector< std::string >
+IdentifierCompleter::CandidatesForQueryAndTypeInPaths(
+  std::string query,
+  const std::string &filetype,
+  const std::vector< std::string > &filepaths,
+  const std::string &path_prefix,
+  const size_t max_candidates,
+  const size_t min_candidates,
+  const QueryOptions &options ) const {
+
+  std::vector< Result > results =
+    identifier_database_.ResultsForQueryAndTypeInPaths( std::move( query ),
+                                                        filetype,
+                                                        filepaths,
+                                                        path_prefix,
+                                                        max_candidates,
+                                                        min_candidates,
+                                                        options );
+
+  return ResultTexts( results );
+}
+
+
+std::string IdentifierCompleter::CompletionsJsonForQueryAndType(
+  std::string query,
+  const std::string &filetype,
+  const size_t max_candidates,
+  const size_t min_candidate_chars,
+  const std::string &extra_menu_info ) const {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "IdentifierCompleter::CompletionsJsonForQueryAndType" );
+  ScopedLatencyTimer timer( latency );
+
+  QueryOptions options;
+  options.min_candidate_chars = min_candidate_chars;
+  std::vector< Result > results =
+    identifier_database_.ResultsForQueryAndType( std::move( query ),
+                                                 filetype,
+                                                 max_candidates,
+                                                 options );
+
+  CompletionJsonBuilder completions;
+
+  for ( const Result & result : results ) {
+    completions.Add( result.Text(), extra_menu_info );
+  }
+
+  return completions.Build();
+}
+
+
 } // namespace YouCompleteMe
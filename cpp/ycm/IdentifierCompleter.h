@@ -21,6 +21,7 @@
 #include "IdentifierDatabase.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 
@@ -43,14 +44,14 @@ public:
                        std::string&& filetype,
                        std::string&& filepath );
 
-  void AddIdentifiersToDatabase(
+  YCM_EXPORT void AddIdentifiersToDatabase(
     std::vector< std::string > new_candidates,
     std::string& filetype,
     std::string& filepath );
 
   // Same as above, but clears all identifiers stored for the file before adding
   // new identifiers.
-  void ClearForFileAndAddIdentifiersToDatabase(
+  YCM_EXPORT void ClearForFileAndAddIdentifiersToDatabase(
     std::vector< std::string > new_candidates,
     std::string& filetype,
     std::string& filepath );
@@ -58,6 +59,24 @@ public:
   YCM_EXPORT void AddIdentifiersToDatabaseFromTagFiles(
     std::vector< std::string >& absolute_paths_to_tag_files );
 
+  // Saves all the identifiers of the database to a binary snapshot file so that
+  // they can be restored with LoadSnapshot, e.g. after a restart. Returns false
+  // if the snapshot couldn't be written.
+  YCM_EXPORT bool SaveSnapshot( const std::string &path_to_snapshot ) const;
+
+  // Adds the identifiers stored in a snapshot file to the database. Returns
+  // false if no identifiers were loaded, e.g. because the snapshot is missing,
+  // corrupted, or from another version.
+  YCM_EXPORT bool LoadSnapshot( const std::string &path_to_snapshot );
+
+  // Maintains an index of the identifiers to speed up queries on big databases
+  // at the cost of more memory. Results are the same with or without it.
+  YCM_EXPORT void SetCandidateIndexEnabled( bool enabled );
+
+  // Precomputes in the background the candidates for the next keystroke after
+  // each query. Results are the same with or without it.
+  YCM_EXPORT void SetSpeculativeQueriesEnabled( bool enabled );
+
   // Only provided for tests!
   YCM_EXPORT std::vector< std::string > CandidatesForQuery(
     std::string&& query,
@@ -66,7 +85,55 @@ public:
   YCM_EXPORT std::vector< std::string > CandidatesForQueryAndType(
     std::string query,
     const std::string &filetype,
-    const size_t max_candidates = 0 ) const;
+    const size_t max_candidates = 0,
+    const QueryOptions &options = QueryOptions() ) const;
+
+  // Same as above but also returns the positions of the characters matched by
+  // the query in each candidate, e.g. to highlight them. Positions are only
+  // computed for the returned candidates.
+  YCM_EXPORT std::vector< std::pair< std::string, MatchPositions > >
+  CandidatesWithMatchPositionsForQueryAndType(
+    std::string query,
+    const std::string &filetype,
+    const size_t max_candidates = 0,
+    const QueryOptions &options = QueryOptions() ) const;
+
+  // Same as CandidatesForQueryAndType but gives up scanning the identifiers
+  // after |time_budget_ms| milliseconds and returns the best candidates found
+  // so far, along with a boolean that is false if the candidates may be
+  // incomplete. Identifiers from |filepath| are scanned first.
+  YCM_EXPORT std::pair< std::vector< std::string >, bool >
+  CandidatesForQueryAndTypeWithDeadline(
+    std::string query,
+    const std::string &filetype,
+    const std::string &filepath,
+    const size_t max_candidates,
+    const size_t time_budget_ms ) const;
+
+  // Same as CandidatesForQueryAndType but only considers the identifiers from
+  // the files in |filepaths| and from the files under the directory
+  // |path_prefix| (if not empty), unless that gives fewer than
+  // |min_candidates| candidates, in which case all the identifiers are
+  // considered.
+  YCM_EXPORT std::vector< std::string > CandidatesForQueryAndTypeInPaths(
+    std::string query,
+    const std::string &filetype,
+    const std::vector< std::string > &filepaths,
+    const std::string &path_prefix,
+    const size_t max_candidates = 0,
+    const size_t min_candidates = 0,
+    const QueryOptions &options = QueryOptions() ) const;
+
+  // Same as CandidatesForQueryAndType but returns the candidates as a JSON
+  // array of completions (see CompletionJsonBuilder) with |extra_menu_info|
+  // set on each of them. Candidates with less than |min_candidate_chars|
+  // characters are dropped.
+  YCM_EXPORT std::string CompletionsJsonForQueryAndType(
+    std::string query,
+    const std::string &filetype,
+    const size_t max_candidates,
+    const size_t min_candidate_chars,
+    const std::string &extra_menu_info ) const;
 
 private:
 
@@ -18,32 +18,163 @@
 #include "IdentifierDatabase.h"
 
 #include "Candidate.h"
+#include "CandidateIndex.h"
 #include "CandidateRepository.h"
 #include "IdentifierUtils.h"
+#include "QueryStatistics.h"
 #include "Result.h"
+#include "ThreadPool.h"
 #include "Utils.h"
 
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <iterator>
 #include <memory>
 #include <unordered_set>
 
 namespace YouCompleteMe {
 
+namespace {
+
+// Number of candidates visited between two checks of the deadline. Reading the
+// clock is cheap but not free compared to matching a single candidate.
+const size_t DEADLINE_CHECK_INTERVAL = 256;
+
+// Number of candidates scanned by a speculation between two checks for
+// cancellation.
+const size_t SPECULATION_CHECK_INTERVAL = 256;
+
+
+void AddResultIfMatch( const Candidate *candidate,
+                       const Word &query,
+                       std::vector< Result > &results,
+                       const QueryOptions &options = QueryOptions() ) {
+  Result result = candidate->FilteredQueryMatchResult( query, options );
+  if ( result.IsSubsequence() ) {
+    results.push_back( result );
+  }
+}
+
+
+bool IsPathSeparator( char character ) {
+#ifdef _WIN32
+  return character == '/' || character == '\\';
+#else
+  return character == '/';
+#endif
+}
+
+
+// Whether |path| is |directory| or is under it. "/src/foo" doesn't contain
+// "/src/foobar/x.cpp".
+bool IsInDirectory( const std::string &path, const std::string &directory ) {
+  return path.compare( 0, directory.size(), directory ) == 0 &&
+         ( path.size() == directory.size() ||
+           IsPathSeparator( directory.back() ) ||
+           IsPathSeparator( path[ directory.size() ] ) );
+}
+
+
+// Returns the index of the candidate character following the last character
+// matched by the query. The query must be a subsequence of the candidate.
+size_t MatchEnd( const Candidate &candidate, const Word &query ) {
+  const CharacterSequence &query_characters = query.Characters();
+  const CharacterSequence &candidate_characters = candidate.Characters();
+
+  size_t candidate_index = 0;
+  for ( size_t query_index = 0; query_index < query_characters.size();
+        ++candidate_index ) {
+    if ( query_characters[ query_index ]->MatchesSmart(
+           *candidate_characters[ candidate_index ] ) ) {
+      ++query_index;
+    }
+  }
+  return candidate_index;
+}
+
+} // unnamed namespace
+
+// Candidates matching a query, computed in the background for the next query.
+struct IdentifierDatabase::Speculation {
+  std::string filetype;
+  CharacterSequence query_characters;
+  size_t identifiers_generation;
+
+  // All the candidates matching the query.
+  std::vector< const Candidate * > candidates;
+
+  // Candidates matching the query followed by an ASCII character, indexed by
+  // the base of that character. A query character can only match candidate
+  // characters with the same ASCII base (see Character::AsciiBase).
+  std::array< std::vector< const Candidate * >, NON_ASCII_BASE >
+    candidates_by_next_base;
+};
+
+
 IdentifierDatabase::IdentifierDatabase()
-  : candidate_repository_( CandidateRepository::Instance() ) {
+  : candidate_repository_( CandidateRepository::Instance() ),
+    use_candidate_index_( false ),
+    identifiers_generation_( 0 ),
+    query_generation_( 0 ),
+    use_speculative_queries_( false ),
+    stop_speculation_( false ),
+    has_pending_speculation_( false ),
+    is_speculation_task_running_( false ) {
+}
+
+
+IdentifierDatabase::~IdentifierDatabase() {
+  {
+    std::lock_guard locker( speculation_mutex_ );
+    stop_speculation_ = true;
+    has_pending_speculation_ = false;
+  }
+  ++query_generation_;
+
+  // No task is scheduled anymore. A task that didn't start yet is run here and
+  // returns immediately.
+  speculation_tasks_.Wait();
 }
 
 
 void IdentifierDatabase::AddIdentifiers(
   FiletypeIdentifierMap&& filetype_identifier_map ) {
+  // Gather the identifiers of all files in a single vector so that the
+  // candidates are looked up and built in one pass over the repository instead
+  // of one pass per file.
+  std::vector< std::string > identifiers;
+  std::vector< size_t > file_sizes;
+  for ( auto&& filetype_and_map : filetype_identifier_map ) {
+    for ( auto&& filepath_and_identifiers : filetype_and_map.second ) {
+      auto &file_identifiers = filepath_and_identifiers.second;
+      file_sizes.push_back( file_identifiers.size() );
+      identifiers.insert( identifiers.end(),
+                          std::make_move_iterator( file_identifiers.begin() ),
+                          std::make_move_iterator( file_identifiers.end() ) );
+    }
+  }
+
+  std::vector< const Candidate * > repository_candidates =
+    candidate_repository_.GetCandidatesForStrings( std::move( identifiers ) );
+
+  // Cancel running speculations so that they release the lock.
+  ++identifiers_generation_;
   std::lock_guard locker( filetype_candidate_map_mutex_ );
 
+  auto candidate_pos = repository_candidates.begin();
+  auto file_size_pos = file_sizes.begin();
   for ( auto&& filetype_and_map : filetype_identifier_map ) {
     for ( auto&& filepath_and_identifiers : filetype_and_map.second ) {
       auto filetype = filetype_and_map.first;
       auto filepath = filepath_and_identifiers.first;
-      AddIdentifiersNoLock( std::move( filepath_and_identifiers.second ),
-                            std::move( filetype ),
-                            std::move( filepath ) );
+      auto candidate_end = candidate_pos +
+        static_cast< std::ptrdiff_t >( *file_size_pos++ );
+      AddCandidatesNoLock( candidate_pos,
+                           candidate_end,
+                           std::move( filetype ),
+                           std::move( filepath ) );
+      candidate_pos = candidate_end;
     }
   }
 }
@@ -53,61 +184,365 @@ void IdentifierDatabase::AddIdentifiers(
   std::vector< std::string >&& new_candidates,
   std::string&& filetype,
   std::string&& filepath ) {
+  // Building the candidates is the slow part so it's done before taking the
+  // lock.
+  std::vector< const Candidate * > repository_candidates =
+    candidate_repository_.GetCandidatesForStrings(
+      std::move( new_candidates ) );
+
+  ++identifiers_generation_;
   std::lock_guard locker( filetype_candidate_map_mutex_ );
-  AddIdentifiersNoLock( std::move( new_candidates ), std::move( filetype ), std::move( filepath ) );
+  AddCandidatesNoLock( repository_candidates.begin(),
+                       repository_candidates.end(),
+                       std::move( filetype ),
+                       std::move( filepath ) );
 }
 
 
 void IdentifierDatabase::ClearCandidatesStoredForFile(
   std::string&& filetype,
   std::string&& filepath ) {
+  ++identifiers_generation_;
   std::lock_guard locker( filetype_candidate_map_mutex_ );
-  GetCandidateSet( std::move( filetype ), std::move( filepath ) ).clear();
+  CandidateIndex *index = GetCandidateIndex( filetype );
+  std::set< const Candidate * > &candidates =
+    GetCandidateSet( std::move( filetype ), std::move( filepath ) );
+
+  if ( index ) {
+    for ( const Candidate * candidate : candidates ) {
+      index->RemoveCandidate( candidate );
+    }
+  }
+  candidates.clear();
+  ++identifiers_generation_;
+}
+
+
+void IdentifierDatabase::SetUseSpeculativeQueries(
+  bool use_speculative_queries ) {
+  std::lock_guard locker( speculation_mutex_ );
+  use_speculative_queries_ = use_speculative_queries;
+
+  if ( !use_speculative_queries_ ) {
+    has_pending_speculation_ = false;
+    speculation_.reset();
+    ++query_generation_;
+  }
+}
+
+
+void IdentifierDatabase::SetUseCandidateIndex( bool use_candidate_index ) {
+  std::lock_guard locker( filetype_candidate_map_mutex_ );
+
+  if ( use_candidate_index == use_candidate_index_ ) {
+    return;
+  }
+  use_candidate_index_ = use_candidate_index;
+
+  if ( !use_candidate_index_ ) {
+    filetype_candidate_index_map_.clear();
+    return;
+  }
+
+  for ( const auto& filetype_and_map : filetype_candidate_map_ ) {
+    CandidateIndex *index = GetCandidateIndex( filetype_and_map.first );
+    for ( const auto& path_and_candidates : *filetype_and_map.second ) {
+      for ( const Candidate * candidate : *path_and_candidates.second ) {
+        index->AddCandidate( candidate );
+      }
+    }
+  }
+}
+
+
+FiletypeIdentifierMap IdentifierDatabase::GetIdentifiers() const {
+  FiletypeIdentifierMap filetype_identifier_map;
+
+  std::shared_lock locker( filetype_candidate_map_mutex_ );
+  for ( const auto& filetype_and_map : filetype_candidate_map_ ) {
+    for ( const auto& path_and_candidates : *filetype_and_map.second ) {
+      std::vector< std::string > identifiers;
+      for ( const Candidate * candidate : *path_and_candidates.second ) {
+        // Candidates that were too long are stored as empty ones.
+        if ( !candidate->IsEmpty() ) {
+          identifiers.push_back( candidate->Text() );
+        }
+      }
+
+      if ( !identifiers.empty() ) {
+        filetype_identifier_map[ filetype_and_map.first ]
+                               [ path_and_candidates.first ] =
+          std::move( identifiers );
+      }
+    }
+  }
+
+  return filetype_identifier_map;
 }
 
 
 std::vector< Result > IdentifierDatabase::ResultsForQueryAndType(
   std::string&& query,
   const std::string &filetype,
-  const size_t max_results ) const {
+  const size_t max_results,
+  const QueryOptions &options ) const {
+  // Cancel the speculation for the previous query if still running.
+  ++query_generation_;
+
+  QueryStatistics statistics;
+  statistics.source = "identifier";
+  statistics.query = query;
+  statistics.num_queries = 1;
+  QueryTimer timer;
+
   FiletypeCandidateMap::const_iterator it;
   {
     std::shared_lock locker( filetype_candidate_map_mutex_ );
+    statistics.lock_wait_ns += timer.Lap();
     it = filetype_candidate_map_.find( filetype );
 
     if ( it == filetype_candidate_map_.end() ) {
+      QueryStatisticsRegistry::Instance().Record( std::move( statistics ) );
       return {};
     }
   }
   Word query_object( std::move( query ) );
+  std::vector< Result > results;
+  // The word boundary features are set afterwards to time them separately.
+  auto add_result_if_match = [ & ]( const Candidate *candidate ) {
+    Result result = candidate->FilteredQueryMatchResult( query_object,
+                                                         options,
+                                                         false,
+                                                         &statistics );
+    if ( result.IsSubsequence() ) {
+      results.push_back( result );
+    }
+  };
 
-  std::unordered_set< const Candidate * > seen_candidates;
-  seen_candidates.reserve( candidate_repository_.NumStoredCandidates() );
+  {
+    timer.Restart();
+    std::lock_guard locker( filetype_candidate_map_mutex_ );
+    statistics.lock_wait_ns += timer.Lap();
+
+    const std::vector< const Candidate * > *speculative_candidates = nullptr;
+    auto speculation = SpeculationForQuery( filetype,
+                                            query_object,
+                                            speculative_candidates );
+
+    auto index_it = filetype_candidate_index_map_.find( filetype );
+    std::vector< const Candidate * > indexed_candidates;
+    if ( speculative_candidates ) {
+      // Speculations hold each candidate once.
+      for ( const Candidate * candidate : *speculative_candidates ) {
+        add_result_if_match( candidate );
+      }
+    } else if ( index_it != filetype_candidate_index_map_.end() &&
+                index_it->second->CandidatesForQuery( query_object,
+                                                      indexed_candidates ) ) {
+      // The index returns each candidate once.
+      for ( const Candidate * candidate : indexed_candidates ) {
+        add_result_if_match( candidate );
+      }
+    } else {
+      std::unordered_set< const Candidate * > seen_candidates;
+      seen_candidates.reserve( candidate_repository_.NumStoredCandidates() );
+
+      for ( const auto& path_and_candidates : *it->second ) {
+        for ( const Candidate * candidate : *path_and_candidates.second ) {
+          if ( ContainsKey( seen_candidates, candidate ) ) {
+            continue;
+          }
+          seen_candidates.insert( candidate );
+          add_result_if_match( candidate );
+        }
+      }
+    }
+  }
+
+  statistics.matching_ns = timer.Lap();
+
+  for ( Result &result : results ) {
+    result.SetResultFeaturesFromQuery();
+  }
+  statistics.lcs_ns = timer.Lap();
+
+  if ( !query_object.IsEmpty() ) {
+    ScheduleSpeculation( filetype, query_object.Text() );
+  }
+
+  timer.Restart();
+  PartialSort( results, max_results );
+  statistics.sort_ns = timer.Lap();
+  QueryStatisticsRegistry::Instance().Record( std::move( statistics ) );
+  return results;
+}
+
+
+std::vector< Result > IdentifierDatabase::ResultsForQueryAndTypeWithDeadline(
+  std::string&& query,
+  const std::string &filetype,
+  const std::string &filepath,
+  const size_t max_results,
+  std::chrono::steady_clock::time_point deadline,
+  bool &is_complete ) const {
+  is_complete = true;
+
+  FiletypeCandidateMap::const_iterator it;
+  {
+    std::shared_lock locker( filetype_candidate_map_mutex_ );
+    it = filetype_candidate_map_.find( filetype );
+
+    if ( it == filetype_candidate_map_.end() ) {
+      return {};
+    }
+  }
+  Word query_object( std::move( query ) );
   std::vector< Result > results;
+  size_t num_visited_candidates = 0;
+
+  // Must be called for every visited candidate, even the ones that are skipped
+  // or deferred. Returns true once the deadline is reached.
+  auto deadline_reached = [ &, deadline ]() {
+    if ( ++num_visited_candidates % DEADLINE_CHECK_INTERVAL == 0 &&
+         std::chrono::steady_clock::now() >= deadline ) {
+      is_complete = false;
+    }
+    return !is_complete;
+  };
+
+  // Candidates that are unlikely to be good results are only scanned after all
+  // the others.
+  std::vector< const Candidate * > deferred_candidates;
+  auto scan_or_defer_candidate = [ & ]( const Candidate *candidate,
+                                        bool from_same_file ) {
+    if ( from_same_file || query_object.IsEmpty() ||
+         ( !candidate->IsEmpty() &&
+           query_object.Characters().front()->MatchesSmart(
+             *candidate->Characters().front() ) ) ) {
+      AddResultIfMatch( candidate, query_object, results );
+    } else {
+      deferred_candidates.push_back( candidate );
+    }
+  };
 
   {
     std::lock_guard locker( filetype_candidate_map_mutex_ );
-    for ( const auto& path_and_candidates : *it->second ) {
-      for ( const Candidate * candidate : *path_and_candidates.second ) {
-        if ( ContainsKey( seen_candidates, candidate ) ) {
-          continue;
+
+    const FilepathToCandidates &path_to_candidates = *it->second;
+    auto same_file_it = path_to_candidates.find( filepath );
+    const std::set< const Candidate * > *same_file_candidates =
+      same_file_it != path_to_candidates.end() ?
+      same_file_it->second.get() : nullptr;
+
+    auto index_it = filetype_candidate_index_map_.find( filetype );
+    std::vector< const Candidate * > indexed_candidates;
+    if ( index_it != filetype_candidate_index_map_.end() &&
+         index_it->second->CandidatesForQuery( query_object,
+                                               indexed_candidates ) ) {
+      for ( const Candidate * candidate : indexed_candidates ) {
+        if ( deadline_reached() ) {
+          break;
         }
-        seen_candidates.insert( candidate );
+        bool from_same_file = same_file_candidates &&
+                              ContainsKey( *same_file_candidates, candidate );
+        scan_or_defer_candidate( candidate, from_same_file );
+      }
+    } else {
+      std::unordered_set< const Candidate * > seen_candidates;
+      seen_candidates.reserve( candidate_repository_.NumStoredCandidates() );
+
+      if ( same_file_candidates ) {
+        for ( const Candidate * candidate : *same_file_candidates ) {
+          if ( deadline_reached() ) {
+            break;
+          }
+          seen_candidates.insert( candidate );
+          AddResultIfMatch( candidate, query_object, results );
+        }
+      }
+
+      for ( const auto& path_and_candidates : *it->second ) {
+        if ( !is_complete ) {
+          break;
+        }
+        for ( const Candidate * candidate : *path_and_candidates.second ) {
+          if ( deadline_reached() ) {
+            break;
+          }
+          if ( seen_candidates.insert( candidate ).second ) {
+            scan_or_defer_candidate( candidate, false );
+          }
+        }
+      }
+    }
+
+    if ( is_complete ) {
+      for ( const Candidate * candidate : deferred_candidates ) {
+        if ( deadline_reached() ) {
+          break;
+        }
+        AddResultIfMatch( candidate, query_object, results );
+      }
+    }
+  }
 
-        if ( candidate->IsEmpty() ||
-             !candidate->ContainsBytes( query_object ) ) {
-          continue;
+  PartialSort( results, max_results );
+  return results;
+}
+
+
+std::vector< Result > IdentifierDatabase::ResultsForQueryAndTypeInPaths(
+  std::string&& query,
+  const std::string &filetype,
+  const std::vector< std::string > &filepaths,
+  const std::string &path_prefix,
+  const size_t max_results,
+  const size_t min_results,
+  const QueryOptions &options ) const {
+  Word query_object( std::move( query ) );
+  std::vector< Result > results;
+
+  {
+    std::shared_lock locker( filetype_candidate_map_mutex_ );
+    auto it = filetype_candidate_map_.find( filetype );
+
+    if ( it != filetype_candidate_map_.end() ) {
+      const FilepathToCandidates &path_to_candidates = *it->second;
+      std::unordered_set< const Candidate * > seen_candidates;
+
+      auto add_results_for_file = [ & ](
+        const std::set< const Candidate * > &candidates ) {
+        for ( const Candidate * candidate : candidates ) {
+          if ( seen_candidates.insert( candidate ).second ) {
+            AddResultIfMatch( candidate, query_object, results, options );
+          }
         }
+      };
 
-        Result result = candidate->QueryMatchResult( query_object );
+      for ( const auto &filepath : filepaths ) {
+        auto path_it = path_to_candidates.find( filepath );
+        if ( path_it != path_to_candidates.end() ) {
+          add_results_for_file( *path_it->second );
+        }
+      }
 
-        if ( result.IsSubsequence() ) {
-          results.push_back( result );
+      if ( !path_prefix.empty() ) {
+        for ( const auto& path_and_candidates : path_to_candidates ) {
+          if ( IsInDirectory( path_and_candidates.first, path_prefix ) ) {
+            add_results_for_file( *path_and_candidates.second );
+          }
         }
       }
     }
   }
 
+  if ( results.size() < min_results ) {
+    return ResultsForQueryAndType( std::string( query_object.Text() ),
+                                   filetype,
+                                   max_results,
+                                   options );
+  }
+
   PartialSort( results, max_results );
   return results;
 }
@@ -138,20 +573,185 @@ std::set< const Candidate * > &IdentifierDatabase::GetCandidateSet(
 
 // WARNING: You need to hold the filetype_candidate_map_mutex_ before calling
 // this function and while using the returned set.
-void IdentifierDatabase::AddIdentifiersNoLock(
-  std::vector< std::string >&& new_candidates,
+CandidateIndex *IdentifierDatabase::GetCandidateIndex(
+  const std::string &filetype ) {
+  if ( !use_candidate_index_ ) {
+    return nullptr;
+  }
+
+  std::unique_ptr< CandidateIndex > &index =
+    filetype_candidate_index_map_[ filetype ];
+
+  if ( !index ) {
+    index = std::make_unique< CandidateIndex >();
+  }
+
+  return index.get();
+}
+
+
+void IdentifierDatabase::AddCandidatesNoLock(
+  CandidateIterator begin,
+  CandidateIterator end,
   std::string&& filetype,
   std::string&& filepath ) {
-  std::set< const Candidate *> &candidates =
+  CandidateIndex *index = GetCandidateIndex( filetype );
+  std::set< const Candidate * > &candidates =
     GetCandidateSet( std::move( filetype ), std::move( filepath ) );
 
-  std::vector< const Candidate * > repository_candidates =
-    candidate_repository_.GetCandidatesForStrings(
-      std::move( new_candidates ) );
+  for ( auto candidate_pos = begin; candidate_pos != end; ++candidate_pos ) {
+    // The index counts the files a candidate appears in, so only add it when
+    // the candidate is new for this file.
+    if ( candidates.insert( *candidate_pos ).second && index ) {
+      index->AddCandidate( *candidate_pos );
+    }
+  }
+  ++identifiers_generation_;
+}
+
+
+// WARNING: You need to hold the filetype_candidate_map_mutex_ before calling
+// this function and while using the returned candidates.
+std::shared_ptr< const IdentifierDatabase::Speculation >
+IdentifierDatabase::SpeculationForQuery(
+  const std::string &filetype,
+  const Word &query,
+  const std::vector< const Candidate * > *&candidates ) const {
+  std::shared_ptr< const Speculation > speculation;
+  {
+    std::lock_guard locker( speculation_mutex_ );
+    speculation = speculation_;
+  }
+
+  // The speculation applies if the query is the speculated one followed by a
+  // character.
+  const CharacterSequence &query_characters = query.Characters();
+  if ( !speculation ||
+       speculation->identifiers_generation != identifiers_generation_ ||
+       speculation->filetype != filetype ||
+       query_characters.size() != speculation->query_characters.size() + 1 ||
+       !std::equal( speculation->query_characters.begin(),
+                    speculation->query_characters.end(),
+                    query_characters.begin() ) ) {
+    return nullptr;
+  }
 
-  candidates.insert( repository_candidates.begin(),
-                     repository_candidates.end() );
+  const Character &next_character = *query_characters.back();
+  candidates = next_character.IsAscii() ?
+    &speculation->candidates_by_next_base[ next_character.AsciiBase() ] :
+    &speculation->candidates;
+  return speculation;
 }
 
 
+void IdentifierDatabase::ScheduleSpeculation(
+  const std::string &filetype,
+  const std::string &query ) const {
+  std::lock_guard locker( speculation_mutex_ );
+  if ( !use_speculative_queries_ || stop_speculation_ ) {
+    return;
+  }
+
+  pending_speculation_filetype_ = filetype;
+  pending_speculation_query_ = query;
+  has_pending_speculation_ = true;
+
+  // The task may also have been discarded by a shutdown of the pool.
+  if ( !is_speculation_task_running_ ||
+       speculation_task_.wait_for( std::chrono::seconds( 0 ) ) ==
+         std::future_status::ready ) {
+    is_speculation_task_running_ = true;
+    speculation_task_ = speculation_tasks_.Submit(
+      [ this ] { RunPendingSpeculations(); }, TaskPriority::LOW );
+  }
+}
+
+
+void IdentifierDatabase::RunPendingSpeculations() const {
+  while ( true ) {
+    std::string filetype;
+    std::string query;
+    size_t query_generation;
+    {
+      std::lock_guard locker( speculation_mutex_ );
+      if ( !has_pending_speculation_ ) {
+        is_speculation_task_running_ = false;
+        return;
+      }
+
+      has_pending_speculation_ = false;
+      filetype = std::move( pending_speculation_filetype_ );
+      query = std::move( pending_speculation_query_ );
+      query_generation = query_generation_;
+    }
+
+    auto speculation = ComputeSpeculation( filetype,
+                                           std::move( query ),
+                                           query_generation );
+
+    std::lock_guard locker( speculation_mutex_ );
+    if ( speculation && query_generation == query_generation_ ) {
+      speculation_ = std::move( speculation );
+    }
+  }
+}
+
+
+std::shared_ptr< const IdentifierDatabase::Speculation >
+IdentifierDatabase::ComputeSpeculation(
+  const std::string &filetype,
+  std::string&& query,
+  size_t query_generation ) const {
+  std::shared_lock locker( filetype_candidate_map_mutex_ );
+  size_t identifiers_generation = identifiers_generation_;
+
+  auto it = filetype_candidate_map_.find( filetype );
+  if ( it == filetype_candidate_map_.end() ) {
+    return nullptr;
+  }
+
+  auto speculation = std::make_shared< Speculation >();
+  speculation->filetype = filetype;
+  speculation->identifiers_generation = identifiers_generation;
+
+  Word query_object( std::move( query ) );
+  speculation->query_characters = query_object.Characters();
+
+  std::unordered_set< const Candidate * > seen_candidates;
+  size_t num_scanned_candidates = 0;
+
+  for ( const auto& path_and_candidates : *it->second ) {
+    for ( const Candidate * candidate : *path_and_candidates.second ) {
+      if ( ++num_scanned_candidates % SPECULATION_CHECK_INTERVAL == 0 &&
+           ( query_generation != query_generation_ ||
+             identifiers_generation != identifiers_generation_ ) ) {
+        return nullptr;
+      }
+
+      if ( !seen_candidates.insert( candidate ).second ||
+           candidate->IsEmpty() ||
+           !candidate->ContainsBytes( query_object ) ||
+           !candidate->QueryMatchResult( query_object,
+                                         false ).IsSubsequence() ) {
+        continue;
+      }
+
+      speculation->candidates.push_back( candidate );
+
+      std::bitset< NON_ASCII_BASE > next_bases;
+      const CharacterSequence &characters = candidate->Characters();
+      for ( size_t i = MatchEnd( *candidate, query_object );
+            i < characters.size(); ++i ) {
+        uint8_t base = characters[ i ]->AsciiBase();
+        if ( base != NON_ASCII_BASE && !next_bases.test( base ) ) {
+          next_bases.set( base );
+          speculation->candidates_by_next_base[ base ].push_back( candidate );
+        }
+      }
+    }
+  }
+
+  return speculation;
+}
+
 } // namespace YouCompleteMe
@@ -18,8 +18,15 @@
 #ifndef IDENTIFIERDATABASE_H_ZESX3CVR
 #define IDENTIFIERDATABASE_H_ZESX3CVR
 
+#include "QueryOptions.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <shared_mutex>
 #include <string>
@@ -29,6 +36,7 @@
 namespace YouCompleteMe {
 
 class Candidate;
+class CandidateIndex;
 class Result;
 class CandidateRepository;
 
@@ -53,6 +61,7 @@ using FiletypeIdentifierMap = std::map< std::string, FilepathToIdentifiers >;
 class IdentifierDatabase {
 public:
   YCM_EXPORT IdentifierDatabase();
+  YCM_EXPORT ~IdentifierDatabase();
   IdentifierDatabase( const IdentifierDatabase& ) = delete;
   IdentifierDatabase& operator=( const IdentifierDatabase& ) = delete;
 
@@ -66,21 +75,93 @@ public:
   void ClearCandidatesStoredForFile( std::string&& filetype,
                                      std::string&& filepath );
 
+  // When enabled, a CandidateIndex is maintained for each filetype and used to
+  // only scan the candidates that may match long enough queries. This speeds
+  // up queries on big databases at the cost of memory. Disabled by default.
+  void SetUseCandidateIndex( bool use_candidate_index );
+
+  // When enabled, the candidates matching a query are gathered on the thread
+  // pool after each ResultsForQueryAndType call and grouped by the characters
+  // that follow the match. If the next query is the same one plus a
+  // character, only the candidates that may match it are scanned. The work is
+  // cancelled as soon as another query arrives or identifiers change. Disabled
+  // by default.
+  void SetUseSpeculativeQueries( bool use_speculative_queries );
+
+  // Returns a copy of all the identifiers currently stored, grouped by filetype
+  // and filepath. Files with no identifiers are omitted.
+  FiletypeIdentifierMap GetIdentifiers() const;
+
   std::vector< Result > ResultsForQueryAndType(
     std::string&& query,
     const std::string &filetype,
-    const size_t max_results ) const;
+    const size_t max_results,
+    const QueryOptions &options = QueryOptions() ) const;
+
+  // Same as above but stops scanning the candidates once |deadline| is
+  // reached and returns the best results found so far. Candidates are scanned
+  // in an order favoring the best ones: those from |filepath| and those whose
+  // first character matches the query first, then the others. |is_complete| is
+  // set to false if some candidates were not scanned.
+  std::vector< Result > ResultsForQueryAndTypeWithDeadline(
+    std::string&& query,
+    const std::string &filetype,
+    const std::string &filepath,
+    const size_t max_results,
+    std::chrono::steady_clock::time_point deadline,
+    bool &is_complete ) const;
+
+  // Same as ResultsForQueryAndType but only scans the identifiers of the files
+  // in |filepaths| and of the files under the directory |path_prefix| (if not
+  // empty). Falls back to scanning all the files of the filetype when this
+  // gives fewer than |min_results| results.
+  std::vector< Result > ResultsForQueryAndTypeInPaths(
+    std::string&& query,
+    const std::string &filetype,
+    const std::vector< std::string > &filepaths,
+    const std::string &path_prefix,
+    const size_t max_results,
+    const size_t min_results,
+    const QueryOptions &options = QueryOptions() ) const;
 
 private:
+  using CandidateIterator = std::vector< const Candidate * >::const_iterator;
+
+  struct Speculation;
+
   std::set< const Candidate * > &GetCandidateSet(
     std::string&& filetype,
     std::string&& filepath );
 
-  void AddIdentifiersNoLock(
-    std::vector< std::string >&& new_candidates,
+  // Returns nullptr if the index is not used.
+  CandidateIndex *GetCandidateIndex( const std::string &filetype );
+
+  void AddCandidatesNoLock(
+    CandidateIterator begin,
+    CandidateIterator end,
     std::string&& filetype,
     std::string&& filepath );
 
+  // Returns the candidates that may match |query| according to the last
+  // speculation or nullptr if it doesn't apply to that query. The returned
+  // speculation must be kept alive while using the candidates.
+  std::shared_ptr< const Speculation > SpeculationForQuery(
+    const std::string &filetype,
+    const Word &query,
+    const std::vector< const Candidate * > *&candidates ) const;
+
+  void ScheduleSpeculation( const std::string &filetype,
+                            const std::string &query ) const;
+
+  // Runs on the thread pool until there is no pending speculation.
+  void RunPendingSpeculations() const;
+
+  // Returns nullptr if cancelled.
+  std::shared_ptr< const Speculation > ComputeSpeculation(
+    const std::string &filetype,
+    std::string&& query,
+    size_t query_generation ) const;
+
 
   // filepath -> *( *candidate )
   using FilepathToCandidates =
@@ -92,10 +173,33 @@ private:
     std::unordered_map < std::string, std::unique_ptr< FilepathToCandidates > >;
 
 
+  // filetype -> *index
+  using FiletypeCandidateIndexMap =
+    std::unordered_map < std::string, std::unique_ptr< CandidateIndex > >;
+
+
   CandidateRepository &candidate_repository_;
 
   FiletypeCandidateMap filetype_candidate_map_;
+  FiletypeCandidateIndexMap filetype_candidate_index_map_;
+  bool use_candidate_index_;
   mutable std::shared_mutex filetype_candidate_map_mutex_;
+
+  // Incremented when identifiers change and when a query starts so that
+  // speculations know when they are stale.
+  std::atomic< size_t > identifiers_generation_;
+  mutable std::atomic< size_t > query_generation_;
+
+  bool use_speculative_queries_;
+  bool stop_speculation_;
+  mutable bool has_pending_speculation_;
+  mutable bool is_speculation_task_running_;
+  mutable std::string pending_speculation_filetype_;
+  mutable std::string pending_speculation_query_;
+  mutable std::shared_ptr< const Speculation > speculation_;
+  mutable std::future< void > speculation_task_;
+  mutable TaskGroup speculation_tasks_;
+  mutable std::mutex speculation_mutex_;
 };
 
 } // namespace YouCompleteMe
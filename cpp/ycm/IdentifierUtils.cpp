@@ -16,12 +16,26 @@
 // along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "IdentifierUtils.h"
+#include "ThreadPool.h"
 #include "Utils.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <random>
 #include <string_view>
+#include <system_error>
 #include <unordered_map>
 
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace YouCompleteMe {
 
 namespace fs = std::filesystem;
@@ -142,24 +156,109 @@ const std::unordered_map < std::string_view, std::string_view
         { "Zephir"              , "zephir"              }
       };
 
-}  // unnamed namespace
+// Bump the version whenever the layout of the snapshot changes.
+const std::string_view SNAPSHOT_MAGIC = "YCMIDDB";
+const uint32_t SNAPSHOT_VERSION = 1;
 
+// Below this number of lines per task, scheduling a task costs more than it
+// saves.
+const size_t MIN_TAG_LINES_PER_TASK = 1024;
 
-// For details on the tag format supported, see here for details:
-// http://ctags.sourceforge.net/FORMAT
-// TL;DR: The only supported format is the one Exuberant Ctags emits.
-FiletypeIdentifierMap ExtractIdentifiersFromTagsFile(
-  const fs::path &path_to_tag_file ) {
-  FiletypeIdentifierMap filetype_identifier_map;
-  const auto lines = [ &path_to_tag_file ]{
-    try {
-      return ReadUtf8File( path_to_tag_file );
-    } catch ( ... ) {
-      return std::vector< std::string >{};
+
+// Lengths and counts are stored as LEB128 variable-length integers; most of
+// them fit in a single byte.
+void WriteVarint( std::string &buffer, uint64_t value ) {
+  while ( value >= 0x80 ) {
+    buffer.push_back( static_cast< char >( ( value & 0x7f ) | 0x80 ) );
+    value >>= 7;
+  }
+  buffer.push_back( static_cast< char >( value ) );
+}
+
+
+void WriteString( std::string &buffer, std::string_view text ) {
+  WriteVarint( buffer, text.size() );
+  buffer.append( text );
+}
+
+
+// Unique among the processes sharing the snapshot file so that they don't
+// write to the same temporary file.
+fs::path TemporarySnapshotPath( const fs::path &path_to_snapshot_file ) {
+#ifdef _WIN32
+  int process_id = _getpid();
+#else
+  int process_id = getpid();
+#endif
+  std::random_device random_device;
+  fs::path temporary_path = path_to_snapshot_file;
+  temporary_path += "." + std::to_string( process_id ) + "." +
+                    std::to_string( random_device() ) + ".tmp";
+  return temporary_path;
+}
+
+
+class SnapshotReader {
+public:
+  explicit SnapshotReader( std::string_view data )
+    : data_( data ),
+      position_( 0 ),
+      failed_( false ) {
+  }
+
+  bool Failed() const {
+    return failed_;
+  }
+
+  bool AtEnd() const {
+    return position_ == data_.size();
+  }
+
+  uint64_t ReadVarint() {
+    uint64_t value = 0;
+    for ( int shift = 0; shift < 64; shift += 7 ) {
+      if ( position_ == data_.size() ) {
+        break;
+      }
+      auto byte = static_cast< uint8_t >( data_[ position_++ ] );
+      value |= static_cast< uint64_t >( byte & 0x7f ) << shift;
+      if ( !( byte & 0x80 ) ) {
+        return value;
+      }
     }
-  }();
+    failed_ = true;
+    return 0;
+  }
+
+  std::string_view ReadBytes( uint64_t size ) {
+    if ( failed_ || size > data_.size() - position_ ) {
+      failed_ = true;
+      return {};
+    }
+    std::string_view bytes = data_.substr( position_, size );
+    position_ += size;
+    return bytes;
+  }
 
-  for (auto&& line : lines) {
+  std::string_view ReadString() {
+    return ReadBytes( ReadVarint() );
+  }
+
+private:
+  std::string_view data_;
+  size_t position_;
+  bool failed_;
+};
+
+// Adds to |filetype_identifier_map| the identifiers of the tags in the lines
+// [begin, end) of the tags file.
+void ExtractIdentifiersFromTagLines(
+  const fs::path &path_to_tag_file,
+  std::vector< std::string >::const_iterator begin,
+  std::vector< std::string >::const_iterator end,
+  FiletypeIdentifierMap &filetype_identifier_map ) {
+  for ( auto line_pos = begin; line_pos != end; ++line_pos ) {
+    const std::string &line = *line_pos;
     // Identifier name is from the start of the line to the first \t.
     const size_t id_end = line.find( '\t' );
     if ( id_end == std::string::npos ) {
@@ -198,6 +297,161 @@ FiletypeIdentifierMap ExtractIdentifiersFromTagsFile(
                            [ std::move( path ).string() ]
       .emplace_back( identifier );
   }
+}
+
+
+// Appends the identifiers of |source| to those of |target|.
+void MergeFiletypeIdentifierMaps( FiletypeIdentifierMap &&source,
+                                  FiletypeIdentifierMap &target ) {
+  for ( auto&& [ filetype, filepath_to_identifiers ] : source ) {
+    FilepathToIdentifiers &target_files = target[ filetype ];
+    for ( auto&& [ filepath, identifiers ] : filepath_to_identifiers ) {
+      std::vector< std::string > &target_identifiers = target_files[ filepath ];
+      target_identifiers.insert(
+        target_identifiers.end(),
+        std::make_move_iterator( identifiers.begin() ),
+        std::make_move_iterator( identifiers.end() ) );
+    }
+  }
+}
+
+
+}  // unnamed namespace
+
+
+// For details on the tag format supported, see here for details:
+// http://ctags.sourceforge.net/FORMAT
+// TL;DR: The only supported format is the one Exuberant Ctags emits.
+FiletypeIdentifierMap ExtractIdentifiersFromTagsFile(
+  const fs::path &path_to_tag_file ) {
+  FiletypeIdentifierMap filetype_identifier_map;
+  const auto lines = [ &path_to_tag_file ]{
+    try {
+      return ReadUtf8File( path_to_tag_file );
+    } catch ( ... ) {
+      return std::vector< std::string >{};
+    }
+  }();
+
+  // Resolving the paths of the tags is the costly part. Big files are split
+  // across the thread pool; the calling thread runs the tasks no worker started
+  // yet while waiting.
+  size_t num_tasks = std::min( ThreadPool::Instance().NumThreads() + 1,
+                               lines.size() / MIN_TAG_LINES_PER_TASK );
+  if ( num_tasks <= 1 ) {
+    ExtractIdentifiersFromTagLines( path_to_tag_file,
+                                    lines.begin(),
+                                    lines.end(),
+                                    filetype_identifier_map );
+    return filetype_identifier_map;
+  }
+
+  TaskGroup tasks;
+  std::vector< std::future< FiletypeIdentifierMap > > futures;
+  size_t chunk_size = ( lines.size() + num_tasks - 1 ) / num_tasks;
+  for ( size_t start = 0; start < lines.size(); start += chunk_size ) {
+    auto line_begin = lines.begin() + static_cast< std::ptrdiff_t >( start );
+    auto line_end = lines.begin() + static_cast< std::ptrdiff_t >(
+      std::min( start + chunk_size, lines.size() ) );
+    futures.push_back( tasks.Submit(
+      [ &path_to_tag_file, line_begin, line_end ] {
+        FiletypeIdentifierMap chunk_identifier_map;
+        ExtractIdentifiersFromTagLines( path_to_tag_file,
+                                        line_begin,
+                                        line_end,
+                                        chunk_identifier_map );
+        return chunk_identifier_map;
+      } ) );
+  }
+
+  // Merging in order keeps the identifiers in the order of the file.
+  tasks.Wait();
+  for ( auto &future : futures ) {
+    MergeFiletypeIdentifierMaps( future.get(), filetype_identifier_map );
+  }
+  return filetype_identifier_map;
+}
+
+
+bool WriteIdentifiersToSnapshotFile(
+  const FiletypeIdentifierMap &filetype_identifier_map,
+  const fs::path &path_to_snapshot_file ) {
+  std::string buffer( SNAPSHOT_MAGIC );
+  WriteVarint( buffer, SNAPSHOT_VERSION );
+  WriteVarint( buffer, filetype_identifier_map.size() );
+  for ( const auto& filetype_and_map : filetype_identifier_map ) {
+    WriteString( buffer, filetype_and_map.first );
+    WriteVarint( buffer, filetype_and_map.second.size() );
+    for ( const auto& filepath_and_identifiers : filetype_and_map.second ) {
+      WriteString( buffer, filepath_and_identifiers.first );
+      WriteVarint( buffer, filepath_and_identifiers.second.size() );
+      for ( const auto& identifier : filepath_and_identifiers.second ) {
+        WriteString( buffer, identifier );
+      }
+    }
+  }
+
+  fs::path temporary_path = TemporarySnapshotPath( path_to_snapshot_file );
+  {
+    std::ofstream file( temporary_path,
+                        std::ios::out | std::ios::binary | std::ios::trunc );
+    file.write( buffer.data(),
+                static_cast< std::streamsize >( buffer.size() ) );
+    if ( !file.good() ) {
+      return false;
+    }
+  }
+
+  std::error_code error;
+  fs::rename( temporary_path, path_to_snapshot_file, error );
+  if ( error ) {
+    fs::remove( temporary_path, error );
+    return false;
+  }
+  return true;
+}
+
+
+FiletypeIdentifierMap ReadIdentifiersFromSnapshotFile(
+  const fs::path &path_to_snapshot_file ) {
+  std::string buffer;
+  {
+    std::ifstream file( path_to_snapshot_file,
+                        std::ios::in | std::ios::binary );
+    if ( !file ) {
+      return {};
+    }
+    buffer.assign( std::istreambuf_iterator< char >( file ),
+                   std::istreambuf_iterator< char >() );
+  }
+
+  SnapshotReader reader( buffer );
+  if ( reader.ReadBytes( SNAPSHOT_MAGIC.size() ) != SNAPSHOT_MAGIC ||
+       reader.ReadVarint() != SNAPSHOT_VERSION ) {
+    return {};
+  }
+
+  FiletypeIdentifierMap filetype_identifier_map;
+  for ( uint64_t num_filetypes = reader.ReadVarint();
+        num_filetypes > 0 && !reader.Failed(); --num_filetypes ) {
+    FilepathToIdentifiers &filepath_to_identifiers =
+      filetype_identifier_map[ std::string( reader.ReadString() ) ];
+
+    for ( uint64_t num_filepaths = reader.ReadVarint();
+          num_filepaths > 0 && !reader.Failed(); --num_filepaths ) {
+      std::vector< std::string > &identifiers =
+        filepath_to_identifiers[ std::string( reader.ReadString() ) ];
+
+      for ( uint64_t num_identifiers = reader.ReadVarint();
+            num_identifiers > 0 && !reader.Failed(); --num_identifiers ) {
+        identifiers.emplace_back( reader.ReadString() );
+      }
+    }
+  }
+
+  if ( reader.Failed() || !reader.AtEnd() ) {
+    return {};
+  }
   return filetype_identifier_map;
 }
 
@@ -27,6 +27,19 @@ namespace YouCompleteMe {
 YCM_EXPORT FiletypeIdentifierMap ExtractIdentifiersFromTagsFile(
   const std::filesystem::path &path_to_tag_file );
 
+// Writes the identifiers to a compact binary snapshot file. The snapshot is
+// first written to a temporary file which is then renamed so that a reader
+// never sees a partially written snapshot. Returns false on failure.
+YCM_EXPORT bool WriteIdentifiersToSnapshotFile(
+  const FiletypeIdentifierMap &filetype_identifier_map,
+  const std::filesystem::path &path_to_snapshot_file );
+
+// Reads the identifiers from a snapshot file written by
+// WriteIdentifiersToSnapshotFile. Returns an empty map if the file doesn't
+// exist, is corrupted, or was written by an incompatible version.
+YCM_EXPORT FiletypeIdentifierMap ReadIdentifiersFromSnapshotFile(
+  const std::filesystem::path &path_to_snapshot_file );
+
 } // namespace YouCompleteMe
 
 #endif /* end of include guard: IDENTIFIERUTILS_CPP_WFFUZNET */
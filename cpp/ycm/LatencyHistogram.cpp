@@ -0,0 +1,153 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace YouCompleteMe {
+
+size_t LatencyHistogram::BucketIndex( uint64_t value ) {
+  if ( value < NUM_SUB_BUCKETS ) {
+    return static_cast< size_t >( value );
+  }
+
+  // Position of the highest set bit.
+  size_t exponent = SUB_BUCKET_BITS;
+  while ( exponent < 63 && ( value >> ( exponent + 1 ) ) ) {
+    ++exponent;
+  }
+  size_t shift = exponent - SUB_BUCKET_BITS;
+  size_t sub_bucket = static_cast< size_t >( value >> shift ) -
+                      NUM_SUB_BUCKETS;
+  return NUM_SUB_BUCKETS + shift * NUM_SUB_BUCKETS + sub_bucket;
+}
+
+
+uint64_t LatencyHistogram::BucketValue( size_t index ) {
+  if ( index < NUM_SUB_BUCKETS ) {
+    return index;
+  }
+
+  size_t shift = ( index - NUM_SUB_BUCKETS ) / NUM_SUB_BUCKETS;
+  uint64_t sub_bucket = ( index - NUM_SUB_BUCKETS ) % NUM_SUB_BUCKETS;
+  uint64_t lowest = ( NUM_SUB_BUCKETS + sub_bucket ) << shift;
+  return lowest + ( ( uint64_t( 1 ) << shift ) - 1 );
+}
+
+
+void LatencyHistogram::Record( uint64_t nanoseconds ) {
+  buckets_[ BucketIndex( nanoseconds ) ].fetch_add( 1,
+                                                    std::memory_order_relaxed );
+  count_.fetch_add( 1, std::memory_order_relaxed );
+  sum_.fetch_add( nanoseconds, std::memory_order_relaxed );
+
+  uint64_t max = max_.load( std::memory_order_relaxed );
+  while ( nanoseconds > max &&
+          !max_.compare_exchange_weak( max,
+                                       nanoseconds,
+                                       std::memory_order_relaxed ) ) {
+  }
+}
+
+
+LatencySnapshot LatencyHistogram::Snapshot() const {
+  // Counts are read from the buckets so that percentiles are consistent even
+  // if durations are recorded meanwhile.
+  std::array< uint64_t, NUM_BUCKETS > buckets;
+  uint64_t count = 0;
+  for ( size_t index = 0; index < NUM_BUCKETS; ++index ) {
+    buckets[ index ] = buckets_[ index ].load( std::memory_order_relaxed );
+    count += buckets[ index ];
+  }
+
+  LatencySnapshot snapshot;
+  snapshot.count = count;
+  if ( count == 0 ) {
+    return snapshot;
+  }
+  snapshot.mean_ns = sum_.load( std::memory_order_relaxed ) /
+                     std::max< uint64_t >( count_.load(), 1 );
+  snapshot.max_ns = max_.load( std::memory_order_relaxed );
+
+  auto percentile = [ & ]( double fraction ) {
+    auto rank = static_cast< uint64_t >(
+      std::ceil( fraction * static_cast< double >( count ) ) );
+    uint64_t cumulative_count = 0;
+    for ( size_t index = 0; index < NUM_BUCKETS; ++index ) {
+      cumulative_count += buckets[ index ];
+      if ( cumulative_count >= rank ) {
+        return std::min( BucketValue( index ), snapshot.max_ns );
+      }
+    }
+    return snapshot.max_ns;
+  };
+  snapshot.p50_ns = percentile( 0.5 );
+  snapshot.p90_ns = percentile( 0.9 );
+  snapshot.p99_ns = percentile( 0.99 );
+  snapshot.p999_ns = percentile( 0.999 );
+  return snapshot;
+}
+
+
+void LatencyHistogram::Reset() {
+  for ( auto &bucket : buckets_ ) {
+    bucket.store( 0, std::memory_order_relaxed );
+  }
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+
+LatencyRegistry &LatencyRegistry::Instance() {
+  static LatencyRegistry registry;
+  return registry;
+}
+
+
+LatencyHistogram &LatencyRegistry::Histogram( const std::string &name ) {
+  std::lock_guard locker( histograms_mutex_ );
+  auto &histogram = histograms_[ name ];
+  if ( !histogram ) {
+    histogram = std::make_unique< LatencyHistogram >();
+  }
+  return *histogram;
+}
+
+
+std::vector< LatencySnapshot > LatencyRegistry::Snapshot() const {
+  std::lock_guard locker( histograms_mutex_ );
+  std::vector< LatencySnapshot > snapshots;
+  snapshots.reserve( histograms_.size() );
+  for ( const auto &[ name, histogram ] : histograms_ ) {
+    snapshots.push_back( histogram->Snapshot() );
+    snapshots.back().name = name;
+  }
+  return snapshots;
+}
+
+
+void LatencyRegistry::Reset() {
+  std::lock_guard locker( histograms_mutex_ );
+  for ( auto &name_and_histogram : histograms_ ) {
+    name_and_histogram.second->Reset();
+  }
+}
+
+} // namespace YouCompleteMe
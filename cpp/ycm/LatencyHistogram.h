@@ -0,0 +1,138 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef LATENCYHISTOGRAM_H_T5VJ3NQA
+#define LATENCYHISTOGRAM_H_T5VJ3NQA
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace YouCompleteMe {
+
+// Latency statistics of an entry point. Durations are in nanoseconds.
+struct LatencySnapshot {
+  std::string name;
+  uint64_t count = 0;
+  uint64_t mean_ns = 0;
+  uint64_t max_ns = 0;
+  uint64_t p50_ns = 0;
+  uint64_t p90_ns = 0;
+  uint64_t p99_ns = 0;
+  uint64_t p999_ns = 0;
+};
+
+
+// Histogram of durations with buckets of exponentially increasing width, like
+// HdrHistogram: each power of two is split in 16 buckets so that percentiles
+// are accurate to about 6%. Recording is lock-free and wait-free except for
+// the maximum.
+//
+// This class is thread-safe.
+class LatencyHistogram {
+public:
+  LatencyHistogram() = default;
+  LatencyHistogram( const LatencyHistogram& ) = delete;
+  LatencyHistogram& operator=( const LatencyHistogram& ) = delete;
+
+  YCM_EXPORT void Record( uint64_t nanoseconds );
+
+  YCM_EXPORT LatencySnapshot Snapshot() const;
+
+  // Durations recorded concurrently may be partially lost.
+  YCM_EXPORT void Reset();
+
+private:
+  static constexpr size_t SUB_BUCKET_BITS = 4;
+  static constexpr size_t NUM_SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr size_t NUM_BUCKETS =
+    NUM_SUB_BUCKETS + ( 64 - SUB_BUCKET_BITS ) * NUM_SUB_BUCKETS;
+
+  static size_t BucketIndex( uint64_t value );
+  // Highest value falling in the bucket.
+  static uint64_t BucketValue( size_t index );
+
+  std::array< std::atomic< uint64_t >, NUM_BUCKETS > buckets_{};
+  std::atomic< uint64_t > count_{ 0 };
+  std::atomic< uint64_t > sum_{ 0 };
+  std::atomic< uint64_t > max_{ 0 };
+};
+
+
+// Records the lifetime of the object in a histogram.
+class ScopedLatencyTimer {
+public:
+  explicit ScopedLatencyTimer( LatencyHistogram &histogram )
+    : histogram_( histogram ),
+      start_( std::chrono::steady_clock::now() ) {
+  }
+
+  ScopedLatencyTimer( const ScopedLatencyTimer& ) = delete;
+  ScopedLatencyTimer& operator=( const ScopedLatencyTimer& ) = delete;
+
+  ~ScopedLatencyTimer() {
+    auto elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >(
+      std::chrono::steady_clock::now() - start_ );
+    histogram_.Record( static_cast< uint64_t >( elapsed.count() ) );
+  }
+
+private:
+  LatencyHistogram &histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+
+// This singleton holds a histogram per entry point. Histograms are never
+// destroyed so callers can keep a reference to them, typically in a static
+// variable so that only the first call looks the histogram up:
+//
+//   static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+//     "Foo::Bar" );
+//   ScopedLatencyTimer timer( latency );
+//
+// This class is thread-safe.
+class LatencyRegistry {
+public:
+  YCM_EXPORT static LatencyRegistry &Instance();
+  // Make class noncopyable
+  LatencyRegistry( const LatencyRegistry& ) = delete;
+  LatencyRegistry& operator=( const LatencyRegistry& ) = delete;
+
+  YCM_EXPORT LatencyHistogram &Histogram( const std::string &name );
+
+  // Sorted by name.
+  YCM_EXPORT std::vector< LatencySnapshot > Snapshot() const;
+
+  YCM_EXPORT void Reset();
+
+private:
+  LatencyRegistry() = default;
+  ~LatencyRegistry() = default;
+
+  std::map< std::string, std::unique_ptr< LatencyHistogram > > histograms_;
+  mutable std::mutex histograms_mutex_;
+};
+
+} // namespace YouCompleteMe
+
+#endif /* end of include guard: LATENCYHISTOGRAM_H_T5VJ3NQA */
@@ -18,9 +18,16 @@
 #include "PythonSupport.h"
 #include "Candidate.h"
 #include "CandidateRepository.h"
+#include "CompletionJson.h"
+#include "LatencyHistogram.h"
+#include "QueryStatistics.h"
 #include "Result.h"
 #include "Utils.h"
 
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -29,33 +36,375 @@ using pybind11::str;
 using pybind11::bytes;
 using pybind11::object;
 using pybind11::isinstance;
+using pybind11::reinterpret_borrow;
+using pybind11::reinterpret_steal;
 using pylist = pybind11::list;
 
 namespace YouCompleteMe {
 
 namespace {
 
-std::vector< const Candidate * > CandidatesFromObjectList(
+// The UTF-8 texts of a list of candidates, stored contiguously so that they
+// can be extracted from Python objects without an allocation per candidate.
+class CandidateStrings {
+public:
+  explicit CandidateStrings( size_t num_candidates ) {
+    ends_.reserve( num_candidates );
+  }
+
+  void Append( std::string_view text ) {
+    buffer_.append( text );
+    ends_.push_back( buffer_.size() );
+  }
+
+  // The views are only valid as long as this object is alive and unchanged.
+  std::vector< std::string_view > Views() const {
+    std::vector< std::string_view > views;
+    views.reserve( ends_.size() );
+    std::string_view buffer = buffer_;
+    size_t start = 0;
+    for ( auto end : ends_ ) {
+      views.push_back( buffer.substr( start, end - start ) );
+      start = end;
+    }
+    return views;
+  }
+
+private:
+  std::string buffer_;
+  std::vector< size_t > ends_;
+};
+
+
+// Same as GetUtf8String but without building an intermediate std::string for
+// str and bytes objects. Python caches the UTF-8 representation of str objects
+// so reading it is usually free.
+void AppendUtf8String( const object &value, CandidateStrings &strings ) {
+  PyObject *value_ptr = value.ptr();
+
+  if ( PyUnicode_Check( value_ptr ) ) {
+    Py_ssize_t size;
+    const char *data = PyUnicode_AsUTF8AndSize( value_ptr, &size );
+    if ( data ) {
+      strings.Append( std::string_view( data, static_cast< size_t >( size ) ) );
+      return;
+    }
+    // The string can't be encoded to UTF-8 (e.g. it contains lone surrogates).
+    // Escape what can't be encoded as \uXXXX instead of failing the request.
+    PyErr_Clear();
+    auto escaped = reinterpret_steal< object >(
+      PyUnicode_AsEncodedString( value_ptr, "utf-8", "backslashreplace" ) );
+    if ( !escaped ) {
+      throw pybind11::error_already_set();
+    }
+    strings.Append( std::string_view(
+      PyBytes_AS_STRING( escaped.ptr() ),
+      static_cast< size_t >( PyBytes_GET_SIZE( escaped.ptr() ) ) ) );
+    return;
+  } else if ( PyBytes_Check( value_ptr ) ) {
+    strings.Append( std::string_view(
+      PyBytes_AS_STRING( value_ptr ),
+      static_cast< size_t >( PyBytes_GET_SIZE( value_ptr ) ) ) );
+    return;
+  }
+
+  strings.Append( GetUtf8String( value ) );
+}
+
+
+// Must be called with the GIL held.
+CandidateStrings CandidateStringsFromObjectList(
   pylist candidates,
   const std::string &candidate_property ) {
-  size_t num_candidates = len( candidates );
-  std::vector< std::string > candidate_strings;
-  candidate_strings.reserve( num_candidates );
+  PyObject *candidates_ptr = candidates.ptr();
+  CandidateStrings candidate_strings( len( candidates ) );
   // Store the property in a native Python string so that the below doesn't need
   // to reconvert over and over:
   str py_prop( candidate_property );
 
-  for ( size_t i = 0; i < num_candidates; ++i ) {
+  // The size of the list is checked on each iteration since converting an
+  // object to a string may run arbitrary Python code.
+  for ( Py_ssize_t i = 0; i < PyList_GET_SIZE( candidates_ptr ); ++i ) {
+    auto candidate = reinterpret_borrow< object >(
+      PyList_GET_ITEM( candidates_ptr, i ) );
+
     if ( candidate_property.empty() ) {
-      candidate_strings.emplace_back( GetUtf8String( candidates[ i ] ) );
+      AppendUtf8String( candidate, candidate_strings );
+    } else if ( PyDict_CheckExact( candidate.ptr() ) ) {
+      PyObject *value = PyDict_GetItemWithError( candidate.ptr(),
+                                                 py_prop.ptr() );
+      if ( !value ) {
+        if ( !PyErr_Occurred() ) {
+          PyErr_SetObject( PyExc_KeyError, py_prop.ptr() );
+        }
+        throw pybind11::error_already_set();
+      }
+      AppendUtf8String( reinterpret_borrow< object >( value ),
+                        candidate_strings );
     } else {
-      candidate_strings.emplace_back( GetUtf8String(
-                                        candidates[ i ][ py_prop ] ) );
+      AppendUtf8String( candidate[ py_prop ], candidate_strings );
     }
   }
 
+  return candidate_strings;
+}
+
+
+// Can be called without holding the GIL.
+std::vector< const Candidate * > CandidatesFromStrings(
+  const CandidateStrings &candidate_strings ) {
   return CandidateRepository::Instance().GetCandidatesForStrings(
-           std::move( candidate_strings ) );
+           candidate_strings.Views() );
+}
+
+
+// Guards against infinite recursion when encoding circular structures.
+class RecursionGuard {
+public:
+  RecursionGuard() {
+    if ( Py_EnterRecursiveCall( " while encoding a Python object to JSON" ) ) {
+      throw pybind11::error_already_set();
+    }
+  }
+
+  ~RecursionGuard() {
+    Py_LeaveRecursiveCall();
+  }
+
+  RecursionGuard( const RecursionGuard& ) = delete;
+  RecursionGuard& operator=( const RecursionGuard& ) = delete;
+};
+
+
+void AppendJsonFloat( PyObject *value, std::string &json ) {
+  double number = PyFloat_AsDouble( value );
+  if ( std::isnan( number ) ) {
+    json.append( "NaN" );
+  } else if ( std::isinf( number ) ) {
+    json.append( number > 0 ? "Infinity" : "-Infinity" );
+  } else {
+    // Same as float.__repr__, which is what the json module uses.
+    std::unique_ptr< char, decltype( &PyMem_Free ) > repr(
+      PyOS_double_to_string( number, 'r', 0, Py_DTSF_ADD_DOT_0, nullptr ),
+      &PyMem_Free );
+    if ( !repr ) {
+      throw pybind11::error_already_set();
+    }
+    json.append( repr.get() );
+  }
+}
+
+
+void AppendJsonInteger( PyObject *value, std::string &json ) {
+  // Go through int to ignore the __str__ of subclasses like IntEnum.
+  auto number = reinterpret_steal< object >( PyNumber_Long( value ) );
+  if ( !number ) {
+    throw pybind11::error_already_set();
+  }
+  json.append( GetUtf8String( number ) );
+}
+
+
+// Strings with lone surrogates can't be encoded to UTF-8. The json module
+// escapes the surrogates as \uXXXX, so do the same and encode the rest of the
+// string as usual.
+void AppendJsonUnicodeWithSurrogates( PyObject *value, std::string &json ) {
+  json.push_back( '"' );
+
+  Py_ssize_t length = PyUnicode_GET_LENGTH( value );
+  Py_ssize_t start = 0;
+  auto append_run = [ value, &start, &json ]( Py_ssize_t end ) {
+    if ( start == end ) {
+      return;
+    }
+    auto run = reinterpret_steal< object >(
+      PyUnicode_Substring( value, start, end ) );
+    if ( !run ) {
+      throw pybind11::error_already_set();
+    }
+    Py_ssize_t size;
+    const char *data = PyUnicode_AsUTF8AndSize( run.ptr(), &size );
+    if ( !data ) {
+      throw pybind11::error_already_set();
+    }
+    std::string run_json;
+    AppendJsonString( std::string_view( data, static_cast< size_t >( size ) ),
+                      run_json );
+    // Without the quotes.
+    json.append( run_json, 1, run_json.size() - 2 );
+  };
+
+  for ( Py_ssize_t i = 0; i < length; ++i ) {
+    Py_UCS4 character = PyUnicode_READ_CHAR( value, i );
+    if ( Py_UNICODE_IS_SURROGATE( character ) ) {
+      append_run( i );
+      start = i + 1;
+      char escaped[ 7 ];
+      std::snprintf( escaped, sizeof( escaped ), "\\u%04x",
+                     static_cast< unsigned >( character ) );
+      json.append( escaped );
+    }
+  }
+  append_run( length );
+
+  json.push_back( '"' );
+}
+
+
+void AppendJsonUnicode( PyObject *value, std::string &json ) {
+  Py_ssize_t size;
+  const char *data = PyUnicode_AsUTF8AndSize( value, &size );
+  if ( !data ) {
+    PyErr_Clear();
+    AppendJsonUnicodeWithSurrogates( value, json );
+    return;
+  }
+  AppendJsonString( std::string_view( data, static_cast< size_t >( size ) ),
+                    json );
+}
+
+
+void AppendJson( pybind11::handle value, std::string &json );
+
+
+void AppendJsonDict( PyObject *dict, std::string &json ) {
+  json.push_back( '{' );
+
+  PyObject *key;
+  PyObject *value;
+  Py_ssize_t position = 0;
+  bool first = true;
+  while ( PyDict_Next( dict, &position, &key, &value ) ) {
+    if ( !first ) {
+      json.push_back( ',' );
+    }
+    first = false;
+
+    // Same conversion of the keys as the json module.
+    if ( PyUnicode_Check( key ) ) {
+      AppendJsonUnicode( key, json );
+    } else if ( key == Py_True || key == Py_False || key == Py_None ) {
+      AppendJsonString( key == Py_None ? "null" :
+                        key == Py_True ? "true" : "false", json );
+    } else if ( PyLong_Check( key ) || PyFloat_Check( key ) ) {
+      std::string number;
+      if ( PyLong_Check( key ) ) {
+        AppendJsonInteger( key, number );
+      } else {
+        AppendJsonFloat( key, number );
+      }
+      AppendJsonString( number, json );
+    } else {
+      throw pybind11::type_error(
+        "keys must be str, int, float, bool or None" );
+    }
+
+    json.push_back( ':' );
+    // The value is borrowed from the dict, which may be changed by converting
+    // the value to a string.
+    AppendJson( reinterpret_borrow< object >( value ), json );
+  }
+
+  json.push_back( '}' );
+}
+
+
+// Encodes |value| like handlers._JsonResponse does, i.e. objects that are not
+// JSON-serializable are encoded as their __dict__ with their type name or as
+// their string representation.
+void AppendJson( pybind11::handle value, std::string &json ) {
+  RecursionGuard recursion_guard;
+  PyObject *value_ptr = value.ptr();
+
+  if ( value_ptr == Py_None ) {
+    json.append( "null" );
+  } else if ( value_ptr == Py_True ) {
+    json.append( "true" );
+  } else if ( value_ptr == Py_False ) {
+    json.append( "false" );
+  } else if ( PyUnicode_Check( value_ptr ) ) {
+    AppendJsonUnicode( value_ptr, json );
+  } else if ( PyLong_Check( value_ptr ) ) {
+    AppendJsonInteger( value_ptr, json );
+  } else if ( PyFloat_Check( value_ptr ) ) {
+    AppendJsonFloat( value_ptr, json );
+  } else if ( PyDict_Check( value_ptr ) ) {
+    AppendJsonDict( value_ptr, json );
+  } else if ( PyList_Check( value_ptr ) || PyTuple_Check( value_ptr ) ) {
+    json.push_back( '[' );
+    // The size is checked on each iteration since encoding an item may run
+    // arbitrary Python code.
+    for ( Py_ssize_t i = 0; i < PySequence_Size( value_ptr ); ++i ) {
+      if ( i > 0 ) {
+        json.push_back( ',' );
+      }
+      auto item = reinterpret_steal< object >(
+        PySequence_GetItem( value_ptr, i ) );
+      if ( !item ) {
+        throw pybind11::error_already_set();
+      }
+      AppendJson( item, json );
+    }
+    json.push_back( ']' );
+  } else if ( hasattr( value, "__dict__" ) ) {
+    pybind11::dict serialized = value.attr( "__dict__" ).attr( "copy" )();
+    serialized[ "TYPE" ] = reinterpret_borrow< object >(
+      reinterpret_cast< PyObject * >( Py_TYPE( value_ptr ) ) ).attr(
+        "__name__" );
+    AppendJsonDict( serialized.ptr(), json );
+  } else {
+    str value_str( value );
+    AppendJsonUnicode( value_str.ptr(), json );
+  }
+}
+
+
+// Must be called without holding the GIL.
+std::vector< ResultAnd< size_t > > FilterAndSortRepositoryCandidates(
+  const std::vector< const Candidate * > &repository_candidates,
+  std::string &&query,
+  const size_t max_candidates,
+  const QueryOptions &options ) {
+  std::vector< ResultAnd< size_t > > result_and_objects;
+  QueryStatistics statistics;
+  statistics.source = "filter";
+  statistics.query = query;
+  statistics.num_queries = 1;
+  QueryTimer timer;
+  Word query_object( std::move( query ) );
+
+  for ( size_t i = 0; i < repository_candidates.size(); ++i ) {
+    Result result = repository_candidates[ i ]->FilteredQueryMatchResult(
+      query_object, options, false, &statistics );
+    if ( result.IsSubsequence() ) {
+      result_and_objects.emplace_back( result, i );
+    }
+  }
+  statistics.matching_ns = timer.Lap();
+
+  for ( auto &result_and_object : result_and_objects ) {
+    result_and_object.result_.SetResultFeaturesFromQuery();
+  }
+  statistics.lcs_ns = timer.Lap();
+
+  PartialSort( result_and_objects, max_candidates );
+  statistics.sort_ns = timer.Lap();
+  QueryStatisticsRegistry::Instance().Record( std::move( statistics ) );
+  return result_and_objects;
+}
+
+
+template< typename Sequence >
+pylist ObjectsFromResults(
+  const Sequence &candidates,
+  const std::vector< ResultAnd< size_t > > &result_and_objects ) {
+  pylist filtered_candidates;
+
+  for ( const ResultAnd< size_t > &result_and_object : result_and_objects ) {
+    filtered_candidates.append( candidates[ result_and_object.extra_object_ ] );
+  }
+
+  return filtered_candidates;
 }
 
 } // unnamed namespace
@@ -65,43 +414,110 @@ pylist FilterAndSortCandidates(
   pylist candidates,
   const std::string &candidate_property,
   std::string query,
-  const size_t max_candidates ) {
-  pylist filtered_candidates;
-
-  size_t num_candidates = len( candidates );
-  std::vector< const Candidate * > repository_candidates =
-    CandidatesFromObjectList( candidates, candidate_property );
+  const size_t max_candidates,
+  const QueryOptions &options ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "FilterAndSortCandidates" );
+  ScopedLatencyTimer timer( latency );
+  CandidateStrings candidate_strings =
+    CandidateStringsFromObjectList( candidates, candidate_property );
 
   std::vector< ResultAnd< size_t > > result_and_objects;
   {
     pybind11::gil_scoped_release unlock;
-    Word query_object( std::move( query ) );
+    std::vector< const Candidate * > repository_candidates =
+      CandidatesFromStrings( candidate_strings );
+    result_and_objects = FilterAndSortRepositoryCandidates(
+      repository_candidates, std::move( query ), max_candidates, options );
+  }
 
-    for ( size_t i = 0; i < num_candidates; ++i ) {
-      const Candidate *candidate = repository_candidates[ i ];
+  return ObjectsFromResults( candidates, result_and_objects );
+}
 
-      if ( candidate->IsEmpty() || !candidate->ContainsBytes( query_object ) ) {
-        continue;
-      }
 
-      Result result = candidate->QueryMatchResult( query_object );
+pylist FilterAndSortCandidatesWithMatchPositions(
+  pylist candidates,
+  const std::string &candidate_property,
+  std::string query,
+  const size_t max_candidates,
+  const QueryOptions &options ) {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "FilterAndSortCandidatesWithMatchPositions" );
+  ScopedLatencyTimer timer( latency );
+  CandidateStrings candidate_strings =
+    CandidateStringsFromObjectList( candidates, candidate_property );
 
-      if ( result.IsSubsequence() ) {
-        result_and_objects.emplace_back( result, i );
-      }
-    }
+  std::vector< ResultAnd< size_t > > result_and_objects;
+  std::vector< MatchPositions > positions;
+  {
+    pybind11::gil_scoped_release unlock;
+    // Results don't own their query so keep one for computing the positions.
+    Word query_object{ std::string( query ) };
+    std::vector< const Candidate * > repository_candidates =
+      CandidatesFromStrings( candidate_strings );
+    result_and_objects = FilterAndSortRepositoryCandidates(
+      repository_candidates, std::move( query ), max_candidates, options );
 
-    PartialSort( result_and_objects, max_candidates );
+    positions.reserve( result_and_objects.size() );
+    for ( const auto &result_and_object : result_and_objects ) {
+      positions.push_back(
+        repository_candidates[ result_and_object.extra_object_ ]
+          ->QueryMatchPositions( query_object ) );
+    }
   }
 
-  for ( const ResultAnd< size_t > &result_and_object : result_and_objects ) {
-    filtered_candidates.append( candidates[ result_and_object.extra_object_ ] );
+  pylist filtered_candidates;
+  for ( size_t i = 0; i < result_and_objects.size(); ++i ) {
+    filtered_candidates.append( pybind11::make_tuple(
+      candidates[ result_and_objects[ i ].extra_object_ ],
+      std::move( positions[ i ] ) ) );
   }
 
   return filtered_candidates;
 }
 
 
+FilterSession::FilterSession( pylist candidates,
+                              const std::string &candidate_property )
+  : candidates_( candidates ) {
+  CandidateStrings candidate_strings =
+    CandidateStringsFromObjectList( candidates, candidate_property );
+
+  pybind11::gil_scoped_release unlock;
+  repository_candidates_ = CandidatesFromStrings( candidate_strings );
+}
+
+
+pylist FilterSession::FilterAndSortCandidates(
+  std::string query,
+  const size_t max_candidates,
+  const QueryOptions &options ) const {
+  static LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "FilterSession::FilterAndSortCandidates" );
+  ScopedLatencyTimer timer( latency );
+  std::vector< ResultAnd< size_t > > result_and_objects;
+  {
+    pybind11::gil_scoped_release unlock;
+    result_and_objects = FilterAndSortRepositoryCandidates(
+      repository_candidates_, std::move( query ), max_candidates, options );
+  }
+
+  return ObjectsFromResults( candidates_, result_and_objects );
+}
+
+
+size_t FilterSession::NumCandidates() const {
+  return repository_candidates_.size();
+}
+
+
+std::string CompletionsToJson( pybind11::handle completions ) {
+  std::string json;
+  AppendJson( completions, json );
+  return json;
+}
+
+
 std::string GetUtf8String( const object &value ) {
   // If already a unicode or string (or something derived from it)
   // pybind will already convert to utf8 when converting to std::string.
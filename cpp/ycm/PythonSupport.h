@@ -18,21 +18,69 @@
 #ifndef PYTHONSUPPORT_H_KWGFEX0V
 #define PYTHONSUPPORT_H_KWGFEX0V
 
+#include "QueryOptions.h"
+
 #include <pybind11/pybind11.h>
 
+#include <string>
+#include <vector>
+
 namespace YouCompleteMe {
 
+class Candidate;
+
 /// Given a list of python objects (that represent completion candidates) in a
 /// python list |candidates|, a |candidate_property| on which to filter and sort
 /// the candidates and a user query, returns a new sorted python list with the
 /// original objects that survived the filtering. This list contains at most
 /// |max_candidates|. If |max_candidates| is omitted or 0, all candidates are
-/// sorted.
+/// sorted. Candidates rejected by |options| are dropped before sorting.
 YCM_EXPORT pybind11::list FilterAndSortCandidates(
   pybind11::list candidates,
   const std::string &candidate_property,
   std::string query,
-  const size_t max_candidates = 0 );
+  const size_t max_candidates = 0,
+  const QueryOptions &options = QueryOptions() );
+
+/// Same as FilterAndSortCandidates but returns a list of (candidate, positions)
+/// tuples where positions is a MatchPositions object holding the offsets of
+/// the characters matched by the query in the candidate, e.g. to highlight
+/// them. Positions are only computed for the returned candidates.
+YCM_EXPORT pybind11::list FilterAndSortCandidatesWithMatchPositions(
+  pybind11::list candidates,
+  const std::string &candidate_property,
+  std::string query,
+  const size_t max_candidates = 0,
+  const QueryOptions &options = QueryOptions() );
+
+/// Same as FilterAndSortCandidates but for successive queries on the same list
+/// of candidates, e.g. the cached completions of a semantic completer. The
+/// candidate strings are extracted and resolved once, on construction, so that
+/// each query only costs the matching and sorting. The list is copied so later
+/// changes to it are not seen by the session.
+class FilterSession {
+public:
+  YCM_EXPORT FilterSession( pybind11::list candidates,
+                            const std::string &candidate_property );
+  FilterSession( const FilterSession& ) = delete;
+  FilterSession& operator=( const FilterSession& ) = delete;
+
+  YCM_EXPORT pybind11::list FilterAndSortCandidates(
+    std::string query,
+    const size_t max_candidates = 0,
+    const QueryOptions &options = QueryOptions() ) const;
+
+  YCM_EXPORT size_t NumCandidates() const;
+
+private:
+  pybind11::tuple candidates_;
+  std::vector< const Candidate * > repository_candidates_;
+};
+
+/// Encodes a list of completions, as built by responses.BuildCompletionData and
+/// returned by FilterAndSortCandidates, to JSON like handlers._JsonResponse
+/// would, so that the result can be spliced into a completion response.
+YCM_EXPORT std::string CompletionsToJson( pybind11::handle completions );
 
 /// Given a Python object that's supposed to be "string-like", returns a UTF-8
 /// encoded std::string. Raises an exception if the object can't be converted to
@@ -0,0 +1,48 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef QUERYOPTIONS_H_M3QH8XZA
+#define QUERYOPTIONS_H_M3QH8XZA
+
+#include "Candidate.h"
+
+namespace YouCompleteMe {
+
+// Restrictions on the candidates returned by a query. They are checked before
+// matching so that discarded candidates don't take the place of valid ones in
+// the top results.
+struct QueryOptions {
+  // Candidates with fewer characters are discarded.
+  size_t min_candidate_chars = 0;
+
+  // Candidates with more characters are discarded. No limit if zero.
+  size_t max_candidate_chars = 0;
+
+  // Whether to discard the candidate equal to the query.
+  bool exclude_query = false;
+
+  inline bool Accepts( const Candidate &candidate, const Word &query ) const {
+    size_t length = candidate.Length();
+    return length >= min_candidate_chars &&
+           ( max_candidate_chars == 0 || length <= max_candidate_chars ) &&
+           !( exclude_query && candidate.Text() == query.Text() );
+  }
+};
+
+} // namespace YouCompleteMe
+
+#endif /* end of include guard: QUERYOPTIONS_H_M3QH8XZA */
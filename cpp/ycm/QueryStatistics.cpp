@@ -0,0 +1,100 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "QueryStatistics.h"
+
+namespace YouCompleteMe {
+
+namespace {
+
+// Number of queries whose statistics are kept.
+const size_t MAX_RECENT_QUERIES = 64;
+
+}  // unnamed namespace
+
+
+QueryStatisticsRegistry &QueryStatisticsRegistry::Instance() {
+  static QueryStatisticsRegistry registry;
+  return registry;
+}
+
+
+void QueryStatisticsRegistry::Record( QueryStatistics &&statistics ) {
+  auto add = []( std::atomic< uint64_t > &counter, uint64_t value ) {
+    counter.fetch_add( value, std::memory_order_relaxed );
+  };
+  add( num_queries_, statistics.num_queries );
+  add( num_visited_candidates_, statistics.num_visited_candidates );
+  add( num_prefilter_rejections_, statistics.num_prefilter_rejections );
+  add( num_subsequence_failures_, statistics.num_subsequence_failures );
+  add( num_matches_, statistics.num_matches );
+  add( lock_wait_ns_, statistics.lock_wait_ns );
+  add( matching_ns_, statistics.matching_ns );
+  add( lcs_ns_, statistics.lcs_ns );
+  add( sort_ns_, statistics.sort_ns );
+
+  std::lock_guard locker( recent_queries_mutex_ );
+  if ( recent_queries_.size() == MAX_RECENT_QUERIES ) {
+    recent_queries_.pop_front();
+  }
+  recent_queries_.push_back( std::move( statistics ) );
+}
+
+
+QueryStatistics QueryStatisticsRegistry::Totals() const {
+  auto load = []( const std::atomic< uint64_t > &counter ) {
+    return counter.load( std::memory_order_relaxed );
+  };
+  QueryStatistics totals;
+  totals.source = "total";
+  totals.num_queries = load( num_queries_ );
+  totals.num_visited_candidates = load( num_visited_candidates_ );
+  totals.num_prefilter_rejections = load( num_prefilter_rejections_ );
+  totals.num_subsequence_failures = load( num_subsequence_failures_ );
+  totals.num_matches = load( num_matches_ );
+  totals.lock_wait_ns = load( lock_wait_ns_ );
+  totals.matching_ns = load( matching_ns_ );
+  totals.lcs_ns = load( lcs_ns_ );
+  totals.sort_ns = load( sort_ns_ );
+  return totals;
+}
+
+
+std::vector< QueryStatistics > QueryStatisticsRegistry::RecentQueries() const {
+  std::lock_guard locker( recent_queries_mutex_ );
+  return { recent_queries_.begin(), recent_queries_.end() };
+}
+
+
+void QueryStatisticsRegistry::Clear() {
+  for ( auto *counter : { &num_queries_,
+                          &num_visited_candidates_,
+                          &num_prefilter_rejections_,
+                          &num_subsequence_failures_,
+                          &num_matches_,
+                          &lock_wait_ns_,
+                          &matching_ns_,
+                          &lcs_ns_,
+                          &sort_ns_ } ) {
+    *counter = 0;
+  }
+
+  std::lock_guard locker( recent_queries_mutex_ );
+  recent_queries_.clear();
+}
+
+} // namespace YouCompleteMe
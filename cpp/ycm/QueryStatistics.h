@@ -0,0 +1,125 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef QUERYSTATISTICS_H_R8DJ2MXC
+#define QUERYSTATISTICS_H_R8DJ2MXC
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace YouCompleteMe {
+
+// What happened during one or more queries of the identifier engine. Durations
+// are in nanoseconds.
+struct QueryStatistics {
+  // "identifier" for queries of the identifier completer, "filter" for
+  // FilterAndSortCandidates, "clang" for the filtering of clang completions,
+  // "total" for the aggregate of all queries.
+  std::string source;
+  std::string query;
+
+  // Number of queries aggregated in these statistics.
+  uint64_t num_queries = 0;
+
+  uint64_t num_visited_candidates = 0;
+  // Candidates discarded before matching by the query options or because they
+  // don't contain the bytes of the query.
+  uint64_t num_prefilter_rejections = 0;
+  // Candidates containing the bytes of the query but not as a subsequence.
+  uint64_t num_subsequence_failures = 0;
+  uint64_t num_matches = 0;
+
+  uint64_t lock_wait_ns = 0;
+  // Prefilter and subsequence matching.
+  uint64_t matching_ns = 0;
+  // Word boundary features of the matches.
+  uint64_t lcs_ns = 0;
+  uint64_t sort_ns = 0;
+};
+
+
+// Measures the consecutive steps of a query. The timer starts on
+// construction.
+class QueryTimer {
+public:
+  QueryTimer() : start_( std::chrono::steady_clock::now() ) {}
+
+  void Restart() {
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  // Returns the nanoseconds elapsed since the timer started and restarts it.
+  uint64_t Lap() {
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >(
+      now - start_ );
+    start_ = now;
+    return static_cast< uint64_t >( elapsed.count() );
+  }
+
+private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+
+// This singleton aggregates the statistics of all queries in atomic counters
+// and keeps the statistics of the last queries.
+//
+// This class is thread-safe.
+class QueryStatisticsRegistry {
+public:
+  YCM_EXPORT static QueryStatisticsRegistry &Instance();
+  // Make class noncopyable
+  QueryStatisticsRegistry( const QueryStatisticsRegistry& ) = delete;
+  QueryStatisticsRegistry& operator=(
+    const QueryStatisticsRegistry& ) = delete;
+
+  YCM_EXPORT void Record( QueryStatistics &&statistics );
+
+  YCM_EXPORT QueryStatistics Totals() const;
+
+  // Oldest first.
+  YCM_EXPORT std::vector< QueryStatistics > RecentQueries() const;
+
+  YCM_EXPORT void Clear();
+
+private:
+  QueryStatisticsRegistry() = default;
+  ~QueryStatisticsRegistry() = default;
+
+  std::atomic< uint64_t > num_queries_ = 0;
+  std::atomic< uint64_t > num_visited_candidates_ = 0;
+  std::atomic< uint64_t > num_prefilter_rejections_ = 0;
+  std::atomic< uint64_t > num_subsequence_failures_ = 0;
+  std::atomic< uint64_t > num_matches_ = 0;
+  std::atomic< uint64_t > lock_wait_ns_ = 0;
+  std::atomic< uint64_t > matching_ns_ = 0;
+  std::atomic< uint64_t > lcs_ns_ = 0;
+  std::atomic< uint64_t > sort_ns_ = 0;
+
+  std::deque< QueryStatistics > recent_queries_;
+  mutable std::mutex recent_queries_mutex_;
+};
+
+} // namespace YouCompleteMe
+
+#endif /* end of include guard: QUERYSTATISTICS_H_R8DJ2MXC */
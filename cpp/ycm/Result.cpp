@@ -56,7 +56,8 @@ size_t LongestCommonSubsequenceLength( const CharacterSequence &first,
 Result::Result( const Candidate *candidate,
                 const Word *query,
                 size_t char_match_index_sum,
-                bool query_is_candidate_prefix )
+                bool query_is_candidate_prefix,
+                bool set_features )
   : is_subsequence_( true ),
     first_char_same_in_query_and_text_( false ),
     query_is_candidate_prefix_( query_is_candidate_prefix ),
@@ -64,7 +65,9 @@ Result::Result( const Candidate *candidate,
     num_wb_matches_( 0 ),
     candidate_( candidate ),
     query_( query ) {
-  SetResultFeaturesFromQuery();
+  if ( set_features ) {
+    SetResultFeaturesFromQuery();
+  }
 }
 
 
@@ -35,17 +35,22 @@ public:
     candidate_( nullptr ),
     query_( nullptr ) {}
 
-  Result( const Candidate *candidate,
-          const Word *query,
-          size_t char_match_index_sum,
-          bool query_is_candidate_prefix );
+  YCM_EXPORT Result( const Candidate *candidate,
+                     const Word *query,
+                     size_t char_match_index_sum,
+                     bool query_is_candidate_prefix,
+                     bool set_features = true );
 
-  bool operator< ( const Result &other ) const;
+  YCM_EXPORT bool operator< ( const Result &other ) const;
 
   inline const std::string &Text() const {
     return candidate_->Text();
   }
 
+  inline const Candidate *GetCandidate() const {
+    return candidate_;
+  }
+
   inline size_t NumWordBoundaryChars() const {
     return candidate_->WordBoundaryChars().size();
   }
@@ -54,9 +59,12 @@ public:
     return is_subsequence_;
   }
 
-private:
+  // Computes the features depending on the word boundary characters. Only
+  // needed for results constructed with |set_features| set to false.
   void SetResultFeaturesFromQuery();
 
+private:
+
   // true when the characters of the query are a subsequence of the characters
   // in the candidate text, e.g. the characters "abc" are a subsequence for
   // "xxaygbefc" but not for "axxcb" since they occur in the correct order ('a'
@@ -0,0 +1,273 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace YouCompleteMe {
+
+namespace {
+
+const size_t NO_WORKER = static_cast< size_t >( -1 );
+
+// Index of the worker running on this thread.
+thread_local size_t current_worker_index = NO_WORKER;
+
+
+bool PopFront( std::deque< std::function< void() > > &queue,
+               std::function< void() > &task ) {
+  if ( queue.empty() ) {
+    return false;
+  }
+  task = std::move( queue.front() );
+  queue.pop_front();
+  return true;
+}
+
+}  // unnamed namespace
+
+
+ThreadPool &ThreadPool::Instance() {
+  static ThreadPool pool;
+  return pool;
+}
+
+
+ThreadPool::~ThreadPool() {
+  Shutdown();
+}
+
+
+void ThreadPool::SetNumThreads( size_t num_threads ) {
+  Shutdown();
+  std::lock_guard locker( mutex_ );
+  num_threads_ = num_threads;
+}
+
+
+size_t ThreadPool::NumThreads() const {
+  std::lock_guard locker( mutex_ );
+  if ( num_threads_ ) {
+    return num_threads_;
+  }
+  return std::max( std::thread::hardware_concurrency(), 1u );
+}
+
+
+void ThreadPool::Shutdown() {
+  std::lock_guard shutdown_locker( shutdown_mutex_ );
+  {
+    std::lock_guard locker( mutex_ );
+    stop_ = true;
+    condition_.notify_all();
+  }
+
+  // The set of workers only changes while there is none running.
+  for ( auto &worker : workers_ ) {
+    worker->thread.join();
+  }
+
+  // The discarded tasks are destroyed outside the lock since they may hold
+  // arbitrary objects.
+  std::vector< std::unique_ptr< Worker > > workers;
+  TaskQueues shared_queues;
+  {
+    std::lock_guard locker( mutex_ );
+    workers.swap( workers_ );
+    shared_queues.swap( shared_queues_ );
+    num_queued_tasks_ = 0;
+    stop_ = false;
+  }
+}
+
+
+void ThreadPool::Push( Task &&task, TaskPriority priority ) {
+  size_t priority_index = static_cast< size_t >( priority );
+  std::lock_guard locker( mutex_ );
+
+  if ( workers_.empty() ) {
+    size_t num_threads = num_threads_ ?
+      num_threads_ :
+      std::max( std::thread::hardware_concurrency(), 1u );
+    for ( size_t index = 0; index < num_threads; ++index ) {
+      workers_.push_back( std::make_unique< Worker >() );
+    }
+    for ( size_t index = 0; index < num_threads; ++index ) {
+      workers_[ index ]->thread = std::thread( &ThreadPool::WorkerLoop,
+                                               this,
+                                               index );
+    }
+  }
+
+  if ( current_worker_index != NO_WORKER &&
+       current_worker_index < workers_.size() ) {
+    Worker &worker = *workers_[ current_worker_index ];
+    std::lock_guard worker_locker( worker.queues_mutex );
+    worker.queues[ priority_index ].push_back( std::move( task ) );
+  } else {
+    shared_queues_[ priority_index ].push_back( std::move( task ) );
+  }
+
+  // Incremented under the lock so that sleeping workers don't miss it.
+  ++num_queued_tasks_;
+  condition_.notify_one();
+}
+
+
+bool ThreadPool::PopTask( size_t worker_index, Task &task ) {
+  for ( size_t priority = 0; priority < shared_queues_.size(); ++priority ) {
+    if ( worker_index != NO_WORKER ) {
+      // Workers don't need the lock to access their own queues: the set of
+      // workers only changes once they are joined.
+      Worker &worker = *workers_[ worker_index ];
+      std::lock_guard worker_locker( worker.queues_mutex );
+      auto &queue = worker.queues[ priority ];
+      if ( !queue.empty() ) {
+        task = std::move( queue.back() );
+        queue.pop_back();
+        --num_queued_tasks_;
+        return true;
+      }
+    }
+
+    std::lock_guard locker( mutex_ );
+    if ( PopSharedOrStolenTaskNoLock( worker_index, priority, task ) ) {
+      --num_queued_tasks_;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// WARNING: You need to hold the mutex_ before calling this function.
+bool ThreadPool::PopSharedOrStolenTaskNoLock( size_t worker_index,
+                                              size_t priority,
+                                              Task &task ) {
+  if ( PopFront( shared_queues_[ priority ], task ) ) {
+    return true;
+  }
+
+  for ( size_t index = 0; index < workers_.size(); ++index ) {
+    if ( index == worker_index ) {
+      continue;
+    }
+    Worker &worker = *workers_[ index ];
+    std::lock_guard worker_locker( worker.queues_mutex );
+    if ( PopFront( worker.queues[ priority ], task ) ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void ThreadPool::WorkerLoop( size_t worker_index ) {
+  current_worker_index = worker_index;
+
+  while ( !stop_ ) {
+    Task task;
+    if ( PopTask( worker_index, task ) ) {
+      task();
+      continue;
+    }
+
+    std::unique_lock locker( mutex_ );
+    condition_.wait( locker, [ this ] {
+      return stop_ || num_queued_tasks_ > 0;
+    } );
+  }
+
+  // Tasks left in the queues of this worker are discarded by Shutdown.
+  current_worker_index = NO_WORKER;
+}
+
+
+TaskGroup::TaskGroup()
+  : state_( std::make_shared< State >() ) {
+}
+
+
+void TaskGroup::Wait() {
+  for ( const auto &weak_task : tasks_ ) {
+    if ( auto task = weak_task.lock() ) {
+      task->Run();
+    }
+  }
+  tasks_.clear();
+
+  std::unique_lock locker( state_->mutex );
+  state_->condition.wait( locker, [ this ] {
+    return state_->num_pending_tasks == 0;
+  } );
+}
+
+
+void TaskGroup::Push( std::function< void() > &&function,
+                      TaskPriority priority ) {
+  // Forget the tasks that the pool already ran or discarded.
+  tasks_.erase( std::remove_if( tasks_.begin(),
+                                tasks_.end(),
+                                []( const std::weak_ptr< Task > &task ) {
+                                  return task.expired();
+                                } ),
+                tasks_.end() );
+
+  {
+    std::lock_guard locker( state_->mutex );
+    ++state_->num_pending_tasks;
+  }
+  auto task = std::make_shared< Task >( std::move( function ), state_ );
+  tasks_.push_back( task );
+  ThreadPool::Instance().Push( [ task ] { task->Run(); }, priority );
+}
+
+
+TaskGroup::Task::Task( std::function< void() > &&function,
+                       std::shared_ptr< State > state )
+  : function_( std::move( function ) ),
+    claimed_( false ),
+    state_( std::move( state ) ) {
+}
+
+
+TaskGroup::Task::~Task() {
+  if ( !claimed_ ) {
+    function_ = nullptr;
+    Finish();
+  }
+}
+
+
+void TaskGroup::Task::Run() {
+  if ( claimed_.exchange( true ) ) {
+    return;
+  }
+  function_();
+  function_ = nullptr;
+  Finish();
+}
+
+
+void TaskGroup::Task::Finish() {
+  std::lock_guard locker( state_->mutex );
+  --state_->num_pending_tasks;
+  state_->condition.notify_all();
+}
+
+} // namespace YouCompleteMe
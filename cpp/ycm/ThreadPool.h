@@ -0,0 +1,240 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef THREADPOOL_H_K4WN7QZE
+#define THREADPOOL_H_K4WN7QZE
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace YouCompleteMe {
+
+// Queued tasks of higher priority are started first.
+enum class TaskPriority : uint8_t {
+  HIGH = 0,
+  NORMAL,
+  LOW
+};
+
+
+// Shared flag telling tasks that their work is no longer needed. Tasks
+// cancelled before they start are not run; running tasks are expected to poll
+// IsCancelled() and return early.
+class CancellationToken {
+public:
+  CancellationToken()
+    : cancelled_( std::make_shared< std::atomic< bool > >( false ) ) {
+  }
+
+  void Cancel() const {
+    *cancelled_ = true;
+  }
+
+  bool IsCancelled() const {
+    return *cancelled_;
+  }
+
+private:
+  std::shared_ptr< std::atomic< bool > > cancelled_;
+};
+
+
+// Stored in the future of a task cancelled before it started.
+class TaskCancelled : public std::runtime_error {
+public:
+  TaskCancelled() : std::runtime_error( "Task was cancelled." ) {}
+};
+
+
+// This singleton runs tasks on a set of worker threads started on the first
+// submission. Each worker has its own queues where the tasks it submits are
+// pushed and taken back in LIFO order; tasks submitted by other threads go to
+// shared queues. Idle workers take tasks from the shared queues first, then
+// steal the oldest tasks of the other workers.
+//
+// Threads waiting for tasks they split their work into must submit them
+// through a TaskGroup so that tasks waiting for other tasks cannot exhaust the
+// workers.
+//
+// This class is thread-safe.
+class ThreadPool {
+public:
+  YCM_EXPORT static ThreadPool &Instance();
+  // Make class noncopyable
+  ThreadPool( const ThreadPool& ) = delete;
+  ThreadPool& operator=( const ThreadPool& ) = delete;
+
+  // Sets the number of worker threads. Zero means one per hardware thread.
+  // Running workers are shut down first.
+  YCM_EXPORT void SetNumThreads( size_t num_threads );
+
+  YCM_EXPORT size_t NumThreads() const;
+
+  template< typename Function >
+  std::future< std::invoke_result_t< Function > > Submit(
+    Function function,
+    TaskPriority priority = TaskPriority::NORMAL,
+    CancellationToken token = CancellationToken() );
+
+  // Waits for the running tasks, stops the workers and discards the queued
+  // tasks. Their futures report a broken promise. The pool starts again on the
+  // next submission. Must not be called from a task.
+  YCM_EXPORT void Shutdown();
+
+private:
+  friend class TaskGroup;
+
+  using Task = std::function< void() >;
+  using TaskQueues = std::array< std::deque< Task >, 3 >;
+
+  struct Worker {
+    TaskQueues queues;
+    std::mutex queues_mutex;
+    std::thread thread;
+  };
+
+  ThreadPool() = default;
+  ~ThreadPool();
+
+  YCM_EXPORT void Push( Task &&task, TaskPriority priority );
+
+  bool PopTask( size_t worker_index, Task &task );
+  bool PopSharedOrStolenTaskNoLock( size_t worker_index,
+                                    size_t priority,
+                                    Task &task );
+  void WorkerLoop( size_t worker_index );
+
+  std::vector< std::unique_ptr< Worker > > workers_;
+  TaskQueues shared_queues_;
+  size_t num_threads_ = 0;
+  std::atomic< size_t > num_queued_tasks_ = 0;
+  std::atomic< bool > stop_ = false;
+  // Guards the shared queues and the set of workers. Must be acquired before
+  // the queues mutex of a worker.
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  // Serializes shutdowns.
+  std::mutex shutdown_mutex_;
+};
+
+
+template< typename Function >
+std::future< std::invoke_result_t< Function > > ThreadPool::Submit(
+  Function function,
+  TaskPriority priority,
+  CancellationToken token ) {
+  using ReturnType = std::invoke_result_t< Function >;
+
+  // Task must be copyable; packaged_task is not.
+  auto task = std::make_shared< std::packaged_task< ReturnType() > >(
+    [ function = std::move( function ),
+      token = std::move( token ) ]() mutable -> ReturnType {
+      if ( token.IsCancelled() ) {
+        throw TaskCancelled();
+      }
+      return function();
+    } );
+  std::future< ReturnType > future = task->get_future();
+  Push( [ task ] { ( *task )(); }, priority );
+  return future;
+}
+
+
+// Tasks of the thread pool that a thread waits for, e.g. the chunks of a job
+// split across the pool. Wait() runs on the calling thread the tasks of the
+// group that no worker started yet, and only those: waiting never runs
+// unrelated tasks like a long parse, and tasks waiting for their own subtasks
+// cannot exhaust the workers since they only block on running tasks.
+//
+// This class is not thread-safe but its tasks may run on any thread.
+class TaskGroup {
+public:
+  YCM_EXPORT TaskGroup();
+  TaskGroup( const TaskGroup& ) = delete;
+  TaskGroup& operator=( const TaskGroup& ) = delete;
+
+  template< typename Function >
+  std::future< std::invoke_result_t< Function > > Submit(
+    Function function,
+    TaskPriority priority = TaskPriority::NORMAL );
+
+  // Returns once all the tasks submitted so far are finished or discarded by a
+  // shutdown of the pool. Their futures are then ready.
+  YCM_EXPORT void Wait();
+
+private:
+  struct State {
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t num_pending_tasks = 0;
+  };
+
+  // Run by whichever of a worker and Wait() gets to it first.
+  class Task {
+  public:
+    Task( std::function< void() > &&function, std::shared_ptr< State > state );
+    Task( const Task& ) = delete;
+    Task& operator=( const Task& ) = delete;
+    // Discarding the task before it runs breaks the promise of its future.
+    ~Task();
+
+    void Run();
+
+  private:
+    void Finish();
+
+    std::function< void() > function_;
+    std::atomic< bool > claimed_;
+    std::shared_ptr< State > state_;
+  };
+
+  YCM_EXPORT void Push( std::function< void() > &&function,
+                        TaskPriority priority );
+
+  std::shared_ptr< State > state_;
+  // The tasks are owned by the queues of the pool.
+  std::vector< std::weak_ptr< Task > > tasks_;
+};
+
+
+template< typename Function >
+std::future< std::invoke_result_t< Function > > TaskGroup::Submit(
+  Function function,
+  TaskPriority priority ) {
+  using ReturnType = std::invoke_result_t< Function >;
+
+  auto task = std::make_shared< std::packaged_task< ReturnType() > >(
+    std::move( function ) );
+  std::future< ReturnType > future = task->get_future();
+  Push( [ task ] { ( *task )(); }, priority );
+  return future;
+}
+
+} // namespace YouCompleteMe
+
+#endif /* end of include guard: THREADPOOL_H_K4WN7QZE */
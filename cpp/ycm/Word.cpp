@@ -286,10 +286,75 @@ void Word::ComputeBytesPresent() {
 }
 
 
+std::vector< size_t > Word::CharacterByteOffsets() const {
+  std::vector< size_t > offsets;
+  offsets.reserve( characters_.size() + 1 );
+
+  // Each character is a single byte.
+  if ( characters_.size() == text_.size() ) {
+    for ( size_t offset = 0; offset <= text_.size(); ++offset ) {
+      offsets.push_back( offset );
+    }
+    return offsets;
+  }
+
+  // Characters are made of the normalized code points of the text so the
+  // lengths of the characters don't give the offsets. Instead, count the code
+  // points of the text that make up each character.
+  const CodePointSequence &code_points = BreakIntoCodePoints( text_ );
+  std::vector< std::string > characters =
+    BreakCodePointsIntoCharacters( code_points );
+
+  auto code_point_pos = code_points.begin();
+  size_t offset = 0;
+  for ( const auto &character : characters ) {
+    offsets.push_back( offset );
+
+    size_t normal_length = 0;
+    while ( normal_length < character.size() &&
+            code_point_pos != code_points.end() ) {
+      normal_length += ( *code_point_pos )->Normal().size();
+      ++code_point_pos;
+
+      // Skip the continuation bytes of the code point.
+      ++offset;
+      while ( offset < text_.size() &&
+              ( static_cast< uint8_t >( text_[ offset ] ) & 0xc0 ) == 0x80 ) {
+        ++offset;
+      }
+    }
+  }
+  offsets.push_back( text_.size() );
+
+  return offsets;
+}
+
+
+void Word::ComputeCharacterClass() {
+  // A grapheme cluster may be made of several ASCII bytes (CR followed by LF).
+  if ( characters_.size() != text_.size() ) {
+    character_class_ = CharacterClass::UNICODE;
+    return;
+  }
+
+  character_class_ = CharacterClass::LOWERCASE_ASCII;
+  for ( auto byte : text_ ) {
+    if ( static_cast< uint8_t >( byte ) >= 0x80 ) {
+      character_class_ = CharacterClass::UNICODE;
+      return;
+    }
+    if ( 'A' <= byte && byte <= 'Z' ) {
+      character_class_ = CharacterClass::ASCII;
+    }
+  }
+}
+
+
 Word::Word( std::string&& text )
   : text_( std::move( text ) ) {
   BreakIntoCharacters();
   ComputeBytesPresent();
+  ComputeCharacterClass();
 }
 
 } // namespace YouCompleteMe
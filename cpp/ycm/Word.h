@@ -31,6 +31,16 @@ namespace YouCompleteMe {
 using Bitset = std::bitset< NUM_BYTES >;
 
 
+// Classes of words used to pick the fastest way to match a query against a
+// candidate. A word is ASCII if each of its characters is a single ASCII byte
+// and LOWERCASE_ASCII if additionally none of them is uppercase.
+enum class CharacterClass : uint8_t {
+  LOWERCASE_ASCII,
+  ASCII,
+  UNICODE
+};
+
+
 // This class represents a sequence of UTF-8 characters. It takes a UTF-8
 // encoded string and splits that string into characters following the rules in
 // https://www.unicode.org/reports/tr29/tr29-37.html#Grapheme_Cluster_Boundary_Rules
@@ -66,13 +76,24 @@ public:
     return characters_.empty();
   }
 
+  inline CharacterClass GetCharacterClass() const {
+    return character_class_;
+  }
+
+  // Returns the offset in the text of the first byte of each character,
+  // followed by the size of the text. This is computed on each call so it
+  // should only be used on a few words.
+  YCM_EXPORT std::vector< size_t > CharacterByteOffsets() const;
+
 private:
   void BreakIntoCharacters();
   void ComputeBytesPresent();
+  void ComputeCharacterClass();
 
   std::string text_;
   CharacterSequence characters_;
   Bitset bytes_present_;
+  CharacterClass character_class_;
 };
 
 } // namespace YouCompleteMe
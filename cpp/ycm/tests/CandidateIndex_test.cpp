@@ -0,0 +1,133 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CandidateIndex.h"
+#include "Candidate.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <deque>
+
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+namespace YouCompleteMe {
+
+class CandidateIndexTest : public ::testing::Test {
+protected:
+  const Candidate *MakeCandidate( std::string text ) {
+    candidates_.emplace_back( std::move( text ) );
+    return &candidates_.back();
+  }
+
+  std::vector< const Candidate * > Query( std::string query ) {
+    std::vector< const Candidate * > candidates;
+    EXPECT_TRUE( index_.CandidatesForQuery( Word( std::move( query ) ),
+                                            candidates ) );
+    return candidates;
+  }
+
+  std::deque< Candidate > candidates_;
+  CandidateIndex index_;
+};
+
+
+TEST_F( CandidateIndexTest, ShortQueriesAreNotHandled ) {
+  index_.AddCandidate( MakeCandidate( "foobar" ) );
+
+  std::vector< const Candidate * > candidates;
+  EXPECT_FALSE( index_.CandidatesForQuery( Word( "" ), candidates ) );
+  EXPECT_FALSE( index_.CandidatesForQuery( Word( "fo" ), candidates ) );
+  EXPECT_THAT( candidates, IsEmpty() );
+}
+
+
+TEST_F( CandidateIndexTest, NonAsciiBaseQueriesAreNotHandled ) {
+  index_.AddCandidate( MakeCandidate( "διακριτικός" ) );
+
+  std::vector< const Candidate * > candidates;
+  EXPECT_FALSE( index_.CandidatesForQuery( Word( "δια" ), candidates ) );
+  EXPECT_THAT( candidates, IsEmpty() );
+}
+
+
+TEST_F( CandidateIndexTest, ReturnsCandidatesContainingQueryPairs ) {
+  const Candidate *foobar = MakeCandidate( "foobar" );
+  const Candidate *FooBar = MakeCandidate( "FooBar" );
+  const Candidate *fooqux = MakeCandidate( "fooqux" );
+  const Candidate *accented = MakeCandidate( "fóóbár" );
+  index_.AddCandidate( foobar );
+  index_.AddCandidate( FooBar );
+  index_.AddCandidate( fooqux );
+  index_.AddCandidate( accented );
+
+  EXPECT_THAT( Query( "fbr" ),
+               UnorderedElementsAre( foobar, FooBar, accented ) );
+  EXPECT_THAT( Query( "FBR" ),
+               UnorderedElementsAre( foobar, FooBar, accented ) );
+  // The index only returns a superset of the matching candidates.
+  EXPECT_THAT( Query( "fóbá" ),
+               UnorderedElementsAre( foobar, FooBar, accented ) );
+  EXPECT_THAT( Query( "fqx" ), UnorderedElementsAre( fooqux ) );
+  EXPECT_THAT( Query( "zzz" ), IsEmpty() );
+  EXPECT_THAT( Query( "rbf" ), IsEmpty() );
+}
+
+
+TEST_F( CandidateIndexTest, CandidatesAreReferenceCounted ) {
+  const Candidate *foobar = MakeCandidate( "foobar" );
+  index_.AddCandidate( foobar );
+  index_.AddCandidate( foobar );
+  EXPECT_EQ( 1, index_.NumCandidates() );
+
+  index_.RemoveCandidate( foobar );
+  EXPECT_THAT( Query( "fbr" ), UnorderedElementsAre( foobar ) );
+
+  index_.RemoveCandidate( foobar );
+  EXPECT_EQ( 0, index_.NumCandidates() );
+  EXPECT_THAT( Query( "fbr" ), IsEmpty() );
+
+  index_.AddCandidate( foobar );
+  EXPECT_THAT( Query( "fbr" ), UnorderedElementsAre( foobar ) );
+}
+
+
+TEST_F( CandidateIndexTest, RebuildAfterManyRemovals ) {
+  std::vector< const Candidate * > removed;
+  for ( int i = 0; i < 3000; ++i ) {
+    const Candidate *candidate = MakeCandidate( "removed" +
+                                                std::to_string( i ) );
+    index_.AddCandidate( candidate );
+    removed.push_back( candidate );
+  }
+  const Candidate *foobar = MakeCandidate( "foobar" );
+  index_.AddCandidate( foobar );
+
+  for ( const Candidate *candidate : removed ) {
+    index_.RemoveCandidate( candidate );
+  }
+
+  EXPECT_EQ( 1, index_.NumCandidates() );
+  EXPECT_THAT( Query( "fbr" ), UnorderedElementsAre( foobar ) );
+  EXPECT_THAT( Query( "rmv" ), IsEmpty() );
+
+  const Candidate *remover = MakeCandidate( "remover" );
+  index_.AddCandidate( remover );
+  EXPECT_THAT( Query( "rmv" ), UnorderedElementsAre( remover ) );
+}
+
+} // namespace YouCompleteMe
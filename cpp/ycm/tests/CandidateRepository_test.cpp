@@ -20,6 +20,8 @@
 #include "Candidate.h"
 #include "Result.h"
 
+#include <future>
+
 namespace YouCompleteMe {
 
 class CandidateRepositoryTest : public ::testing::Test {
@@ -84,5 +86,83 @@ TEST_F( CandidateRepositoryTest, NonPrintableCandidates ) {
 }
 
 
+TEST_F( CandidateRepositoryTest, StringViewsGiveSameCandidates ) {
+  std::string buffer = "viewbar" + std::string( 81, 'a' );
+  std::vector< std::string_view > views;
+  views.push_back( std::string_view( buffer ).substr( 0, 3 ) );
+  views.push_back( buffer );
+  views.push_back( std::string_view( buffer ).substr( 0, 7 ) );
+
+  std::vector< const Candidate * > candidates =
+    repo_.GetCandidatesForStrings( views );
+  buffer.clear();
+
+  EXPECT_EQ( "vie", candidates[ 0 ]->Text() );
+  EXPECT_EQ( "", candidates[ 1 ]->Text() );
+  EXPECT_EQ( "viewbar", candidates[ 2 ]->Text() );
+
+  std::vector< std::string > inputs;
+  inputs.push_back( "viewbar" );
+  inputs.push_back( "vie" );
+
+  std::vector< const Candidate * > string_candidates =
+    repo_.GetCandidatesForStrings( std::move( inputs ) );
+
+  EXPECT_EQ( candidates[ 2 ], string_candidates[ 0 ] );
+  EXPECT_EQ( candidates[ 0 ], string_candidates[ 1 ] );
+  EXPECT_EQ( 3, repo_.NumStoredCandidates() );
+}
+
+
+TEST_F( CandidateRepositoryTest, StringsAreMovedIntoCandidates ) {
+  std::vector< std::string > inputs;
+  inputs.push_back( "moved_candidate_longer_than_the_small_string_buffer" );
+  inputs.push_back( inputs[ 0 ] );
+  const char *data = inputs[ 0 ].data();
+
+  std::vector< const Candidate * > candidates =
+    repo_.GetCandidatesForStrings( std::move( inputs ) );
+
+  ASSERT_EQ( 2, candidates.size() );
+  EXPECT_EQ( data, candidates[ 0 ]->Text().data() );
+  EXPECT_EQ( candidates[ 0 ], candidates[ 1 ] );
+}
+
+
+TEST_F( CandidateRepositoryTest, ManyCandidatesWithDuplicates ) {
+  std::vector< std::string > inputs;
+  for ( int i = 0; i < 5000; ++i ) {
+    inputs.push_back( "bulk" + std::to_string( i % 2500 ) );
+  }
+
+  std::vector< const Candidate * > candidates =
+    repo_.GetCandidatesForStrings( std::move( inputs ) );
+
+  ASSERT_EQ( 5000, candidates.size() );
+  for ( size_t i = 0; i < 2500; ++i ) {
+    EXPECT_EQ( "bulk" + std::to_string( i ), candidates[ i ]->Text() );
+    EXPECT_EQ( candidates[ i ], candidates[ i + 2500 ] );
+  }
+  EXPECT_EQ( 2500, repo_.NumStoredCandidates() );
+}
+
+
+TEST_F( CandidateRepositoryTest, ConcurrentRequestsGiveSameCandidates ) {
+  auto get_candidates = [ this ] {
+    std::vector< std::string > inputs;
+    for ( int i = 0; i < 2000; ++i ) {
+      inputs.push_back( "race" + std::to_string( i ) );
+    }
+    return repo_.GetCandidatesForStrings( std::move( inputs ) );
+  };
+
+  auto first = std::async( std::launch::async, get_candidates );
+  auto second = std::async( std::launch::async, get_candidates );
+
+  EXPECT_EQ( first.get(), second.get() );
+  EXPECT_EQ( 2000, repo_.NumStoredCandidates() );
+}
+
+
 } // namespace YouCompleteMe
 
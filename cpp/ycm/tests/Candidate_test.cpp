@@ -16,11 +16,15 @@
 // along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Candidate.h"
+#include "QueryOptions.h"
+#include "QueryStatistics.h"
 #include "Result.h"
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
 using ::testing::Not;
 
 namespace YouCompleteMe {
@@ -198,4 +202,110 @@ TEST( CandidateTest, QueryMatchResultIsNotSubsequence ) {
   EXPECT_THAT( "f𐍈oβaåaR", Not( IsSubsequence( "F𐍈oβaÅAr" ) ) );
 }
 
+
+TEST( CandidateTest, QueryMatchResultAsciiQuery ) {
+  EXPECT_THAT( "foa",  IsSubsequence( "Fooβaéar" ) );
+  EXPECT_THAT( "FEA",  Not( IsSubsequence( "Fooβaéar" ) ) );
+  EXPECT_THAT( "fear", IsSubsequence( "Fooβaéar" ) );
+  EXPECT_THAT( "Far",  IsSubsequence( "Fooβaéar" ) );
+  EXPECT_THAT( "FE",   IsSubsequence( "FooβaÉar" ) );
+  EXPECT_THAT( "sk",   IsSubsequence( "ſK" ) );
+  EXPECT_THAT( "K",    IsSubsequence( "ſK" ) );
+  EXPECT_THAT( "S",    Not( IsSubsequence( "ſK" ) ) );
+  EXPECT_THAT( "Fr_",  Not( IsSubsequence( "Fooβaéar" ) ) );
+  EXPECT_THAT( "b",    Not( IsSubsequence( "Fooβaéar" ) ) );
+}
+
+
+TEST( CandidateTest, FilteredQueryMatchResult ) {
+  QueryOptions options;
+  options.min_candidate_chars = 4;
+  QueryStatistics statistics;
+  Word query( "fo" );
+
+  EXPECT_TRUE( Candidate( "foobar" ).FilteredQueryMatchResult(
+                 query, options, true, &statistics ).IsSubsequence() );
+  // Too short.
+  EXPECT_FALSE( Candidate( "foo" ).FilteredQueryMatchResult(
+                  query, options, true, &statistics ).IsSubsequence() );
+  // Doesn't contain the bytes of the query.
+  EXPECT_FALSE( Candidate( "barbaz" ).FilteredQueryMatchResult(
+                  query, options, true, &statistics ).IsSubsequence() );
+  // Contains them but not as a subsequence.
+  EXPECT_FALSE( Candidate( "oof_bar" ).FilteredQueryMatchResult(
+                  query, options, true, &statistics ).IsSubsequence() );
+  EXPECT_FALSE( Candidate( "" ).FilteredQueryMatchResult(
+                  query, QueryOptions() ).IsSubsequence() );
+
+  EXPECT_EQ( 4u, statistics.num_visited_candidates );
+  EXPECT_EQ( 2u, statistics.num_prefilter_rejections );
+  EXPECT_EQ( 1u, statistics.num_subsequence_failures );
+  EXPECT_EQ( 1u, statistics.num_matches );
+}
+
+
+// The specialized ASCII matchers must give the same results as
+// Character::MatchesSmart.
+TEST( CandidateTest, QueryMatchResultSameAsSmartMatching ) {
+  std::vector< std::string > candidates = {
+    "Fooβaéar", "fooBar", "ſK", "éÉeE", "a\r\nb", "_x1X", "İi"
+  };
+  std::vector< std::string > queries = {
+    "f", "F", "a", "A", "ar", "aR", "Ar", "s", "S", "k", "K", "e", "E", "ee",
+    "EE", "eE", "\r", "\n", "ab", "_", "x", "X", "xx", "1x", "i", "I", "ii"
+  };
+
+  for ( const auto &text : candidates ) {
+    Candidate candidate{ std::string( text ) };
+    const CharacterSequence &candidate_characters = candidate.Characters();
+
+    for ( const auto &query_text : queries ) {
+      Word query{ std::string( query_text ) };
+
+      size_t query_index = 0;
+      size_t index_sum = 0;
+      bool is_prefix = false;
+      for ( size_t i = 0; i < candidate_characters.size() &&
+                          query_index < query.Length(); ++i ) {
+        if ( query.Characters()[ query_index ]->MatchesSmart(
+               *candidate_characters[ i ] ) ) {
+          index_sum += i;
+          is_prefix = i == query_index;
+          ++query_index;
+        }
+      }
+      bool is_subsequence = query_index == query.Length();
+
+      Result result = candidate.QueryMatchResult( query );
+      EXPECT_EQ( is_subsequence, result.IsSubsequence() )
+        << query_text << " in " << text;
+      if ( is_subsequence && result.IsSubsequence() ) {
+        // Results are ranked on the index sum and the prefix flag.
+        Result expected( &candidate, &query, index_sum, is_prefix );
+        EXPECT_FALSE( result < expected ) << query_text << " in " << text;
+        EXPECT_FALSE( expected < result ) << query_text << " in " << text;
+      }
+    }
+  }
+}
+
+
+TEST( CandidateTest, QueryMatchPositions ) {
+  MatchPositions positions =
+    Candidate( "fooBar" ).QueryMatchPositions( Word( "fb" ) );
+  EXPECT_THAT( positions.byte_offsets, ElementsAre( 0, 3 ) );
+  EXPECT_THAT( positions.code_point_offsets, ElementsAre( 0, 3 ) );
+
+  positions = Candidate( "fé𐍈bár" ).QueryMatchPositions( Word( "ear" ) );
+  EXPECT_THAT( positions.byte_offsets, ElementsAre( 1, 8, 10 ) );
+  EXPECT_THAT( positions.code_point_offsets, ElementsAre( 1, 4, 5 ) );
+
+  positions = Candidate( "fooBar" ).QueryMatchPositions( Word( "fB" ) );
+  EXPECT_THAT( positions.byte_offsets, ElementsAre( 0, 3 ) );
+
+  positions = Candidate( "fooBar" ).QueryMatchPositions( Word( "fbb" ) );
+  EXPECT_THAT( positions.byte_offsets, IsEmpty() );
+  EXPECT_THAT( positions.code_point_offsets, IsEmpty() );
+}
+
 } // namespace YouCompleteMe
@@ -349,4 +349,12 @@ TEST( CharacterTest, SmartMatching ) {
   EXPECT_FALSE( Character( "è" ).MatchesSmart( Character( "É" ) ) );
 }
 
+
+TEST( CharacterTest, IsAscii ) {
+  EXPECT_TRUE ( Character( "e" ).IsAscii() );
+  EXPECT_TRUE ( Character( "_" ).IsAscii() );
+  EXPECT_FALSE( Character( "é" ).IsAscii() );
+  EXPECT_FALSE( Character( "\r\n" ).IsAscii() );
+}
+
 } // namespace YouCompleteMe
@@ -21,6 +21,8 @@
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <chrono>
+#include <fstream>
 
 namespace YouCompleteMe {
 
@@ -29,6 +31,7 @@ using ::testing::WhenSorted;
 using ::testing::StrEq;
 using ::testing::Property;
 using ::testing::Contains;
+using ::testing::AllOf;
 
 TEST( ClangCompleterTest, CandidatesForLocationInFile ) {
   ClangCompleter completer;
@@ -54,6 +57,98 @@ TEST( ClangCompleterTest, CandidatesForLocationInFile ) {
 }
 
 
+TEST( ClangCompleterTest, FilteredCandidatesForLocationInFile ) {
+  ClangCompleter completer;
+  std::string filename = PathToTestFile( "basic.cpp" ).string();
+  std::vector< CompletionData > all_completions =
+    completer.CandidatesForLocationInFile( filename,
+                                           filename,
+                                           29,
+                                           7,
+                                           std::vector< UnsavedFile >(),
+                                           std::vector< std::string >() );
+  ASSERT_LT( 1u, all_completions.size() );
+
+  size_t num_completions;
+  std::vector< CompletionData > completions =
+    completer.CandidatesForLocationInFile( filename,
+                                           filename,
+                                           29,
+                                           7,
+                                           std::vector< UnsavedFile >(),
+                                           std::vector< std::string >(),
+                                           "",
+                                           1,
+                                           num_completions );
+  EXPECT_EQ( all_completions.size(), num_completions );
+  ASSERT_EQ( 1u, completions.size() );
+
+  // Cached completions give the same results.
+  for ( const auto &completion : all_completions ) {
+    completions =
+      completer.CandidatesForLocationInFile( filename,
+                                             filename,
+                                             29,
+                                             7,
+                                             std::vector< UnsavedFile >(),
+                                             std::vector< std::string >(),
+                                             completion.TextToInsertInBuffer(),
+                                             0,
+                                             num_completions );
+    EXPECT_EQ( all_completions.size(), num_completions );
+    ASSERT_FALSE( completions.empty() );
+    EXPECT_EQ( completion.TextToInsertInBuffer(),
+               completions[ 0 ].TextToInsertInBuffer() );
+    EXPECT_EQ( completion.DetailedInfoForPreviewWindow(),
+               completions[ 0 ].DetailedInfoForPreviewWindow() );
+  }
+}
+
+
+TEST( ClangCompleterTest, CachedCompletionsDroppedOnUpdate ) {
+  TemporaryDirectory directory;
+  fs::path header = directory.Path() / "header.h";
+  std::string source = ( directory.Path() / "source.cpp" ).string();
+  {
+    std::ofstream file( header );
+    file << "struct S { int a; };\n";
+  }
+  {
+    std::ofstream file( source );
+    file << "#include \"header.h\"\nvoid f() {\n  S s;\n  s.\n}\n";
+  }
+
+  ClangCompleter completer;
+  auto complete = [ & ] {
+    size_t num_completions;
+    completer.CandidatesForLocationInFile( source,
+                                           source,
+                                           4,
+                                           5,
+                                           std::vector< UnsavedFile >(),
+                                           std::vector< std::string >(),
+                                           "",
+                                           0,
+                                           num_completions );
+    return num_completions;
+  };
+  size_t num_completions = complete();
+  ASSERT_LT( 0u, num_completions );
+
+  fs::file_time_type header_time = fs::last_write_time( header );
+  {
+    std::ofstream file( header );
+    file << "struct S { int a; int b; };\n";
+  }
+  fs::last_write_time( header, header_time + std::chrono::seconds( 1 ) );
+  completer.UpdateTranslationUnit( source,
+                                   std::vector< UnsavedFile >(),
+                                   std::vector< std::string >() );
+
+  EXPECT_EQ( num_completions + 1, complete() );
+}
+
+
 TEST( ClangCompleterTest, BufferTextNoParens ) {
   ClangCompleter completer;
   std::vector< CompletionData > completions =
@@ -94,6 +189,36 @@ TEST( ClangCompleterTest, MemberFunctionWithDefaults ) {
 }
 
 
+TEST( ClangCompleterTest, CompletionDataOutlivesTranslationUnit ) {
+  ClangCompleter completer;
+  std::string filename = PathToTestFile( "basic.cpp" ).string();
+  std::vector< CompletionData > completions =
+    completer.CandidatesForLocationInFile( filename,
+                                           filename,
+                                           30,
+                                           7,
+                                           std::vector< UnsavedFile >(),
+                                           std::vector< std::string >() );
+  completer.DeleteCachesForFile( filename );
+
+  EXPECT_THAT( completions,
+               Contains( AllOf(
+                 Property( &CompletionData::TextToInsertInBuffer,
+                           StrEq( "foobar" ) ),
+                 Property( &CompletionData::ExtraMenuInfo,
+                           StrEq( "int" ) ),
+                 Property( &CompletionData::DetailedInfoForPreviewWindow,
+                           StrEq( "int foobar( int a, float b = 3.0, "
+                                  "char c = '\\n' )\n" ) ) ) ) );
+  EXPECT_THAT( completions,
+               Contains( AllOf(
+                 Property( &CompletionData::TextToInsertInBuffer,
+                           StrEq( "x" ) ),
+                 Property( &CompletionData::DocString,
+                           StrEq( "A docstring." ) ) ) ) );
+}
+
+
 TEST( ClangCompleterTest, CandidatesObjCForLocationInFile ) {
   ClangCompleter completer;
   std::vector< std::string > flags;
@@ -241,4 +366,37 @@ TEST( ClangCompleterTest, ExceptionThrownOnReparseFailure ) {
   }
 }
 
+
+TEST( ClangCompleterTest, UpdateTranslationUnitAsync ) {
+  ClangCompleter completer;
+
+  std::string filename = PathToTestFile( "unsaved_file.cpp" ).string();
+  UnsavedFile unsaved_file;
+  unsaved_file.filename_ = filename;
+  unsaved_file.contents_ = "int main() { return undeclared; }";
+  unsaved_file.length_ = unsaved_file.contents_.size();
+
+  DiagnosticsFuture update = completer.UpdateTranslationUnitAsync(
+    filename,
+    std::vector< UnsavedFile >{ unsaved_file },
+    std::vector< std::string >() );
+  std::vector< Diagnostic > diagnostics = update.Get();
+  EXPECT_TRUE( update.IsReady() );
+  ASSERT_EQ( 1u, diagnostics.size() );
+  EXPECT_EQ( 1u, diagnostics[ 0 ].location_.line_number_ );
+
+  EXPECT_EQ( diagnostics.size(),
+             completer.UpdateTranslationUnit(
+               filename,
+               std::vector< UnsavedFile >{ unsaved_file },
+               std::vector< std::string >() ).size() );
+
+  // Errors are rethrown by Get.
+  update = completer.UpdateTranslationUnitAsync(
+    filename,
+    std::vector< UnsavedFile >(),
+    std::vector< std::string >() );
+  EXPECT_THROW( update.Get(), ClangParseError );
+}
+
 } // namespace YouCompleteMe
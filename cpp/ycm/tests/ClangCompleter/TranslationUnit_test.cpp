@@ -23,7 +23,12 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <chrono>
 #include <clang-c/Index.h>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <thread>
 
 using ::testing::ElementsAre;
 using ::testing::WhenSorted;
@@ -185,6 +190,422 @@ TEST_F( TranslationUnitTest, InvalidTranslationUnitStore ) {
 }
 
 
+TEST_F( TranslationUnitTest, MemoryUsage ) {
+  TranslationUnit unit( PathToTestFile( "goto.cpp" ).string(),
+                        std::vector< UnsavedFile >(),
+                        std::vector< std::string >(),
+                        clang_index_ );
+  EXPECT_LT( 0u, unit.MemoryUsage() );
+
+  unit.Destroy();
+  EXPECT_EQ( 0u, unit.MemoryUsage() );
+  EXPECT_EQ( 0u, TranslationUnit().MemoryUsage() );
+}
+
+
+TEST_F( TranslationUnitTest, StoreEvictsLeastRecentlyUsedUnits ) {
+  std::string goto_file = PathToTestFile( "goto.cpp" ).string();
+  std::string basic_file = PathToTestFile( "basic.cpp" ).string();
+  TranslationUnitStore translation_unit_store{ clang_index_ };
+  translation_unit_store.SetMemoryBudget( 1 );
+
+  translation_unit_store.GetOrCreate( goto_file,
+                                      std::vector< UnsavedFile >(),
+                                      std::vector< std::string >() );
+  // Units in use are not evicted.
+  auto basic_unit = translation_unit_store.GetOrCreate(
+    basic_file,
+    std::vector< UnsavedFile >(),
+    std::vector< std::string >() );
+  EXPECT_FALSE( translation_unit_store.Get( goto_file ) );
+  EXPECT_EQ( basic_unit, translation_unit_store.Get( basic_file ) );
+
+  // Evicted units are created again.
+  bool translation_unit_created;
+  translation_unit_store.GetOrCreate( goto_file,
+                                      std::vector< UnsavedFile >(),
+                                      std::vector< std::string >(),
+                                      translation_unit_created );
+  EXPECT_TRUE( translation_unit_created );
+  EXPECT_TRUE( translation_unit_store.Get( goto_file ) );
+
+  // Pinned units are not evicted.
+  translation_unit_store.SetPinnedFiles( { goto_file } );
+  basic_unit.reset();
+  translation_unit_store.SetMemoryBudget( 2 );
+  EXPECT_TRUE( translation_unit_store.Get( goto_file ) );
+  EXPECT_FALSE( translation_unit_store.Get( basic_file ) );
+
+  // No limit.
+  translation_unit_store.SetPinnedFiles( {} );
+  translation_unit_store.SetMemoryBudget( 0 );
+  translation_unit_store.GetOrCreate( basic_file,
+                                      std::vector< UnsavedFile >(),
+                                      std::vector< std::string >() );
+  EXPECT_TRUE( translation_unit_store.Get( goto_file ) );
+  EXPECT_TRUE( translation_unit_store.Get( basic_file ) );
+}
+
+
+TEST_F( TranslationUnitTest, StoreWaitsForTranslationUnitCreation ) {
+  std::string test_file = PathToTestFile( "goto.cpp" ).string();
+  TranslationUnitStore translation_unit_store{ clang_index_ };
+
+  std::future< std::shared_ptr< TranslationUnit > > created_unit =
+    std::async( std::launch::async, [ & ] {
+      return translation_unit_store.GetOrCreate(
+        test_file,
+        std::vector< UnsavedFile >(),
+        std::vector< std::string >() );
+    } );
+
+  // Wait for the sentinel or the created TU.
+  while ( !translation_unit_store.Get( test_file ) ) {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+  }
+
+  bool translation_unit_created;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::minutes( 1 );
+  std::shared_ptr< TranslationUnit > unit = translation_unit_store.GetOrCreate(
+    test_file,
+    std::vector< UnsavedFile >(),
+    std::vector< std::string >(),
+    deadline,
+    translation_unit_created );
+
+  EXPECT_FALSE( translation_unit_created );
+  EXPECT_FALSE( unit->IsCurrentlyUpdating() );
+  EXPECT_EQ( created_unit.get(), unit );
+  EXPECT_EQ( unit, translation_unit_store.Get( test_file, deadline ) );
+}
+
+
+TEST_F( TranslationUnitTest, DoubleBufferedTranslationUnit ) {
+  auto test_file = PathToTestFile( "goto.cpp" ).string();
+  TranslationUnit unit( test_file,
+                        std::vector< UnsavedFile >(),
+                        std::vector< std::string >(),
+                        clang_index_,
+                        true );
+  size_t single_memory_usage = unit.MemoryUsage();
+
+  // The first reparse creates the back TU. Reparses are skipped if nothing
+  // changed so pass the file as unsaved.
+  std::ifstream file( test_file );
+  UnsavedFile unsaved_file;
+  unsaved_file.filename_ = test_file;
+  unsaved_file.contents_.assign( std::istreambuf_iterator< char >( file ),
+                                 std::istreambuf_iterator< char >() );
+  unsaved_file.length_ = unsaved_file.contents_.size();
+  unit.Reparse( std::vector< UnsavedFile >{ unsaved_file } );
+  EXPECT_LT( single_memory_usage, unit.MemoryUsage() );
+  EXPECT_FALSE( unit.IsCurrentlyUpdating() );
+
+  // Both TUs give the same answers.
+  for ( int i = 0; i < 2; ++i ) {
+    Location location = unit.GetDefinitionLocation(
+                          test_file,
+                          17,
+                          3,
+                          std::vector< UnsavedFile >() );
+
+    EXPECT_EQ( 1u, location.line_number_ );
+    EXPECT_EQ( 8u, location.column_number_ );
+  }
+
+  unit.Destroy();
+  EXPECT_EQ( 0u, unit.MemoryUsage() );
+}
+
+
+TEST_F( TranslationUnitTest, ReparseSkippedWhenInputsUnchanged ) {
+  TemporaryDirectory temporary_directory;
+  const fs::path &directory = temporary_directory.Path();
+  fs::path header = directory / "header.h";
+  fs::path source = directory / "source.cpp";
+  {
+    std::ofstream file( header );
+    file << "int x;\n";
+  }
+  std::string source_contents = "#include \"header.h\"\nint z = y;\n";
+  {
+    std::ofstream file( source );
+    file << source_contents;
+  }
+  UnsavedFile unsaved_file;
+  unsaved_file.filename_ = source.string();
+  unsaved_file.contents_ = source_contents;
+  unsaved_file.length_ = source_contents.size();
+  std::vector< UnsavedFile > unsaved_files{ unsaved_file };
+
+  TranslationUnit unit( source.string(),
+                        unsaved_files,
+                        std::vector< std::string >(),
+                        clang_index_ );
+  EXPECT_EQ( 1u, unit.Reparse( unsaved_files ).size() );
+
+  // Change the header but not its modification time: the reparse is skipped
+  // and the diagnostics are stale.
+  fs::file_time_type header_time = fs::last_write_time( header );
+  {
+    std::ofstream file( header );
+    file << "int y;\n";
+  }
+  fs::last_write_time( header, header_time );
+  EXPECT_EQ( 1u, unit.Reparse( unsaved_files ).size() );
+
+  fs::last_write_time( header, header_time + std::chrono::seconds( 1 ) );
+  EXPECT_EQ( 0u, unit.Reparse( unsaved_files ).size() );
+
+  // Changing the unsaved file also triggers a reparse.
+  unsaved_files[ 0 ].contents_ = "#include \"header.h\"\nint z = w;\n";
+  unsaved_files[ 0 ].length_ = unsaved_files[ 0 ].contents_.size();
+  EXPECT_EQ( 1u, unit.Reparse( unsaved_files ).size() );
+}
+
+
+TEST_F( TranslationUnitTest, StoreLoadsSavedTranslationUnits ) {
+  TemporaryDirectory temporary_directory;
+  const fs::path &directory = temporary_directory.Path();
+  fs::path cache_directory = directory / "cache";
+  std::string source = ( directory / "goto.cpp" ).string();
+  fs::copy_file( PathToTestFile( "goto.cpp" ), source );
+
+  auto cache_files = [ & ] {
+    std::vector< fs::path > files;
+    for ( const auto &entry : fs::directory_iterator( cache_directory ) ) {
+      files.push_back( entry.path() );
+    }
+    return files;
+  };
+
+  {
+    TranslationUnitStore translation_unit_store{ clang_index_ };
+    translation_unit_store.SetDoubleBuffered( true );
+    translation_unit_store.SetCacheDirectory( cache_directory.string(), 0 );
+    translation_unit_store.GetOrCreate( source,
+                                        std::vector< UnsavedFile >(),
+                                        std::vector< std::string >() );
+  }
+  ASSERT_EQ( 1u, cache_files().size() );
+  fs::path cache_file = cache_files()[ 0 ];
+  fs::file_time_type saved_time = fs::last_write_time( cache_file );
+
+  {
+    TranslationUnitStore translation_unit_store{ clang_index_ };
+    translation_unit_store.SetDoubleBuffered( true );
+    translation_unit_store.SetCacheDirectory( cache_directory.string(), 0 );
+    auto unit = translation_unit_store.GetOrCreate(
+                  source,
+                  std::vector< UnsavedFile >(),
+                  std::vector< std::string >() );
+    // Loaded, not parsed and saved again.
+    EXPECT_EQ( saved_time, fs::last_write_time( cache_file ) );
+
+    for ( int i = 0; i < 2; ++i ) {
+      Location location = unit->GetDefinitionLocation(
+                            source,
+                            17,
+                            3,
+                            std::vector< UnsavedFile >(),
+                            false );
+      EXPECT_EQ( 1u, location.line_number_ );
+      EXPECT_EQ( 8u, location.column_number_ );
+
+      // Parses the file from scratch.
+      unit->Reparse( std::vector< UnsavedFile >() );
+    }
+  }
+
+  // The saved TU is stale if the file is modified.
+  fs::last_write_time( source, saved_time + std::chrono::hours( 1 ) );
+  {
+    TranslationUnitStore translation_unit_store{ clang_index_ };
+    translation_unit_store.SetDoubleBuffered( true );
+    translation_unit_store.SetCacheDirectory( cache_directory.string(), 0 );
+    translation_unit_store.GetOrCreate( source,
+                                        std::vector< UnsavedFile >(),
+                                        std::vector< std::string >() );
+    translation_unit_store.WaitForCacheSaves();
+    EXPECT_LT( saved_time, fs::last_write_time( cache_file ) );
+
+    // Saved TUs over the size limit are deleted.
+    translation_unit_store.SetCacheDirectory( cache_directory.string(), 1 );
+    EXPECT_TRUE( translation_unit_store.Remove( source ) );
+    translation_unit_store.WaitForCacheSaves();
+    EXPECT_TRUE( cache_files().empty() );
+  }
+}
+
+
+TEST_F( TranslationUnitTest, StoreOnlySavesDoubleBufferedTranslationUnits ) {
+  TemporaryDirectory temporary_directory;
+  fs::path cache_directory = temporary_directory.Path() / "cache";
+  std::string source = PathToTestFile( "goto.cpp" ).string();
+
+  TranslationUnitStore translation_unit_store{ clang_index_ };
+  translation_unit_store.SetCacheDirectory( cache_directory.string(), 0 );
+  translation_unit_store.GetOrCreate( source,
+                                      std::vector< UnsavedFile >(),
+                                      std::vector< std::string >() );
+  EXPECT_TRUE( translation_unit_store.Remove( source ) );
+  translation_unit_store.WaitForCacheSaves();
+  EXPECT_FALSE( fs::exists( cache_directory ) );
+}
+
+
+TEST_F( TranslationUnitTest, OnlyFirstDiagnosticsFullyBuilt ) {
+  std::string filename = PathToTestFile( "unsaved_file.cpp" ).string();
+  UnsavedFile unsaved_file;
+  unsaved_file.filename_ = filename;
+  unsaved_file.contents_ = "struct A { int x; };\n"
+                           "A a;\n"
+                           "int y = a->x;\n"
+                           "int z = a->x;\n";
+  unsaved_file.length_ = unsaved_file.contents_.size();
+  std::vector< UnsavedFile > unsaved_files{ unsaved_file };
+
+  TranslationUnit unit( filename,
+                        unsaved_files,
+                        std::vector< std::string >(),
+                        clang_index_,
+                        false,
+                        1 );
+  std::vector< Diagnostic > diagnostics = unit.Reparse( unsaved_files );
+  ASSERT_EQ( 2u, diagnostics.size() );
+
+  EXPECT_EQ( 1u, diagnostics[ 0 ].fixits_.size() );
+  EXPECT_FALSE( diagnostics[ 0 ].long_formatted_text_.empty() );
+  // The extent of the "->" token.
+  EXPECT_EQ( diagnostics[ 0 ].location_,
+             diagnostics[ 0 ].location_extent_.start_ );
+  EXPECT_EQ( diagnostics[ 0 ].location_.column_number_ + 2,
+             diagnostics[ 0 ].location_extent_.end_.column_number_ );
+
+  EXPECT_TRUE( diagnostics[ 1 ].fixits_.empty() );
+  EXPECT_TRUE( diagnostics[ 1 ].long_formatted_text_.empty() );
+  EXPECT_FALSE( diagnostics[ 1 ].text_.empty() );
+  EXPECT_EQ( diagnostics[ 1 ].location_,
+             diagnostics[ 1 ].location_extent_.end_ );
+
+  // The fixits are still available.
+  EXPECT_EQ( 1u, unit.GetFixItsForLocationInFile( filename,
+                                                  4,
+                                                  10,
+                                                  unsaved_files,
+                                                  false ).size() );
+}
+
+
+TEST_F( TranslationUnitTest, IgnoredDiagnosticsNotCountedAsDisplayed ) {
+  std::string filename = PathToTestFile( "unsaved_file.cpp" ).string();
+  UnsavedFile unsaved_file;
+  unsaved_file.filename_ = filename;
+  unsaved_file.contents_ = "#pragma once\n"
+                           "struct A { int x; };\n"
+                           "A a;\n"
+                           "int y = a->x;\n";
+  unsaved_file.length_ = unsaved_file.contents_.size();
+  std::vector< UnsavedFile > unsaved_files{ unsaved_file };
+
+  TranslationUnit unit( filename,
+                        unsaved_files,
+                        std::vector< std::string >(),
+                        clang_index_,
+                        false,
+                        1 );
+  std::vector< Diagnostic > diagnostics = unit.Reparse( unsaved_files );
+  ASSERT_EQ( 2u, diagnostics.size() );
+
+  EXPECT_EQ( "#pragma once in main file", diagnostics[ 0 ].text_ );
+  EXPECT_EQ( 1u, diagnostics[ 1 ].fixits_.size() );
+  EXPECT_FALSE( diagnostics[ 1 ].long_formatted_text_.empty() );
+}
+
+
+TEST_F( TranslationUnitTest, ReparseReturnsDiagnosticsDelta ) {
+  std::string filename = PathToTestFile( "unsaved_file.cpp" ).string();
+  UnsavedFile unsaved_file;
+  unsaved_file.filename_ = filename;
+  unsaved_file.contents_ = "int a = x;\nint b = y;\n";
+  unsaved_file.length_ = unsaved_file.contents_.size();
+  std::vector< UnsavedFile > unsaved_files{ unsaved_file };
+
+  TranslationUnit unit( filename,
+                        unsaved_files,
+                        std::vector< std::string >(),
+                        clang_index_ );
+
+  // Zero is never a generation: all the diagnostics are returned.
+  DiagnosticsDelta delta = unit.Reparse( unsaved_files, 0 );
+  EXPECT_TRUE( delta.full_ );
+  EXPECT_FALSE( delta.unchanged_ );
+  EXPECT_NE( 0u, delta.generation_ );
+  ASSERT_EQ( 2u, delta.added_.size() );
+  size_t x_id = delta.added_[ 0 ].id_;
+  size_t y_id = delta.added_[ 1 ].id_;
+  EXPECT_NE( x_id, y_id );
+  EXPECT_THAT( delta.ids_, ElementsAre( x_id, y_id ) );
+  EXPECT_TRUE( delta.removed_.empty() );
+
+  size_t generation = delta.generation_;
+  delta = unit.Reparse( unsaved_files, generation );
+  EXPECT_TRUE( delta.unchanged_ );
+  EXPECT_EQ( generation, delta.generation_ );
+  EXPECT_TRUE( delta.added_.empty() );
+
+  unsaved_files[ 0 ].contents_ = "int a = x;\nint b = z;\n";
+  unsaved_files[ 0 ].length_ = unsaved_files[ 0 ].contents_.size();
+  delta = unit.Reparse( unsaved_files, generation );
+  EXPECT_FALSE( delta.unchanged_ );
+  EXPECT_FALSE( delta.full_ );
+  EXPECT_NE( generation, delta.generation_ );
+  ASSERT_EQ( 1u, delta.added_.size() );
+  EXPECT_EQ( 2u, delta.added_[ 0 ].location_.line_number_ );
+  EXPECT_THAT( delta.removed_, ElementsAre( y_id ) );
+  EXPECT_THAT( delta.ids_, ElementsAre( x_id, delta.added_[ 0 ].id_ ) );
+
+  // Going back to the first contents gives a new generation with the same
+  // diagnostics as the first one.
+  size_t z_generation = delta.generation_;
+  unsaved_files[ 0 ] = unsaved_file;
+  delta = unit.Reparse( unsaved_files, generation );
+  EXPECT_TRUE( delta.unchanged_ );
+  EXPECT_NE( z_generation, delta.generation_ );
+}
+
+
+TEST_F( TranslationUnitTest, DiagnosticIdCoversNotes ) {
+  std::string filename = PathToTestFile( "unsaved_file.cpp" ).string();
+  UnsavedFile unsaved_file;
+  unsaved_file.filename_ = filename;
+  unsaved_file.contents_ = "void f( int );\nvoid g() { f(); }\n";
+  unsaved_file.length_ = unsaved_file.contents_.size();
+  std::vector< UnsavedFile > unsaved_files{ unsaved_file };
+
+  TranslationUnit unit( filename,
+                        unsaved_files,
+                        std::vector< std::string >(),
+                        clang_index_ );
+
+  DiagnosticsDelta delta = unit.Reparse( unsaved_files, 0 );
+  ASSERT_EQ( 1u, delta.added_.size() );
+  Diagnostic call = delta.added_[ 0 ];
+
+  // Same error at the same location, with one more candidate in its notes.
+  unsaved_files[ 0 ].contents_ =
+    "void f( int ); void f( int, int );\nvoid g() { f(); }\n";
+  unsaved_files[ 0 ].length_ = unsaved_files[ 0 ].contents_.size();
+  delta = unit.Reparse( unsaved_files, delta.generation_ );
+  EXPECT_FALSE( delta.unchanged_ );
+  ASSERT_EQ( 1u, delta.added_.size() );
+  EXPECT_EQ( call.text_, delta.added_[ 0 ].text_ );
+  EXPECT_NE( call.long_formatted_text_,
+             delta.added_[ 0 ].long_formatted_text_ );
+  EXPECT_THAT( delta.removed_, ElementsAre( call.id_ ) );
+}
+
+
 TEST_F( TranslationUnitTest, InvalidTranslationUnit ) {
 
   TranslationUnit unit;
@@ -0,0 +1,79 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CompletionJson.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+namespace YouCompleteMe {
+
+std::string ToJsonString( std::string_view text ) {
+  std::string json;
+  AppendJsonString( text, json );
+  return json;
+}
+
+
+TEST( CompletionJsonTest, AppendJsonString ) {
+  EXPECT_EQ( "\"\"", ToJsonString( "" ) );
+  EXPECT_EQ( "\"foo\"", ToJsonString( "foo" ) );
+  EXPECT_EQ( "\"\\\"foo\\\\\"", ToJsonString( "\"foo\\" ) );
+  EXPECT_EQ( "\"\\b\\f\\n\\r\\t\\u0001\\u001f\"",
+             ToJsonString( "\b\f\n\r\t\x01\x1f" ) );
+  EXPECT_EQ( "\"fòô𐍈\"", ToJsonString( "fòô𐍈" ) );
+}
+
+
+TEST( CompletionJsonTest, AppendJsonStringInvalidUtf8 ) {
+  // Lone continuation byte, truncated sequence, overlong encoding, and encoded
+  // surrogate.
+  EXPECT_EQ( "\"a\\ufffdb\"", ToJsonString( "a\x80" "b" ) );
+  EXPECT_EQ( "\"a\\ufffd\\ufffd\"", ToJsonString( "a\xe2\x82" ) );
+  EXPECT_EQ( "\"\\ufffd\\ufffd\"", ToJsonString( "\xc0\xaf" ) );
+  EXPECT_EQ( "\"\\ufffd\\ufffd\\ufffd\"", ToJsonString( "\xed\xa0\x80" ) );
+}
+
+
+TEST( CompletionJsonTest, EmptyBuilder ) {
+  CompletionJsonBuilder builder;
+  EXPECT_EQ( 0, builder.Size() );
+  EXPECT_EQ( "[]", builder.Build() );
+}
+
+
+TEST( CompletionJsonTest, EmptyFieldsAreOmitted ) {
+  CompletionJsonBuilder builder;
+  builder.Add( "foo" );
+  builder.Add( "bar", "[ID]" );
+  builder.Add( "baz", "", "baz()", "void baz()", "FUNCTION",
+               "{\"doc_string\":\"Baz.\"}" );
+
+  EXPECT_EQ( 3, builder.Size() );
+  EXPECT_EQ( "["
+               "{\"insertion_text\":\"foo\"},"
+               "{\"insertion_text\":\"bar\",\"extra_menu_info\":\"[ID]\"},"
+               "{\"insertion_text\":\"baz\","
+                "\"menu_text\":\"baz()\","
+                "\"detailed_info\":\"void baz()\","
+                "\"kind\":\"FUNCTION\","
+                "\"extra_data\":{\"doc_string\":\"Baz.\"}}"
+             "]",
+             builder.Build() );
+}
+
+} // namespace YouCompleteMe
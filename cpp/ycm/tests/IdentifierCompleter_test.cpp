@@ -18,9 +18,14 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include "IdentifierCompleter.h"
+#include "LatencyHistogram.h"
 #include "Utils.h"
 #include "TestUtils.h"
 
+#include <chrono>
+#include <thread>
+
+using ::testing::Contains;
 using ::testing::ElementsAre;
 using ::testing::IsEmpty;
 using ::testing::WhenSorted;
@@ -290,6 +295,122 @@ TEST( IdentifierCompleterTest, LotOfCandidates ) {
 }
 
 
+TEST( IdentifierCompleterTest, CandidateIndexGivesSameResults ) {
+  std::vector< std::string > candidates = {
+    "foobar",
+    "FooBar",
+    "fooBarBaz",
+    "barfoo",
+    "fbr",
+    "fóóbár",
+    "FÓÓBÁR",
+    "foo_bar",
+    "xyz"
+  };
+  IdentifierCompleter completer( candidates );
+  IdentifierCompleter indexed_completer( candidates );
+  indexed_completer.SetCandidateIndexEnabled( true );
+
+  for ( const char *query : { "", "f", "fb", "fbr", "FBR", "foobar", "fóób",
+                              "FoB", "oar", "xyz", "zyx", "qqq" } ) {
+    EXPECT_EQ( completer.CandidatesForQuery( query ),
+               indexed_completer.CandidatesForQuery( query ) ) << query;
+  }
+
+  std::string filetype = "c";
+  std::string filepath = "foo";
+  indexed_completer.AddIdentifiersToDatabase( { "fooqux", "quxbar" },
+                                              filetype,
+                                              filepath );
+  filetype = "c";
+  filepath = "foo";
+  EXPECT_THAT( indexed_completer.CandidatesForQueryAndType( "qux", "c" ),
+               ElementsAre( "quxbar",
+                            "fooqux" ) );
+
+  indexed_completer.ClearForFileAndAddIdentifiersToDatabase( { "quxfoo" },
+                                                             filetype,
+                                                             filepath );
+  EXPECT_THAT( indexed_completer.CandidatesForQueryAndType( "qux", "c" ),
+               ElementsAre( "quxfoo" ) );
+
+  indexed_completer.SetCandidateIndexEnabled( false );
+  EXPECT_THAT( indexed_completer.CandidatesForQueryAndType( "qux", "c" ),
+               ElementsAre( "quxfoo" ) );
+}
+
+
+TEST( IdentifierCompleterTest, CompletionsJson ) {
+  IdentifierCompleter completer( { "foo", "foobar", "fòôbàr", "f\"oo\"" } );
+
+  EXPECT_EQ( "[{\"insertion_text\":\"fòôbàr\","
+               "\"extra_menu_info\":\"[ID]\"}]",
+             completer.CompletionsJsonForQueryAndType(
+               "fòô", "", 0, 0, "[ID]" ) );
+  EXPECT_EQ( "[{\"insertion_text\":\"f\\\"oo\\\"\"}]",
+             completer.CompletionsJsonForQueryAndType( "f\"", "", 0, 0, "" ) );
+  EXPECT_EQ( "[]",
+             completer.CompletionsJsonForQueryAndType( "x", "", 0, 0, "" ) );
+
+  // Small candidates are dropped before keeping the best results.
+  IdentifierCompleter small_completer( { "foo", "foobar", "fòô" } );
+  EXPECT_EQ( "[{\"insertion_text\":\"foobar\"}]",
+             small_completer.CompletionsJsonForQueryAndType(
+               "fo", "", 0, 4, "" ) );
+  EXPECT_EQ( "[{\"insertion_text\":\"foobar\"}]",
+             small_completer.CompletionsJsonForQueryAndType(
+               "fo", "", 1, 4, "" ) );
+}
+
+
+TEST( IdentifierCompleterTest, CompletionsJsonRecordsLatency ) {
+  LatencyHistogram &latency = LatencyRegistry::Instance().Histogram(
+    "IdentifierCompleter::CompletionsJsonForQueryAndType" );
+  uint64_t count = latency.Snapshot().count;
+
+  IdentifierCompleter completer( { "foo", "foobar" } );
+  completer.CompletionsJsonForQueryAndType( "fo", "", 0, 0, "" );
+  completer.CompletionsJsonForQueryAndType( "x", "", 0, 0, "" );
+
+  EXPECT_EQ( count + 2, latency.Snapshot().count );
+}
+
+
+TEST( IdentifierCompleterTest, MatchPositions ) {
+  IdentifierCompleter completer( { "mpfoo", "mpfòòbar" } );
+
+  auto candidates = completer.CandidatesWithMatchPositionsForQueryAndType(
+    "mpob", "" );
+  ASSERT_EQ( 1, candidates.size() );
+  EXPECT_EQ( "mpfòòbar", candidates[ 0 ].first );
+  EXPECT_THAT( candidates[ 0 ].second.byte_offsets, ElementsAre( 0, 1, 3, 7 ) );
+  EXPECT_THAT( candidates[ 0 ].second.code_point_offsets,
+               ElementsAre( 0, 1, 3, 5 ) );
+}
+
+
+TEST( IdentifierCompleterTest, QueryOptions ) {
+  IdentifierCompleter completer( { "qo", "qoo", "qoox", "qòòxy" } );
+
+  QueryOptions options;
+  EXPECT_THAT( completer.CandidatesForQueryAndType( "qo", "", 0, options ),
+               ElementsAre( "qo", "qoo", "qoox", "qòòxy" ) );
+
+  options.min_candidate_chars = 3;
+  EXPECT_THAT( completer.CandidatesForQueryAndType( "qo", "", 2, options ),
+               ElementsAre( "qoo", "qoox" ) );
+
+  options.max_candidate_chars = 4;
+  EXPECT_THAT( completer.CandidatesForQueryAndType( "qo", "", 0, options ),
+               ElementsAre( "qoo", "qoox" ) );
+
+  options = QueryOptions();
+  options.exclude_query = true;
+  EXPECT_THAT( completer.CandidatesForQueryAndType( "qoo", "", 0, options ),
+               ElementsAre( "qoox", "qòòxy" ) );
+}
+
+
 TEST( IdentifierCompleterTest, TagsEndToEndWorks ) {
   IdentifierCompleter completer;
   std::vector< std::string > tag_files;
@@ -304,6 +425,38 @@ TEST( IdentifierCompleterTest, TagsEndToEndWorks ) {
 }
 
 
+TEST( IdentifierCompleterTest, SnapshotEndToEndWorks ) {
+  TemporaryDirectory directory;
+  std::string snapshot = ( directory.Path() / "completer.snapshot" ).string();
+  {
+    IdentifierCompleter completer;
+    std::vector< std::string > tag_files;
+    tag_files.push_back( PathToTestFile( "basic.tags" ).string() );
+    completer.AddIdentifiersToDatabaseFromTagFiles( tag_files );
+
+    EXPECT_TRUE( completer.SaveSnapshot( snapshot ) );
+  }
+
+  IdentifierCompleter completer;
+  EXPECT_TRUE( completer.LoadSnapshot( snapshot ) );
+
+  EXPECT_THAT( completer.CandidatesForQueryAndType( "fo", "cpp" ),
+               ElementsAre( "foosy",
+                            "fooaaa" ) );
+  EXPECT_THAT( completer.CandidatesForQueryAndType( "zo", "fakelang" ),
+               ElementsAre( "zoro" ) );
+
+  fs::remove( snapshot );
+}
+
+
+TEST( IdentifierCompleterTest, LoadMissingSnapshot ) {
+  IdentifierCompleter completer;
+  EXPECT_FALSE( completer.LoadSnapshot(
+    PathToTestFile( "invalid_path_to_snapshot" ).string() ) );
+}
+
+
 // Filetype checking
 TEST( IdentifierCompleterTest, ManyCandidateSimpleFileType ) {
   IdentifierCompleter completer;
@@ -328,5 +481,221 @@ TEST( IdentifierCompleterTest, ManyCandidateSimpleWrongFileType ) {
                IsEmpty() );
 }
 
+
+TEST( IdentifierCompleterTest, DeadlineGivesSameResultsWhenNotReached ) {
+  std::vector< std::string > candidates = {
+    "dlfoo",
+    "DlFoo",
+    "xdlfoo",
+    "dlbar"
+  };
+
+  for ( bool use_index : { false, true } ) {
+    IdentifierCompleter completer( std::vector< std::string >( candidates ),
+                                   "c",
+                                   "dlfile" );
+    completer.SetCandidateIndexEnabled( use_index );
+
+    for ( const char *query : { "", "d", "dlf", "DLF", "foo", "xyz" } ) {
+      auto [ results, is_complete ] =
+        completer.CandidatesForQueryAndTypeWithDeadline( query,
+                                                         "c",
+                                                         "dlfile",
+                                                         0,
+                                                         60000 );
+      EXPECT_TRUE( is_complete ) << query;
+      EXPECT_EQ( completer.CandidatesForQueryAndType( query, "c" ), results )
+        << query;
+    }
+  }
+}
+
+
+TEST( IdentifierCompleterTest, DeadlineScansSameFileFirst ) {
+  std::vector< std::string > other_candidates;
+  for ( int i = 0; i < 1000; ++i ) {
+    other_candidates.push_back( "dlq" + std::to_string( i ) );
+  }
+  IdentifierCompleter completer( std::move( other_candidates ),
+                                 "c",
+                                 "dlother" );
+  std::string filetype = "c";
+  std::string filepath = "dlcurrent";
+  completer.AddIdentifiersToDatabase( { "dlqcurrent" }, filetype, filepath );
+
+  auto [ results, is_complete ] =
+    completer.CandidatesForQueryAndTypeWithDeadline( "dlq",
+                                                     "c",
+                                                     "dlcurrent",
+                                                     0,
+                                                     0 );
+  EXPECT_FALSE( is_complete );
+  EXPECT_LT( results.size(), 1001 );
+  EXPECT_THAT( results, Contains( "dlqcurrent" ) );
+}
+
+
+TEST( IdentifierCompleterTest, DeadlineCheckedForDeferredCandidates ) {
+  // The deadline is checked every 256 visited candidates. The 210 candidates
+  // are visited once before the 200 deferred ones are scanned, so the deadline
+  // is first checked while scanning the deferred candidates.
+  std::vector< std::string > candidates;
+  for ( int i = 0; i < 10; ++i ) {
+    candidates.push_back( "dq" + std::to_string( i ) );
+  }
+  for ( int i = 0; i < 200; ++i ) {
+    candidates.push_back( "xdq" + std::to_string( i ) );
+  }
+  IdentifierCompleter completer( std::move( candidates ), "c", "dqother" );
+
+  auto [ results, is_complete ] =
+    completer.CandidatesForQueryAndTypeWithDeadline( "dq",
+                                                     "c",
+                                                     "dqcurrent",
+                                                     0,
+                                                     0 );
+  EXPECT_FALSE( is_complete );
+  EXPECT_LT( results.size(), 210 );
+  for ( int i = 0; i < 10; ++i ) {
+    EXPECT_THAT( results, Contains( "dq" + std::to_string( i ) ) );
+  }
+}
+
+
+TEST( IdentifierCompleterTest, PathScopedQueries ) {
+  IdentifierCompleter completer;
+  std::string filetype = "c";
+  std::string filepath = "/src/a/scfoo.c";
+  completer.AddIdentifiersToDatabase( { "scfoo", "scfoobar" },
+                                      filetype,
+                                      filepath );
+  filetype = "c";
+  filepath = "/src/a/scbar.c";
+  completer.AddIdentifiersToDatabase( { "scbarfoo" }, filetype, filepath );
+  filetype = "c";
+  filepath = "/src/b/scqux.c";
+  completer.AddIdentifiersToDatabase( { "scfooqux" }, filetype, filepath );
+
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "scf", "c", { "/src/a/scfoo.c" }, "" ),
+               ElementsAre( "scfoo", "scfoobar" ) );
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "scf", "c", {}, "/src/a/" ),
+               WhenSorted( ElementsAre( "scbarfoo", "scfoo", "scfoobar" ) ) );
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "scf", "c", { "/src/b/scqux.c" }, "/src/a/" ),
+               WhenSorted( ElementsAre( "scbarfoo",
+                                        "scfoo",
+                                        "scfoobar",
+                                        "scfooqux" ) ) );
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "scf", "c", { "/src/missing.c" }, "/src/c/" ),
+               IsEmpty() );
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "scf", "cpp", { "/src/a/scfoo.c" }, "" ),
+               IsEmpty() );
+
+  // The prefix is a directory, with or without a trailing separator.
+  filetype = "c";
+  filepath = "/src/ab/scfoobaz.c";
+  completer.AddIdentifiersToDatabase( { "scfoobaz" }, filetype, filepath );
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "scf", "c", {}, "/src/a" ),
+               WhenSorted( ElementsAre( "scbarfoo", "scfoo", "scfoobar" ) ) );
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "scf", "c", {}, "/src/a/scfoo.c" ),
+               WhenSorted( ElementsAre( "scfoo", "scfoobar" ) ) );
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "scf", "c", {}, "/src/ab/" ),
+               ElementsAre( "scfoobaz" ) );
+}
+
+
+TEST( IdentifierCompleterTest, PathScopedQueriesWithOptions ) {
+  IdentifierCompleter completer;
+  std::string filetype = "c";
+  std::string filepath = "/op/a.c";
+  completer.AddIdentifiersToDatabase( { "opf", "opfoo", "opfoobar" },
+                                      filetype,
+                                      filepath );
+
+  QueryOptions options;
+  options.max_candidate_chars = 5;
+  options.exclude_query = true;
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "opf", "c", { "/op/a.c" }, "", 0, 0, options ),
+               ElementsAre( "opfoo" ) );
+  // The fallback to all the files uses the options too.
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "opf", "c", {}, "", 0, 1, options ),
+               ElementsAre( "opfoo" ) );
+}
+
+
+TEST( IdentifierCompleterTest, PathScopedQueriesFallBackToAllFiles ) {
+  IdentifierCompleter completer;
+  std::string filetype = "c";
+  std::string filepath = "/fb/a.c";
+  completer.AddIdentifiersToDatabase( { "fbfoo" }, filetype, filepath );
+  filetype = "c";
+  filepath = "/fb/b.c";
+  completer.AddIdentifiersToDatabase( { "fbfoobar" }, filetype, filepath );
+
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "fbf", "c", { "/fb/a.c" }, "", 0, 1 ),
+               ElementsAre( "fbfoo" ) );
+  EXPECT_THAT( completer.CandidatesForQueryAndTypeInPaths(
+                 "fbf", "c", { "/fb/a.c" }, "", 0, 2 ),
+               ElementsAre( "fbfoo", "fbfoobar" ) );
+  EXPECT_EQ( completer.CandidatesForQueryAndType( "fbf", "c" ),
+             completer.CandidatesForQueryAndTypeInPaths(
+               "fbf", "c", {}, "", 0, 1 ) );
+}
+
+TEST( IdentifierCompleterTest, SpeculativeQueriesGiveSameResults ) {
+  std::vector< std::string > candidates = {
+    "spqfoo",
+    "SpqFoo",
+    "spq_foo_bar",
+    "xspqfoo",
+    "spqfóo",
+    "spqbar"
+  };
+  std::string filetype = "c";
+  std::string filepath = "spqfile";
+
+  for ( bool use_index : { false, true } ) {
+    IdentifierCompleter completer( std::vector< std::string >( candidates ),
+                                   "c",
+                                   "spqfile" );
+    IdentifierCompleter speculative_completer(
+      std::vector< std::string >( candidates ), "c", "spqfile" );
+    completer.SetCandidateIndexEnabled( use_index );
+    speculative_completer.SetCandidateIndexEnabled( use_index );
+    speculative_completer.SetSpeculativeQueriesEnabled( true );
+
+    for ( const char *query : { "s", "sp", "spq", "spqf", "spqfo", "spqfoo",
+                                "spqfoob", "S", "Sp", "SpQ", "SpQF", "spqfó",
+                                "spqfóo", "x", "xs", "xsp" } ) {
+      EXPECT_EQ( completer.CandidatesForQueryAndType( query, filetype ),
+                 speculative_completer.CandidatesForQueryAndType( query,
+                                                                  filetype ) )
+        << query;
+      // Give the background thread time to precompute the next query.
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+
+    // Changing identifiers invalidates the speculation.
+    speculative_completer.CandidatesForQueryAndType( "spq", filetype );
+    std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    for ( IdentifierCompleter *c : { &completer, &speculative_completer } ) {
+      c->AddIdentifiersToDatabase( { "spqzed" }, filetype, filepath );
+    }
+    EXPECT_EQ( completer.CandidatesForQueryAndType( "spqz", filetype ),
+               speculative_completer.CandidatesForQueryAndType( "spqz",
+                                                                filetype ) );
+  }
+}
+
 } // namespace YouCompleteMe
 
@@ -22,6 +22,7 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <filesystem>
+#include <fstream>
 
 namespace YouCompleteMe {
 
@@ -91,5 +92,78 @@ TEST( IdentifierUtilsTest, TagFileInvalidPath ) {
   EXPECT_THAT( ExtractIdentifiersFromTagsFile( testfile ), IsEmpty() );
 }
 
+
+TEST( IdentifierUtilsTest, SnapshotRoundTrip ) {
+  TemporaryDirectory directory;
+  fs::path snapshot = directory.Path() / "identifiers.snapshot";
+  FiletypeIdentifierMap identifiers = {
+    { "cpp", { { "/foo/bar.cpp", { "foo", "bar", "fooδιακριτικός" } },
+               { "/foo/qux.h", { "qux" } } } },
+    { "python", { { "/foo/zoo.py", { std::string( 200, 'a' ) } } } }
+  };
+
+  EXPECT_TRUE( WriteIdentifiersToSnapshotFile( identifiers, snapshot ) );
+  EXPECT_THAT( ReadIdentifiersFromSnapshotFile( snapshot ),
+               ContainerEq( identifiers ) );
+
+  // The temporary file is renamed to the snapshot.
+  std::vector< fs::path > files;
+  for ( const auto &entry : fs::directory_iterator( directory.Path() ) ) {
+    files.push_back( entry.path() );
+  }
+  EXPECT_THAT( files, ElementsAre( snapshot ) );
+}
+
+
+TEST( IdentifierUtilsTest, SnapshotFileInvalidPath ) {
+  fs::path snapshot = PathToTestFile( "invalid_path_to_snapshot" );
+
+  EXPECT_THAT( ReadIdentifiersFromSnapshotFile( snapshot ), IsEmpty() );
+}
+
+
+TEST( IdentifierUtilsTest, SnapshotFileIsNotASnapshot ) {
+  fs::path snapshot = PathToTestFile( "basic.tags" );
+
+  EXPECT_THAT( ReadIdentifiersFromSnapshotFile( snapshot ), IsEmpty() );
+}
+
+
+TEST( IdentifierUtilsTest, SnapshotFileIsTruncated ) {
+  TemporaryDirectory directory;
+  fs::path snapshot = directory.Path() / "truncated.snapshot";
+  FiletypeIdentifierMap identifiers = {
+    { "cpp", { { "/foo/bar.cpp", { "foo", "bar" } } } }
+  };
+  ASSERT_TRUE( WriteIdentifiersToSnapshotFile( identifiers, snapshot ) );
+  fs::resize_file( snapshot, fs::file_size( snapshot ) - 2 );
+
+  EXPECT_THAT( ReadIdentifiersFromSnapshotFile( snapshot ), IsEmpty() );
+}
+
+
+TEST( IdentifierUtilsTest, BigTagFileKeepsIdentifierOrder ) {
+  // Big enough to be parsed in several tasks.
+  TemporaryDirectory directory;
+  fs::path tag_file = directory.Path() / "big.tags";
+  FiletypeIdentifierMap expected;
+  {
+    std::ofstream file( tag_file );
+    for ( int i = 0; i < 10000; ++i ) {
+      std::string identifier = "tag" + std::to_string( i );
+      std::string filename = i % 2 ? "odd.cc" : "even.py";
+      std::string language = i % 2 ? "C++" : "Python";
+      file << identifier << "\t" << filename
+           << "\t/^foo$/;\"\tlanguage:" << language << "\n";
+      expected[ i % 2 ? "cpp" : "python" ]
+              [ ( tag_file.parent_path() / filename ).string() ]
+        .push_back( identifier );
+    }
+  }
+
+  EXPECT_THAT( ExtractIdentifiersFromTagsFile( tag_file ),
+               ContainerEq( expected ) );
+}
+
 } // namespace YouCompleteMe
 
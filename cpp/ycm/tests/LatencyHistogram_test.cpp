@@ -0,0 +1,115 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "IdentifierCompleter.h"
+#include "LatencyHistogram.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using ::testing::AllOf;
+using ::testing::Ge;
+using ::testing::Le;
+
+namespace YouCompleteMe {
+
+TEST( LatencyHistogramTest, EmptySnapshot ) {
+  LatencyHistogram histogram;
+  LatencySnapshot snapshot = histogram.Snapshot();
+
+  EXPECT_EQ( 0u, snapshot.count );
+  EXPECT_EQ( 0u, snapshot.max_ns );
+  EXPECT_EQ( 0u, snapshot.p50_ns );
+}
+
+
+TEST( LatencyHistogramTest, SmallValuesAreExact ) {
+  LatencyHistogram histogram;
+  for ( uint64_t value = 1; value <= 10; ++value ) {
+    histogram.Record( value );
+  }
+
+  LatencySnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ( 10u, snapshot.count );
+  EXPECT_EQ( 5u, snapshot.mean_ns );
+  EXPECT_EQ( 10u, snapshot.max_ns );
+  EXPECT_EQ( 5u, snapshot.p50_ns );
+  EXPECT_EQ( 9u, snapshot.p90_ns );
+  EXPECT_EQ( 10u, snapshot.p99_ns );
+}
+
+
+TEST( LatencyHistogramTest, PercentilesAreAccurate ) {
+  LatencyHistogram histogram;
+  // One to ten thousand microseconds.
+  for ( uint64_t value = 1; value <= 10000; ++value ) {
+    histogram.Record( value * 1000 );
+  }
+
+  LatencySnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ( 10000u, snapshot.count );
+  EXPECT_EQ( 10000000u, snapshot.max_ns );
+  EXPECT_THAT( snapshot.p50_ns, AllOf( Ge( 5000000u ), Le( 5330000u ) ) );
+  EXPECT_THAT( snapshot.p90_ns, AllOf( Ge( 9000000u ), Le( 9570000u ) ) );
+  EXPECT_THAT( snapshot.p99_ns, AllOf( Ge( 9900000u ), Le( 10000000u ) ) );
+  EXPECT_THAT( snapshot.p999_ns, AllOf( Ge( 9990000u ), Le( 10000000u ) ) );
+}
+
+
+TEST( LatencyHistogramTest, HugeValues ) {
+  LatencyHistogram histogram;
+  histogram.Record( UINT64_MAX );
+
+  LatencySnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ( 1u, snapshot.count );
+  EXPECT_EQ( UINT64_MAX, snapshot.max_ns );
+  EXPECT_EQ( UINT64_MAX, snapshot.p50_ns );
+}
+
+
+TEST( LatencyHistogramTest, Reset ) {
+  LatencyHistogram histogram;
+  histogram.Record( 100 );
+  histogram.Reset();
+
+  LatencySnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ( 0u, snapshot.count );
+  EXPECT_EQ( 0u, snapshot.max_ns );
+}
+
+
+TEST( LatencyRegistryTest, EntryPointsAreRecorded ) {
+  LatencyRegistry &registry = LatencyRegistry::Instance();
+  registry.Reset();
+  EXPECT_EQ( &registry.Histogram( "LatencyRegistryTest" ),
+             &registry.Histogram( "LatencyRegistryTest" ) );
+
+  IdentifierCompleter completer( { "lrfoo" }, "c", "lrfile" );
+  completer.CandidatesForQueryAndType( "lrf", "c" );
+  completer.CandidatesForQueryAndType( "lrb", "c" );
+
+  bool found = false;
+  for ( const LatencySnapshot &snapshot : registry.Snapshot() ) {
+    if ( snapshot.name == "IdentifierCompleter::CandidatesForQueryAndType" ) {
+      found = true;
+      EXPECT_EQ( 2u, snapshot.count );
+    }
+  }
+  EXPECT_TRUE( found );
+}
+
+} // namespace YouCompleteMe
@@ -0,0 +1,107 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "IdentifierCompleter.h"
+#include "QueryStatistics.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace YouCompleteMe {
+
+class QueryStatisticsTest : public ::testing::Test {
+protected:
+  QueryStatisticsTest()
+    : registry_( QueryStatisticsRegistry::Instance() ) {
+  }
+
+  virtual void SetUp() {
+    registry_.Clear();
+  }
+
+  QueryStatisticsRegistry &registry_;
+};
+
+
+QueryStatistics StatisticsForQuery( const std::string &query,
+                                    uint64_t num_matches ) {
+  QueryStatistics statistics;
+  statistics.source = "identifier";
+  statistics.query = query;
+  statistics.num_queries = 1;
+  statistics.num_visited_candidates = 10;
+  statistics.num_matches = num_matches;
+  statistics.sort_ns = 100;
+  return statistics;
+}
+
+
+TEST_F( QueryStatisticsTest, TotalsAggregateAllQueries ) {
+  registry_.Record( StatisticsForQuery( "a", 1 ) );
+  registry_.Record( StatisticsForQuery( "b", 2 ) );
+
+  QueryStatistics totals = registry_.Totals();
+  EXPECT_EQ( "total", totals.source );
+  EXPECT_EQ( 2u, totals.num_queries );
+  EXPECT_EQ( 20u, totals.num_visited_candidates );
+  EXPECT_EQ( 3u, totals.num_matches );
+  EXPECT_EQ( 200u, totals.sort_ns );
+
+  registry_.Clear();
+  EXPECT_EQ( 0u, registry_.Totals().num_queries );
+  EXPECT_THAT( registry_.RecentQueries(), IsEmpty() );
+}
+
+
+TEST_F( QueryStatisticsTest, OnlyLastQueriesAreKept ) {
+  for ( int i = 0; i < 100; ++i ) {
+    registry_.Record( StatisticsForQuery( std::to_string( i ), 0 ) );
+  }
+
+  std::vector< QueryStatistics > recent_queries = registry_.RecentQueries();
+  ASSERT_EQ( 64u, recent_queries.size() );
+  EXPECT_EQ( "36", recent_queries.front().query );
+  EXPECT_EQ( "99", recent_queries.back().query );
+  EXPECT_EQ( 100u, registry_.Totals().num_queries );
+}
+
+
+TEST_F( QueryStatisticsTest, IdentifierQueriesAreRecorded ) {
+  IdentifierCompleter completer( { "qsfoo", "qsofbar", "qsbar", "qsfóo" },
+                                 "c",
+                                 "qsfile" );
+
+  EXPECT_THAT( completer.CandidatesForQueryAndType( "qsfo", "c" ),
+               ElementsAre( "qsfoo", "qsfóo" ) );
+
+  std::vector< QueryStatistics > recent_queries = registry_.RecentQueries();
+  ASSERT_EQ( 1u, recent_queries.size() );
+  const QueryStatistics &statistics = recent_queries.back();
+  EXPECT_EQ( "identifier", statistics.source );
+  EXPECT_EQ( "qsfo", statistics.query );
+  EXPECT_EQ( 1u, statistics.num_queries );
+  EXPECT_EQ( 4u, statistics.num_visited_candidates );
+  // "qsbar" doesn't contain an "f", "qsofbar" has no "o" after the "f".
+  EXPECT_EQ( 1u, statistics.num_prefilter_rejections );
+  EXPECT_EQ( 1u, statistics.num_subsequence_failures );
+  EXPECT_EQ( 2u, statistics.num_matches );
+}
+
+} // namespace YouCompleteMe
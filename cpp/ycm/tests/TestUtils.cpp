@@ -17,6 +17,8 @@
 
 #include "TestUtils.h"
 
+#include <random>
+#include <system_error>
 #include <whereami.c>
 
 namespace std {
@@ -113,4 +115,20 @@ fs::path PathToTestFile( std::string_view filepath ) {
   return path_to_testdata / fs::path( filepath );
 }
 
+
+TemporaryDirectory::TemporaryDirectory() {
+  std::random_device random_device;
+  std::mt19937_64 generator( random_device() );
+  do {
+    path_ = fs::temp_directory_path() /
+            ( "ycm_test_" + std::to_string( generator() ) );
+  } while ( !fs::create_directory( path_ ) );
+}
+
+
+TemporaryDirectory::~TemporaryDirectory() {
+  std::error_code error;
+  fs::remove_all( path_, error );
+}
+
 } // namespace YouCompleteMe
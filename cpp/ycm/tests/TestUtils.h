@@ -214,6 +214,24 @@ MATCHER_P( ContainsPointees, expected, PrintToString( expected ) ) {
 
 fs::path PathToTestFile( std::string_view filepath );
 
+
+// Directory with a unique name created in the temporary directory of the
+// system and removed with its contents on destruction.
+class TemporaryDirectory {
+public:
+  TemporaryDirectory();
+  TemporaryDirectory( const TemporaryDirectory& ) = delete;
+  TemporaryDirectory& operator=( const TemporaryDirectory& ) = delete;
+  ~TemporaryDirectory();
+
+  const fs::path &Path() const {
+    return path_;
+  }
+
+private:
+  fs::path path_;
+};
+
 } // namespace YouCompleteMe
 
 #endif /* end of include guard: TESTUTILS_H_G4RKMGUD */
@@ -0,0 +1,235 @@
+// Copyright (C) 2020 ycmd contributors
+//
+// This file is part of ycmd.
+//
+// ycmd is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ycmd is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ThreadPool.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using ::testing::ElementsAre;
+
+namespace YouCompleteMe {
+
+class ThreadPoolTest : public ::testing::Test {
+protected:
+  ThreadPoolTest()
+    : pool_( ThreadPool::Instance() ) {
+  }
+
+  virtual void TearDown() {
+    pool_.SetNumThreads( 0 );
+  }
+
+  ThreadPool &pool_;
+};
+
+
+TEST_F( ThreadPoolTest, SubmitReturnsResult ) {
+  std::vector< std::future< int > > futures;
+  for ( int i = 0; i < 100; ++i ) {
+    futures.push_back( pool_.Submit( [ i ] { return i * i; } ) );
+  }
+
+  for ( int i = 0; i < 100; ++i ) {
+    EXPECT_EQ( i * i, futures[ i ].get() );
+  }
+}
+
+
+TEST_F( ThreadPoolTest, SubmitForwardsExceptions ) {
+  auto future = pool_.Submit( []() -> int {
+    throw std::runtime_error( "error" );
+  } );
+  EXPECT_THROW( future.get(), std::runtime_error );
+}
+
+
+TEST_F( ThreadPoolTest, NumThreads ) {
+  pool_.SetNumThreads( 3 );
+  EXPECT_EQ( 3u, pool_.NumThreads() );
+
+  pool_.SetNumThreads( 0 );
+  EXPECT_LE( 1u, pool_.NumThreads() );
+}
+
+
+TEST_F( ThreadPoolTest, HigherPriorityTasksStartFirst ) {
+  pool_.SetNumThreads( 1 );
+
+  // Keep the only worker busy while the other tasks are queued.
+  std::promise< void > release;
+  std::shared_future< void > released = release.get_future().share();
+  auto blocker = pool_.Submit( [ released ] { released.wait(); } );
+
+  std::mutex order_mutex;
+  std::vector< char > order;
+  auto record = [ &order_mutex, &order ]( char task ) {
+    return [ &order_mutex, &order, task ] {
+      std::lock_guard locker( order_mutex );
+      order.push_back( task );
+    };
+  };
+
+  auto low = pool_.Submit( record( 'l' ), TaskPriority::LOW );
+  auto normal = pool_.Submit( record( 'n' ), TaskPriority::NORMAL );
+  auto high = pool_.Submit( record( 'h' ), TaskPriority::HIGH );
+  release.set_value();
+
+  low.wait();
+  normal.wait();
+  high.wait();
+  blocker.wait();
+  EXPECT_THAT( order, ElementsAre( 'h', 'n', 'l' ) );
+}
+
+
+TEST_F( ThreadPoolTest, CancelledTasksDoNotRun ) {
+  pool_.SetNumThreads( 1 );
+
+  std::promise< void > release;
+  std::shared_future< void > released = release.get_future().share();
+  auto blocker = pool_.Submit( [ released ] { released.wait(); } );
+
+  bool has_run = false;
+  CancellationToken token;
+  auto cancelled = pool_.Submit( [ &has_run ] { has_run = true; },
+                                 TaskPriority::NORMAL,
+                                 token );
+  token.Cancel();
+  release.set_value();
+
+  EXPECT_THROW( cancelled.get(), TaskCancelled );
+  EXPECT_FALSE( has_run );
+  blocker.wait();
+}
+
+
+TEST_F( ThreadPoolTest, RunningTasksCanPollCancellation ) {
+  CancellationToken token;
+  auto future = pool_.Submit( [ token ] {
+    while ( !token.IsCancelled() ) {
+      std::this_thread::yield();
+    }
+    return true;
+  }, TaskPriority::NORMAL, token );
+
+  // Wait until the task started so that it isn't discarded.
+  while ( future.wait_for( std::chrono::milliseconds( 1 ) ) !=
+          std::future_status::ready ) {
+    token.Cancel();
+  }
+  try {
+    EXPECT_TRUE( future.get() );
+  } catch ( const TaskCancelled& ) {
+    // The task was cancelled before it started.
+  }
+}
+
+
+TEST_F( ThreadPoolTest, NestedTasksDoNotDeadlock ) {
+  pool_.SetNumThreads( 1 );
+
+  auto outer = pool_.Submit( [] {
+    TaskGroup tasks;
+    std::vector< std::future< int > > inner;
+    for ( int i = 0; i < 10; ++i ) {
+      inner.push_back( tasks.Submit( [ i ] { return i; } ) );
+    }
+    tasks.Wait();
+    int sum = 0;
+    for ( auto &future : inner ) {
+      sum += future.get();
+    }
+    return sum;
+  } );
+
+  EXPECT_EQ( 45, outer.get() );
+}
+
+
+TEST_F( ThreadPoolTest, TaskGroupWaitDoesNotRunUnrelatedTasks ) {
+  pool_.SetNumThreads( 1 );
+
+  // Keep the only worker busy, then queue a long task of another caller.
+  std::promise< void > release;
+  std::shared_future< void > released = release.get_future().share();
+  auto blocker = pool_.Submit( [ released ] { released.wait(); } );
+  std::thread::id unrelated_thread_id;
+  auto unrelated = pool_.Submit( [ released, &unrelated_thread_id ] {
+    released.wait();
+    unrelated_thread_id = std::this_thread::get_id();
+  } );
+
+  TaskGroup tasks;
+  std::vector< std::future< std::thread::id > > futures;
+  for ( int i = 0; i < 10; ++i ) {
+    futures.push_back( tasks.Submit( [] {
+      return std::this_thread::get_id();
+    } ) );
+  }
+  // Returns while the unrelated task is still queued.
+  tasks.Wait();
+  for ( auto &future : futures ) {
+    EXPECT_EQ( std::this_thread::get_id(), future.get() );
+  }
+  EXPECT_EQ( std::future_status::timeout,
+             unrelated.wait_for( std::chrono::seconds( 0 ) ) );
+
+  release.set_value();
+  unrelated.wait();
+  blocker.wait();
+  EXPECT_NE( std::this_thread::get_id(), unrelated_thread_id );
+}
+
+
+TEST_F( ThreadPoolTest, TaskGroupWaitReturnsForDiscardedTasks ) {
+  pool_.SetNumThreads( 1 );
+
+  std::promise< void > release;
+  std::shared_future< void > released = release.get_future().share();
+  auto blocker = pool_.Submit( [ released ] { released.wait(); } );
+
+  TaskGroup tasks;
+  auto discarded = tasks.Submit( [] { return 1; } );
+  std::thread shutdown( [ this ] { pool_.Shutdown(); } );
+  release.set_value();
+  shutdown.join();
+
+  // The task either ran before the shutdown or was discarded.
+  tasks.Wait();
+  blocker.wait();
+  EXPECT_EQ( std::future_status::ready,
+             discarded.wait_for( std::chrono::seconds( 0 ) ) );
+}
+
+
+TEST_F( ThreadPoolTest, RestartsAfterShutdown ) {
+  auto before = pool_.Submit( [] { return 1; } );
+  before.wait();
+  pool_.Shutdown();
+  pool_.Shutdown();
+
+  auto after = pool_.Submit( [] { return 2; } );
+  EXPECT_EQ( 1, before.get() );
+  EXPECT_EQ( 2, after.get() );
+}
+
+} // namespace YouCompleteMe
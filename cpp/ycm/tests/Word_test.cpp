@@ -24,6 +24,7 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+using ::testing::ElementsAre;
 using ::testing::TestWithParam;
 using ::testing::ValuesIn;
 
@@ -98,4 +99,29 @@ TEST( WordTest, DoesntMatchBytes ) {
   EXPECT_FALSE( word.ContainsBytes( Word( "Fβrmmm"  ) ) );
 }
 
+
+TEST( WordTest, CharacterClass ) {
+  EXPECT_EQ( CharacterClass::LOWERCASE_ASCII,
+             Word( "foo_bar1" ).GetCharacterClass() );
+  EXPECT_EQ( CharacterClass::LOWERCASE_ASCII, Word( "" ).GetCharacterClass() );
+  EXPECT_EQ( CharacterClass::ASCII, Word( "fooBar" ).GetCharacterClass() );
+  EXPECT_EQ( CharacterClass::ASCII, Word( "F" ).GetCharacterClass() );
+  EXPECT_EQ( CharacterClass::UNICODE, Word( "fóó" ).GetCharacterClass() );
+  EXPECT_EQ( CharacterClass::UNICODE, Word( "Fβr" ).GetCharacterClass() );
+  // CR followed by LF is a single character.
+  EXPECT_EQ( CharacterClass::UNICODE, Word( "a\r\nb" ).GetCharacterClass() );
+}
+
+
+TEST( WordTest, CharacterByteOffsets ) {
+  EXPECT_THAT( Word( "" ).CharacterByteOffsets(), ElementsAre( 0 ) );
+  EXPECT_THAT( Word( "foo" ).CharacterByteOffsets(),
+               ElementsAre( 0, 1, 2, 3 ) );
+  EXPECT_THAT( Word( "a\r\nb" ).CharacterByteOffsets(),
+               ElementsAre( 0, 1, 3, 4 ) );
+  // Precomposed and decomposed é.
+  EXPECT_THAT( Word( "fé𐍈e\xcc\x81r" ).CharacterByteOffsets(),
+               ElementsAre( 0, 1, 3, 7, 10, 11 ) );
+}
+
 } // namespace YouCompleteMe
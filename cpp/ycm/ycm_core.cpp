@@ -17,7 +17,10 @@
 
 #include "CodePoint.h"
 #include "IdentifierCompleter.h"
+#include "LatencyHistogram.h"
 #include "PythonSupport.h"
+#include "QueryStatistics.h"
+#include "ThreadPool.h"
 #include "versioning.h"
 
 #ifdef USE_CLANG_COMPLETER
@@ -32,6 +35,7 @@
 #  include "UnsavedFile.h"
 #endif // USE_CLANG_COMPLETER
 
+#include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
 namespace py = pybind11;
@@ -59,15 +63,100 @@ PYBIND11_MODULE( ycm_core, mod )
 {
   mod.def( "HasClangSupport", &HasClangSupport );
 
+  // Registered first since it's used as a default argument below.
+  py::class_< QueryOptions >( mod, "QueryOptions" )
+    .def( py::init<>() )
+    .def_readwrite( "min_candidate_chars", &QueryOptions::min_candidate_chars )
+    .def_readwrite( "max_candidate_chars", &QueryOptions::max_candidate_chars )
+    .def_readwrite( "exclude_query", &QueryOptions::exclude_query );
+
   mod.def( "FilterAndSortCandidates",
            &FilterAndSortCandidates,
            py::arg("candidates"),
            py::arg("candidate_property"),
            py::arg("query"),
-           py::arg("max_candidates") = 0 );
+           py::arg("max_candidates") = 0,
+           py::arg("options") = QueryOptions() );
+
+  py::class_< MatchPositions >( mod, "MatchPositions" )
+    .def_readonly( "byte_offsets", &MatchPositions::byte_offsets )
+    .def_readonly( "code_point_offsets", &MatchPositions::code_point_offsets );
+
+  mod.def( "FilterAndSortCandidatesWithMatchPositions",
+           &FilterAndSortCandidatesWithMatchPositions,
+           py::arg("candidates"),
+           py::arg("candidate_property"),
+           py::arg("query"),
+           py::arg("max_candidates") = 0,
+           py::arg("options") = QueryOptions() );
+
+  py::class_< FilterSession >( mod, "FilterSession" )
+    .def( py::init< py::list, const std::string & >(),
+          py::arg("candidates"),
+          py::arg("candidate_property") )
+    .def( "FilterAndSortCandidates",
+          &FilterSession::FilterAndSortCandidates,
+          py::arg("query"),
+          py::arg("max_candidates") = 0,
+          py::arg("options") = QueryOptions() )
+    .def( "__len__", &FilterSession::NumCandidates );
 
   mod.def( "YcmCoreVersion", &YcmCoreVersion );
 
+  py::class_< QueryStatistics >( mod, "QueryStatistics" )
+    .def_readonly( "source", &QueryStatistics::source )
+    .def_readonly( "query", &QueryStatistics::query )
+    .def_readonly( "num_queries", &QueryStatistics::num_queries )
+    .def_readonly( "num_visited_candidates",
+                   &QueryStatistics::num_visited_candidates )
+    .def_readonly( "num_prefilter_rejections",
+                   &QueryStatistics::num_prefilter_rejections )
+    .def_readonly( "num_subsequence_failures",
+                   &QueryStatistics::num_subsequence_failures )
+    .def_readonly( "num_matches", &QueryStatistics::num_matches )
+    .def_readonly( "lock_wait_ns", &QueryStatistics::lock_wait_ns )
+    .def_readonly( "matching_ns", &QueryStatistics::matching_ns )
+    .def_readonly( "lcs_ns", &QueryStatistics::lcs_ns )
+    .def_readonly( "sort_ns", &QueryStatistics::sort_ns );
+
+  mod.def( "TotalQueryStatistics",
+           []() { return QueryStatisticsRegistry::Instance().Totals(); } );
+
+  mod.def( "RecentQueryStatistics", []() {
+    return QueryStatisticsRegistry::Instance().RecentQueries();
+  } );
+
+  py::class_< LatencySnapshot >( mod, "LatencySnapshot" )
+    .def_readonly( "name", &LatencySnapshot::name )
+    .def_readonly( "count", &LatencySnapshot::count )
+    .def_readonly( "mean_ns", &LatencySnapshot::mean_ns )
+    .def_readonly( "max_ns", &LatencySnapshot::max_ns )
+    .def_readonly( "p50_ns", &LatencySnapshot::p50_ns )
+    .def_readonly( "p90_ns", &LatencySnapshot::p90_ns )
+    .def_readonly( "p99_ns", &LatencySnapshot::p99_ns )
+    .def_readonly( "p999_ns", &LatencySnapshot::p999_ns );
+
+  mod.def( "LatencySnapshots",
+           []() { return LatencyRegistry::Instance().Snapshot(); } );
+
+  mod.def( "ResetLatencyHistograms",
+           []() { LatencyRegistry::Instance().Reset(); } );
+
+  mod.def( "SetThreadPoolSize",
+           []( size_t num_threads ) {
+             ThreadPool::Instance().SetNumThreads( num_threads );
+           },
+           py::call_guard< py::gil_scoped_release >(),
+           py::arg( "num_threads" ) );
+
+  mod.def( "ShutdownThreadPool",
+           []() { ThreadPool::Instance().Shutdown(); },
+           py::call_guard< py::gil_scoped_release >() );
+
+  mod.def( "CompletionsToJson",
+           &CompletionsToJson,
+           py::arg( "completions" ) );
+
   // This is exposed so that we can test it.
   mod.def( "GetUtf8String", []( py::object o ) -> py::bytes {
                                   return GetUtf8String( o ); } );
@@ -83,12 +172,58 @@ PYBIND11_MODULE( ycm_core, mod )
     .def( "AddIdentifiersToDatabaseFromTagFiles",
           &IdentifierCompleter::AddIdentifiersToDatabaseFromTagFiles,
           py::call_guard< py::gil_scoped_release >() )
+    .def( "SaveSnapshot",
+          &IdentifierCompleter::SaveSnapshot,
+          py::call_guard< py::gil_scoped_release >() )
+    .def( "LoadSnapshot",
+          &IdentifierCompleter::LoadSnapshot,
+          py::call_guard< py::gil_scoped_release >() )
+    .def( "SetCandidateIndexEnabled",
+          &IdentifierCompleter::SetCandidateIndexEnabled,
+          py::call_guard< py::gil_scoped_release >() )
+    .def( "SetSpeculativeQueriesEnabled",
+          &IdentifierCompleter::SetSpeculativeQueriesEnabled,
+          py::call_guard< py::gil_scoped_release >() )
     .def( "CandidatesForQueryAndType",
           &IdentifierCompleter::CandidatesForQueryAndType,
           py::call_guard< py::gil_scoped_release >(),
           py::arg( "query" ),
           py::arg( "filetype" ),
-          py::arg( "max_candidates" ) = 0 );
+          py::arg( "max_candidates" ) = 0,
+          py::arg( "options" ) = QueryOptions() )
+    .def( "CandidatesWithMatchPositionsForQueryAndType",
+          &IdentifierCompleter::CandidatesWithMatchPositionsForQueryAndType,
+          py::call_guard< py::gil_scoped_release >(),
+          py::arg( "query" ),
+          py::arg( "filetype" ),
+          py::arg( "max_candidates" ) = 0,
+          py::arg( "options" ) = QueryOptions() )
+    .def( "CandidatesForQueryAndTypeWithDeadline",
+          &IdentifierCompleter::CandidatesForQueryAndTypeWithDeadline,
+          py::call_guard< py::gil_scoped_release >(),
+          py::arg( "query" ),
+          py::arg( "filetype" ),
+          py::arg( "filepath" ),
+          py::arg( "max_candidates" ),
+          py::arg( "time_budget_ms" ) )
+    .def( "CandidatesForQueryAndTypeInPaths",
+          &IdentifierCompleter::CandidatesForQueryAndTypeInPaths,
+          py::call_guard< py::gil_scoped_release >(),
+          py::arg( "query" ),
+          py::arg( "filetype" ),
+          py::arg( "filepaths" ),
+          py::arg( "path_prefix" ) = "",
+          py::arg( "max_candidates" ) = 0,
+          py::arg( "min_candidates" ) = 0,
+          py::arg( "options" ) = QueryOptions() )
+    .def( "CompletionsJsonForQueryAndType",
+          &IdentifierCompleter::CompletionsJsonForQueryAndType,
+          py::call_guard< py::gil_scoped_release >(),
+          py::arg( "query" ),
+          py::arg( "filetype" ),
+          py::arg( "max_candidates" ),
+          py::arg( "min_candidate_chars" ),
+          py::arg( "extra_menu_info" ) );
 
   py::bind_vector< std::vector< std::string > >( mod, "StringVector" );
 
@@ -109,6 +244,15 @@ PYBIND11_MODULE( ycm_core, mod )
 
   py::bind_vector< std::vector< UnsavedFile > >( mod, "UnsavedFileVector" );
 
+  py::class_< DiagnosticsFuture >( mod, "DiagnosticsFuture" )
+    .def( "IsReady", &DiagnosticsFuture::IsReady )
+    .def( "WaitFor",
+          &DiagnosticsFuture::WaitFor,
+          py::call_guard< py::gil_scoped_release >() )
+    .def( "Get",
+          &DiagnosticsFuture::Get,
+          py::call_guard< py::gil_scoped_release >() );
+
   py::class_< ClangCompleter >( mod, "ClangCompleter" )
     .def( py::init<>() )
     .def( "GetDeclarationLocation",
@@ -123,14 +267,69 @@ PYBIND11_MODULE( ycm_core, mod )
     .def( "DeleteCachesForFile",
           &ClangCompleter::DeleteCachesForFile,
           py::call_guard< py::gil_scoped_release >() )
+    .def( "SetTranslationUnitMemoryBudget",
+          &ClangCompleter::SetTranslationUnitMemoryBudget,
+          py::call_guard< py::gil_scoped_release >() )
+    .def( "SetPinnedTranslationUnits",
+          &ClangCompleter::SetPinnedTranslationUnits,
+          py::call_guard< py::gil_scoped_release >() )
+    .def( "SetDoubleBufferedTranslationUnits",
+          &ClangCompleter::SetDoubleBufferedTranslationUnits,
+          py::call_guard< py::gil_scoped_release >() )
+    .def( "SetMaxDiagnostics",
+          &ClangCompleter::SetMaxDiagnostics,
+          py::call_guard< py::gil_scoped_release >() )
+    .def( "SetTranslationUnitCacheDirectory",
+          &ClangCompleter::SetTranslationUnitCacheDirectory,
+          py::call_guard< py::gil_scoped_release >() )
     .def( "UpdatingTranslationUnit",
           &ClangCompleter::UpdatingTranslationUnit,
-          py::call_guard< py::gil_scoped_release >() )
+          py::call_guard< py::gil_scoped_release >(),
+          py::arg( "filename" ),
+          py::arg( "timeout_ms" ) = 0 )
     .def( "UpdateTranslationUnit",
           &ClangCompleter::UpdateTranslationUnit,
           py::call_guard< py::gil_scoped_release >() )
+    .def( "UpdateTranslationUnitDelta",
+          &ClangCompleter::UpdateTranslationUnitDelta,
+          py::call_guard< py::gil_scoped_release >() )
+    .def( "UpdateTranslationUnitAsync",
+          &ClangCompleter::UpdateTranslationUnitAsync,
+          py::call_guard< py::gil_scoped_release >() )
     .def( "CandidatesForLocationInFile",
-          &ClangCompleter::CandidatesForLocationInFile,
+          py::overload_cast< const std::string &,
+                             const std::string &,
+                             int,
+                             int,
+                             const std::vector< UnsavedFile > &,
+                             const std::vector< std::string > & >(
+            &ClangCompleter::CandidatesForLocationInFile ),
+          py::call_guard< py::gil_scoped_release >() )
+    // Returns a (completions, number of completions before filtering) tuple.
+    .def( "FilteredCandidatesForLocationInFile",
+          []( ClangCompleter &completer,
+              const std::string &translation_unit,
+              const std::string &filename,
+              int line,
+              int column,
+              const std::vector< UnsavedFile > &unsaved_files,
+              const std::vector< std::string > &flags,
+              std::string query,
+              size_t max_candidates ) {
+            size_t num_completions;
+            std::vector< CompletionData > completions =
+              completer.CandidatesForLocationInFile( translation_unit,
+                                                     filename,
+                                                     line,
+                                                     column,
+                                                     unsaved_files,
+                                                     flags,
+                                                     std::move( query ),
+                                                     max_candidates,
+                                                     num_completions );
+            return std::make_pair( std::move( completions ),
+                                   num_completions );
+          },
           py::call_guard< py::gil_scoped_release >() )
     .def( "GetTypeAtLocation",
           &ClangCompleter::GetTypeAtLocation,
@@ -167,11 +366,16 @@ PYBIND11_MODULE( ycm_core, mod )
           &CompletionData::DetailedInfoForPreviewWindow )
     .def( "DocString", &CompletionData::DocString )
     .def_readonly( "kind_", &CompletionData::kind_ )
-    .def_readonly( "fixit_", &CompletionData::fixit_ );
+    .def_property_readonly( "fixit_", &CompletionData::CompletionFixIt );
 
   py::bind_vector< std::vector< CompletionData > >( mod,
                                                     "CompletionVector" );
 
+  mod.def( "CompletionDataToJson",
+           &CompletionDataToJson,
+           py::call_guard< py::gil_scoped_release >(),
+           py::arg( "completions" ) );
+
   py::class_< Location >( mod, "Location" )
     .def( py::init<>() )
     .def_readonly( "line_number_", &Location::line_number_ )
@@ -217,10 +421,20 @@ PYBIND11_MODULE( ycm_core, mod )
     .def_readonly( "kind_", &Diagnostic::kind_ )
     .def_readonly( "text_", &Diagnostic::text_ )
     .def_readonly( "long_formatted_text_", &Diagnostic::long_formatted_text_ )
-    .def_readonly( "fixits_", &Diagnostic::fixits_ );
+    .def_readonly( "fixits_", &Diagnostic::fixits_ )
+    .def_readonly( "id_", &Diagnostic::id_ );
 
   py::bind_vector< std::vector< Diagnostic > >( mod, "DiagnosticVector" );
 
+  py::class_< DiagnosticsDelta >( mod, "DiagnosticsDelta" )
+    .def( py::init<>() )
+    .def_readonly( "generation_", &DiagnosticsDelta::generation_ )
+    .def_readonly( "unchanged_", &DiagnosticsDelta::unchanged_ )
+    .def_readonly( "full_", &DiagnosticsDelta::full_ )
+    .def_readonly( "added_", &DiagnosticsDelta::added_ )
+    .def_readonly( "removed_", &DiagnosticsDelta::removed_ )
+    .def_readonly( "ids_", &DiagnosticsDelta::ids_ );
+
   py::class_< DocumentationData >( mod, "DocumentationData" )
     .def( py::init<>() )
     .def_readonly( "comment_xml", &DocumentationData::comment_xml )
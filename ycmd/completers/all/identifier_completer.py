@@ -19,11 +19,13 @@ import os
 from collections import defaultdict
 from ycmd.completers.general_completer import GeneralCompleter
 from ycmd import identifier_utils
-from ycmd.utils import ImportCore, LOGGER, SplitLines
+from ycmd.utils import ( ExpandVariablesInPath, ImportCore, LOGGER, SplitLines,
+                         UserDataDirectory )
 from ycmd import responses
 ycm_core = ImportCore()
 
 SYNTAX_FILENAME = 'YCM_PLACEHOLDER_FOR_SYNTAX'
+SNAPSHOT_FILENAME = 'identifiers.snapshot'
 
 
 class IdentifierCompleter( GeneralCompleter ):
@@ -32,6 +34,9 @@ class IdentifierCompleter( GeneralCompleter ):
     self._completer = ycm_core.IdentifierCompleter()
     self._tags_file_last_mtime = defaultdict( int )
     self._max_candidates = user_options[ 'max_num_identifier_candidates' ]
+    self._snapshot_path = _SnapshotPath( user_options )
+    if self._snapshot_path:
+      self._LoadSnapshot()
 
 
   def ShouldUseNow( self, request_data ):
@@ -42,20 +47,14 @@ class IdentifierCompleter( GeneralCompleter ):
     if not self.ShouldUseNow( request_data ):
       return []
 
-    completions = self._completer.CandidatesForQueryAndType(
-      _SanitizeQuery( request_data[ 'query' ] ),
-      request_data[ 'first_filetype' ],
-      self._max_candidates )
-
-    completions = _RemoveSmallCandidates(
-      completions, self.user_options[ 'min_num_identifier_candidate_chars' ] )
-
-    def ConvertCompletionData( x ):
-      return responses.BuildCompletionData(
-              insertion_text = x,
-              extra_menu_info='[ID]' )
-
-    return [ ConvertCompletionData( x ) for x in completions ]
+    # The completions are directly encoded to JSON by ycm_core.
+    return responses.JsonCompletions(
+      self._completer.CompletionsJsonForQueryAndType(
+        _SanitizeQuery( request_data[ 'query' ] ),
+        request_data[ 'first_filetype' ],
+        self._max_candidates,
+        self.user_options[ 'min_num_identifier_candidate_chars' ],
+        '[ID]' ) )
 
 
   def _AddIdentifier( self, identifier, request_data ):
@@ -153,6 +152,33 @@ class IdentifierCompleter( GeneralCompleter ):
       filepath )
 
 
+  def _LoadSnapshot( self ):
+    if not os.path.isfile( self._snapshot_path ):
+      return
+    LOGGER.info( 'Loading identifiers from snapshot %s', self._snapshot_path )
+    if not self._completer.LoadSnapshot( self._snapshot_path ):
+      LOGGER.warning( 'Failed to load identifiers from snapshot %s',
+                      self._snapshot_path )
+
+
+  def _SaveSnapshot( self ):
+    LOGGER.info( 'Saving identifiers to snapshot %s', self._snapshot_path )
+    try:
+      os.makedirs( os.path.dirname( self._snapshot_path ), exist_ok = True )
+    except OSError:
+      LOGGER.exception( 'Failed to create the directory of snapshot %s',
+                        self._snapshot_path )
+      return
+    if not self._completer.SaveSnapshot( self._snapshot_path ):
+      LOGGER.warning( 'Failed to save identifiers to snapshot %s',
+                      self._snapshot_path )
+
+
+  def Shutdown( self ):
+    if self._snapshot_path:
+      self._SaveSnapshot()
+
+
   def OnFileReadyToParse( self, request_data ):
     self._AddBufferIdentifiers( request_data )
     if 'tag_files' in request_data:
@@ -170,6 +196,17 @@ class IdentifierCompleter( GeneralCompleter ):
     self._AddPreviousIdentifier( request_data )
 
 
+def _SnapshotPath( user_options ):
+  """Returns the file where the identifier database is saved on shutdown and
+  loaded from on startup, or None if snapshots are disabled."""
+  if not user_options.get( 'identifier_snapshots' ):
+    return None
+  snapshot_file = user_options.get( 'identifier_snapshot_file' )
+  if snapshot_file:
+    return os.path.abspath( ExpandVariablesInPath( snapshot_file ) )
+  return os.path.join( UserDataDirectory(), SNAPSHOT_FILENAME )
+
+
 # This looks for the previous identifier and returns it; this might mean looking
 # at last identifier on the previous line if a new line has just been created.
 def _PreviousIdentifier( min_num_candidate_size_chars,
@@ -213,13 +250,6 @@ def _PreviousIdentifier( min_num_candidate_size_chars,
   return ident
 
 
-def _RemoveSmallCandidates( candidates, min_num_candidate_size_chars ):
-  if min_num_candidate_size_chars == 0:
-    return candidates
-
-  return [ x for x in candidates if len( x ) >= min_num_candidate_size_chars ]
-
-
 def _GetCursorIdentifier( collect_from_comments_and_strings,
                           request_data ):
   filepath = request_data[ 'filepath' ]
@@ -209,6 +209,9 @@ class Completer( metaclass = abc.ABCMeta ):
       if not user_options[ 'disable_signature_help' ] else None )
 
     self._completions_cache = CompletionsCache()
+    # Tuple of the last filtered candidates, their sort property, and the native
+    # filter session created for them.
+    self._filter_session = None
     self._max_candidates = user_options[ 'max_num_candidates' ]
     self._max_candidates_to_detail = user_options[
       'max_num_candidates_to_detail' ]
@@ -430,8 +433,21 @@ class Completer( metaclass = abc.ABCMeta ):
 
 
   def FilterAndSortCandidatesInner( self, candidates, sort_property, query ):
-    return completer_utils.FilterAndSortCandidatesWrap(
-      candidates, sort_property, query, self._max_candidates )
+    # Candidates are usually the same list between keystrokes since they come
+    # from the completions cache. Reuse the filter session in that case so that
+    # the candidates are not extracted again.
+    filter_session = self._filter_session
+    if ( filter_session is None or
+         filter_session[ 0 ] is not candidates or
+         filter_session[ 1 ] != sort_property ):
+      filter_session = ( candidates,
+                         sort_property,
+                         completer_utils.FilterSessionWrap( candidates,
+                                                            sort_property ) )
+      self._filter_session = filter_session
+
+    return filter_session[ 2 ].FilterAndSortCandidates( query,
+                                                        self._max_candidates )
 
 
   def OnFileReadyToParse( self, request_data ):
@@ -18,6 +18,8 @@
 from collections import defaultdict
 import os.path
 import textwrap
+import threading
+import time
 import xml.etree.ElementTree
 from xml.etree.ElementTree import ParseError as XmlParseError
 
@@ -36,9 +38,13 @@ PARSING_FILE_MESSAGE = 'Still parsing file.'
 NO_COMPILE_FLAGS_MESSAGE = 'Still no compile flags.'
 NO_COMPLETIONS_MESSAGE = 'No completions found; errors in the file?'
 NO_DIAGNOSTIC_MESSAGE = 'No diagnostic for current line!'
+# Keep in sync with TranslationUnit.cpp.
 PRAGMA_DIAG_TEXT_TO_IGNORE = '#pragma once in main file'
 TOO_MANY_ERRORS_DIAG_TEXT_TO_IGNORE = 'too many errors emitted, stopping now'
 NO_DOCUMENTATION_MESSAGE = 'No documentation available for current context'
+# How long to wait for a background parse before returning the diagnostics of
+# the previous one.
+BACKGROUND_PARSE_WAIT_MS = 100
 INCLUDE_REGEX = re.compile(
   '(\\s*#\\s*(?:include|import)\\s*)(?:"[^"]*|<[^>]*)' )
 
@@ -51,6 +57,40 @@ class ClangCompleter( Completer ):
     self._include_cache = IncludeCache()
     self._diagnostic_store = None
     self._files_being_compiled = EphemeralValuesSet()
+    self._background_parsing = user_options[ 'clang_background_parsing' ]
+    # How long requests wait for a translation unit being created before
+    # failing with PARSING_FILE_MESSAGE.
+    self._translation_unit_wait_ms = user_options[
+      'clang_translation_unit_wait_ms' ]
+    # translation unit -> DiagnosticsFuture of the last background parse
+    self._background_updates = {}
+    # translation unit -> diagnostics of the last finished background parse
+    self._background_diagnostics = {}
+    # translation unit -> ( DiagnosticsFuture, filepath ) of the last background
+    # parse, while its diagnostics haven't been returned to the client. They are
+    # returned by PollForMessages.
+    self._pending_background_updates = {}
+    self._background_updates_lock = threading.Lock()
+    self._background_updates_changed = threading.Condition(
+      self._background_updates_lock )
+    # translation unit -> ( generation, { id: diagnostic }, diagnostics ) of the
+    # last parse, updated from the changes returned by ycm_core.
+    self._diagnostics = {}
+    # translation unit -> ( generation, filepath, diagnostic store, response )
+    # of the last parse, returned as is while the diagnostics don't change.
+    self._diagnostic_responses = {}
+    self._completer.SetTranslationUnitMemoryBudget(
+      user_options[ 'clang_translation_unit_memory_budget_mb' ] *
+      1024 * 1024 )
+    self._completer.SetDoubleBufferedTranslationUnits(
+      bool( user_options[ 'clang_double_buffered_translation_units' ] ) )
+    self._completer.SetMaxDiagnostics( self.max_diagnostics_to_display )
+    # Only used when the translation units are double-buffered: libclang can't
+    # reparse nor complete a loaded translation unit so the others would be
+    # parsed from scratch right after being loaded anyway.
+    self._completer.SetTranslationUnitCacheDirectory(
+      user_options[ 'clang_translation_unit_cache_directory' ],
+      user_options[ 'clang_translation_unit_cache_size_mb' ] * 1024 * 1024 )
 
 
   def SupportedFiletypes( self ):
@@ -126,34 +166,45 @@ class ClangCompleter( Completer ):
     return includes.GetIncludes()
 
 
-  def ComputeCandidatesInner( self, request_data ):
+  def ComputeCandidates( self, request_data ):
+    if ( not request_data[ 'force_semantic' ] and
+         not self.ShouldUseNow( request_data ) ):
+      return []
+
     flags, filename = self._FlagsForRequest( request_data )
     if not flags:
       raise RuntimeError( NO_COMPILE_FLAGS_MESSAGE )
 
     includes = self.GetIncludePaths( request_data )
     if includes is not None:
-      return includes
+      return self.FilterAndSortCandidates( includes, request_data[ 'query' ] )
 
-    if self._completer.UpdatingTranslationUnit( filename ):
+    if self._completer.UpdatingTranslationUnit(
+        filename, self._translation_unit_wait_ms ):
       raise RuntimeError( PARSING_FILE_MESSAGE )
 
     files = self.GetUnsavedFilesVector( request_data )
     line = request_data[ 'line_num' ]
     column = request_data[ 'start_column' ]
+    # Completions are filtered and sorted natively and cached per location so
+    # only the returned ones are converted.
     with self._files_being_compiled.GetExclusive( filename ):
-      results = self._completer.CandidatesForLocationInFile(
+      results, num_completions = (
+        self._completer.FilteredCandidatesForLocationInFile(
           filename,
           request_data[ 'filepath' ],
           line,
           column,
           files,
-          flags )
+          flags,
+          request_data[ 'query' ],
+          self._max_candidates ) )
 
-    if not results:
+    if not num_completions:
       raise RuntimeError( NO_COMPLETIONS_MESSAGE )
 
-    return [ ConvertCompletionData( x ) for x in results ]
+    # Same contents as ConvertCompletionData but directly encoded to JSON.
+    return responses.JsonCompletions( ycm_core.CompletionDataToJson( results ) )
 
 
   def GetSubcommandsMap( self ):
@@ -199,7 +250,8 @@ class ClangCompleter( Completer ):
     if not flags:
       raise ValueError( NO_COMPILE_FLAGS_MESSAGE )
 
-    if self._completer.UpdatingTranslationUnit( filename ):
+    if self._completer.UpdatingTranslationUnit(
+        filename, self._translation_unit_wait_ms ):
       raise RuntimeError( PARSING_FILE_MESSAGE )
 
     files = self.GetUnsavedFilesVector( request_data )
@@ -307,7 +359,8 @@ class ClangCompleter( Completer ):
     if not flags:
       raise ValueError( NO_COMPILE_FLAGS_MESSAGE )
 
-    if self._completer.UpdatingTranslationUnit( filename ):
+    if self._completer.UpdatingTranslationUnit(
+        filename, self._translation_unit_wait_ms ):
       raise RuntimeError( PARSING_FILE_MESSAGE )
 
     files = self.GetUnsavedFilesVector( request_data )
@@ -338,7 +391,8 @@ class ClangCompleter( Completer ):
     if not flags:
       raise ValueError( NO_COMPILE_FLAGS_MESSAGE )
 
-    if self._completer.UpdatingTranslationUnit( filename ):
+    if self._completer.UpdatingTranslationUnit(
+        filename, self._translation_unit_wait_ms ):
       raise RuntimeError( PARSING_FILE_MESSAGE )
 
     files = self.GetUnsavedFilesVector( request_data )
@@ -365,17 +419,163 @@ class ClangCompleter( Completer ):
     if not flags:
       raise ValueError( NO_COMPILE_FLAGS_MESSAGE )
 
+    # Translation units of the files opened in the editor are never evicted.
+    pinned_files = ycm_core.StringVector()
+    pinned_files.append( filename )
+    for filepath, file_data in request_data[ 'file_data' ].items():
+      if ClangAvailableForFiletypes( file_data[ 'filetypes' ] ):
+        pinned_files.append( filepath )
+    self._completer.SetPinnedTranslationUnits( pinned_files )
+
+    if self._background_parsing:
+      diagnostics = self._UpdateTranslationUnitInBackground(
+        filename,
+        request_data[ 'filepath' ],
+        self.GetUnsavedFilesVector( request_data ),
+        flags )
+      diagnostics = _FilterDiagnostics( diagnostics )
+      self._diagnostic_store = DiagnosticsToDiagStructure( diagnostics )
+      return responses.BuildDiagnosticResponse(
+        diagnostics,
+        request_data[ 'filepath' ],
+        self.max_diagnostics_to_display )
+
+    filepath = request_data[ 'filepath' ]
     with self._files_being_compiled.GetExclusive( filename ):
-      diagnostics = self._completer.UpdateTranslationUnit(
+      generation, diagnostics = self._UpdateTranslationUnitDelta(
         filename,
         self.GetUnsavedFilesVector( request_data ),
         flags )
 
-    diagnostics = _FilterDiagnostics( diagnostics )
-    self._diagnostic_store = DiagnosticsToDiagStructure( diagnostics )
-    return responses.BuildDiagnosticResponse( diagnostics,
-                                              request_data[ 'filepath' ],
-                                              self.max_diagnostics_to_display )
+      cached = self._diagnostic_responses.get( filename )
+      if cached is not None and cached[ : 2 ] == ( generation, filepath ):
+        self._diagnostic_store = cached[ 2 ]
+        return cached[ 3 ]
+
+      diagnostics = _FilterDiagnostics( diagnostics )
+      diagnostic_store = DiagnosticsToDiagStructure( diagnostics )
+      response = responses.BuildDiagnosticResponse(
+        diagnostics,
+        filepath,
+        self.max_diagnostics_to_display )
+      self._diagnostic_responses[ filename ] = ( generation,
+                                                 filepath,
+                                                 diagnostic_store,
+                                                 response )
+    self._diagnostic_store = diagnostic_store
+    return response
+
+
+  def _UpdateTranslationUnitDelta( self, filename, unsaved_files, flags ):
+    """Parses the translation unit and returns the ( generation, diagnostics )
+    of the parse. Only the diagnostics that changed since the last parse are
+    converted by ycm_core."""
+    generation, diagnostics_by_id, diagnostics = self._diagnostics.get(
+      filename, ( 0, {}, [] ) )
+    delta = self._completer.UpdateTranslationUnitDelta( filename,
+                                                        unsaved_files,
+                                                        flags,
+                                                        generation )
+    if not delta.unchanged_:
+      if delta.full_:
+        diagnostics_by_id = {}
+      for diagnostic_id in delta.removed_:
+        diagnostics_by_id.pop( diagnostic_id, None )
+      for diagnostic in delta.added_:
+        diagnostics_by_id[ diagnostic.id_ ] = diagnostic
+      diagnostics = [ diagnostics_by_id[ diagnostic_id ]
+                      for diagnostic_id in delta.ids_ ]
+
+    self._diagnostics[ filename ] = ( delta.generation_,
+                                      diagnostics_by_id,
+                                      diagnostics )
+    return delta.generation_, diagnostics
+
+
+  def _UpdateTranslationUnitInBackground( self,
+                                          filename,
+                                          filepath,
+                                          unsaved_files,
+                                          flags ):
+    """Queues a parse of the translation unit on the native thread pool. Returns
+    its diagnostics if it finishes quickly, otherwise those of the last finished
+    parse so that the request thread isn't held for the whole parse. The
+    diagnostics of the queued parse are then returned by PollForMessages."""
+    update = self._completer.UpdateTranslationUnitAsync( filename,
+                                                         unsaved_files,
+                                                         flags )
+    with self._background_updates_lock:
+      previous_update = self._background_updates.get( filename )
+      self._background_updates[ filename ] = update
+      diagnostics = self._background_diagnostics.get( filename, [] )
+
+    finished = update.WaitFor( BACKGROUND_PARSE_WAIT_MS )
+    if finished:
+      diagnostics = update.Get()
+    elif ( previous_update is not None and
+           previous_update is not update and
+           previous_update.IsReady() ):
+      try:
+        diagnostics = previous_update.Get()
+      except ycm_core.ClangParseError:
+        pass
+
+    with self._background_updates_lock:
+      self._background_diagnostics[ filename ] = diagnostics
+      if finished:
+        pending = self._pending_background_updates.get( filename )
+        if pending is not None and pending[ 0 ] is update:
+          del self._pending_background_updates[ filename ]
+      else:
+        self._pending_background_updates[ filename ] = ( update, filepath )
+        self._background_updates_changed.notify_all()
+    return diagnostics
+
+
+  def PollForMessagesInner( self, request_data, timeout ):
+    if not self._background_parsing:
+      return super().PollForMessagesInner( request_data, timeout )
+
+    deadline = time.monotonic() + timeout
+    with self._background_updates_lock:
+      while True:
+        messages = self._FinishedBackgroundUpdateMessages()
+        if messages:
+          return messages
+
+        remaining = deadline - time.monotonic()
+        if remaining <= 0:
+          return True
+        # The parses can't notify when they finish so they are checked again
+        # every so often.
+        if self._pending_background_updates:
+          remaining = min( remaining, BACKGROUND_PARSE_WAIT_MS / 1000 )
+        self._background_updates_changed.wait( remaining )
+
+
+  def _FinishedBackgroundUpdateMessages( self ):
+    """Returns a diagnostics message for each pending background parse that
+    finished. Must be called under the _background_updates_lock."""
+    messages = []
+    for filename, ( update, filepath ) in list(
+        self._pending_background_updates.items() ):
+      if not update.IsReady():
+        continue
+      del self._pending_background_updates[ filename ]
+      try:
+        diagnostics = update.Get()
+      except ycm_core.ClangParseError:
+        continue
+      self._background_diagnostics[ filename ] = diagnostics
+
+      diagnostics = _FilterDiagnostics( diagnostics )
+      self._diagnostic_store = DiagnosticsToDiagStructure( diagnostics )
+      messages.append( {
+        'diagnostics': responses.BuildDiagnosticResponse(
+          diagnostics, filepath, self.max_diagnostics_to_display ),
+        'filepath': filepath
+      } )
+    return messages
 
 
   def OnBufferUnload( self, request_data ):
@@ -389,6 +589,12 @@ class ClangCompleter( Completer ):
     # Solving this would require remembering the graph of files to translation
     # units and only closing a unit when there are no files open which use it.
     self._completer.DeleteCachesForFile( request_data[ 'filepath' ] )
+    with self._background_updates_lock:
+      self._background_updates.pop( request_data[ 'filepath' ], None )
+      self._background_diagnostics.pop( request_data[ 'filepath' ], None )
+      self._pending_background_updates.pop( request_data[ 'filepath' ], None )
+    self._diagnostics.pop( request_data[ 'filepath' ], None )
+    self._diagnostic_responses.pop( request_data[ 'filepath' ], None )
 
 
   def GetDetailedDiagnostic( self, request_data ):
@@ -415,8 +621,9 @@ class ClangCompleter( Completer ):
         distance_to_closest_diagnostic = distance
         closest_diagnostic = diagnostic
 
+    # Only the displayed diagnostics have their formatted text.
     return responses.BuildDisplayMessageResponse(
-      closest_diagnostic.long_formatted_text_ )
+      closest_diagnostic.long_formatted_text_ or closest_diagnostic.text_ )
 
 
   def DebugInfo( self, request_data ):
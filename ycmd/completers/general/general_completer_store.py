@@ -15,10 +15,15 @@
 # You should have received a copy of the GNU General Public License
 # along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
 
+from itertools import chain
+
 from ycmd.completers.completer import Completer
 from ycmd.completers.all.identifier_completer import IdentifierCompleter
 from ycmd.completers.general.filename_completer import FilenameCompleter
 from ycmd.completers.general.ultisnips_completer import UltiSnipsCompleter
+from ycmd.responses import JsonCompletions
+from ycmd.utils import ImportCore
+ycm_core = ImportCore()
 
 
 class GeneralCompleterStore( Completer ):
@@ -54,9 +59,9 @@ class GeneralCompleterStore( Completer ):
     candidates = self._filename_completer.ComputeCandidates( request_data )
     if candidates:
       return candidates
-    for completer in self._non_filename_completers:
-      candidates += completer.ComputeCandidates( request_data )
-    return candidates
+    return _ConcatenateCompletions(
+      [ completer.ComputeCandidates( request_data )
+        for completer in self._non_filename_completers ] )
 
 
   def OnFileReadyToParse( self, request_data ):
@@ -92,3 +97,15 @@ class GeneralCompleterStore( Completer ):
   def Shutdown( self ):
     for completer in self._all_completers:
       completer.Shutdown()
+
+
+def _ConcatenateCompletions( completions_list ):
+  if not any( isinstance( completions, JsonCompletions )
+              for completions in completions_list ):
+    return list( chain.from_iterable( completions_list ) )
+
+  # Concatenate the JSON arrays without their brackets.
+  return JsonCompletions( '[' + ','.join(
+    ( completions.json if isinstance( completions, JsonCompletions ) else
+      ycm_core.CompletionsToJson( completions ) )[ 1 : -1 ]
+    for completions in completions_list if completions ) + ']' )
@@ -30,6 +30,7 @@ from ycmd.responses import ( BuildExceptionResponse,
                              BuildResolveCompletionResponse,
                              BuildSignatureHelpResponse,
                              BuildSignatureHelpAvailableResponse,
+                             JsonCompletions,
                              SignatureHelpAvailalability,
                              UnknownExtraConf )
 from ycmd.request_wrap import RequestWrap
@@ -137,10 +138,9 @@ def GetCompletions():
     completions = _server_state.GetGeneralCompleter().ComputeCandidates(
       request_data )
 
-  return _JsonResponse(
-      BuildCompletionResponse( completions if completions else [],
-                               request_data[ 'start_column' ],
-                               errors = errors ) )
+  return _JsonCompletionResponse( completions if completions else [],
+                                 request_data[ 'start_column' ],
+                                 errors )
 
 
 @app.post( '/resolve_completion' )
@@ -290,6 +290,13 @@ def DebugInfo():
       'path': extra_conf_path,
       'is_loaded': is_loaded
     },
+    'query_statistics': {
+      'total': _QueryStatisticsToDict( ycm_core.TotalQueryStatistics() ),
+      'recent': [ _QueryStatisticsToDict( statistics )
+                  for statistics in ycm_core.RecentQueryStatistics() ]
+    },
+    'latencies': { snapshot.name: _LatencySnapshotToDict( snapshot )
+                   for snapshot in ycm_core.LatencySnapshots() },
     'completer': None
   }
 
@@ -346,6 +353,20 @@ def _JsonResponse( data ):
                      default = _UniversalSerialize )
 
 
+def _JsonCompletionResponse( completions, start_column, errors ):
+  # Completions are encoded by ycm_core, which is much faster than the json
+  # module for many completions, and spliced into the response.
+  if isinstance( completions, JsonCompletions ):
+    completions_json = completions.json
+  else:
+    completions_json = ycm_core.CompletionsToJson( completions )
+
+  response = BuildCompletionResponse( None, start_column, errors = errors )
+  del response[ 'completions' ]
+  return '{"completions":' + completions_json + ',' + _JsonResponse(
+    response )[ 1 : ]
+
+
 def _UniversalSerialize( obj ):
   try:
     serialized = obj.__dict__.copy()
@@ -376,10 +397,37 @@ def ServerShutdown():
   StartThread( Terminator )
 
 
+def _QueryStatisticsToDict( statistics ):
+  return { field: getattr( statistics, field ) for field in [
+    'source',
+    'query',
+    'num_queries',
+    'num_visited_candidates',
+    'num_prefilter_rejections',
+    'num_subsequence_failures',
+    'num_matches',
+    'lock_wait_ns',
+    'matching_ns',
+    'lcs_ns',
+    'sort_ns' ] }
+
+
+def _LatencySnapshotToDict( snapshot ):
+  return { field: getattr( snapshot, field ) for field in [
+    'count',
+    'mean_ns',
+    'max_ns',
+    'p50_ns',
+    'p90_ns',
+    'p99_ns',
+    'p999_ns' ] }
+
+
 def ServerCleanup():
   if _server_state:
     _server_state.Shutdown()
     extra_conf_store.Shutdown()
+  ycm_core.ShutdownThreadPool()
 
 
 def SetHmacSecret( hmac_secret ):
@@ -396,6 +444,7 @@ def UpdateUserOptions( options ):
   # This should never be passed in, but let's try to remove it just in case.
   options.pop( 'hmac_secret', None )
   user_options_store.SetAll( options )
+  ycm_core.SetThreadPoolSize( options.get( 'core_threads', 0 ) )
   _server_state = server_state.ServerState( options )
 
 
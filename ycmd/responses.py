@@ -126,6 +126,19 @@ def BuildCompletionData( insertion_text,
   return completion_data
 
 
+class JsonCompletions:
+  """List of completions already encoded to a JSON array, e.g. by ycm_core. It
+  is spliced as is into the completion response so that no dict has to be built
+  for each completion."""
+
+  def __init__( self, json ):
+    self.json = json
+
+
+  def __bool__( self ):
+    return self.json != '[]'
+
+
 # start_column is a byte offset
 def BuildCompletionResponse( completions,
                              start_column,
@@ -26,10 +26,14 @@ from hamcrest import ( assert_that,
                        contains_exactly,
                        contains_inanyorder,
                        contains_string,
+                       empty,
                        equal_to,
                        has_entries,
-                       has_properties )
+                       has_properties,
+                       has_property,
+                       less_than_or_equal_to )
 ycm_core = ImportCore()
+import json
 import os
 
 
@@ -54,6 +58,54 @@ def CppBindings_FilterAndSortCandidates_test():
   assert_that( result_2, contains_exactly( 'foo1', 'foo2' ) )
 
 
+def CppBindings_FilterAndSortCandidates_QueryOptions_test():
+  candidates = [ 'oo', 'foo', 'fooo', 'foooo' ]
+  options = ycm_core.QueryOptions()
+  options.min_candidate_chars = 3
+  options.max_candidate_chars = 4
+  options.exclude_query = True
+
+  result = ycm_core.FilterAndSortCandidates( candidates, '', 'foo', 1, options )
+  assert_that( result, contains_exactly( 'fooo' ) )
+
+  filter_session = ycm_core.FilterSession( candidates, '' )
+  result = filter_session.FilterAndSortCandidates( 'oo', 0, options )
+  assert_that( result, contains_exactly( 'foo', 'fooo' ) )
+
+
+def CppBindings_FilterAndSortCandidatesWithMatchPositions_test():
+  candidates = [ { 'word': 'fooBar' }, { 'word': 'fòòbár' }, { 'word': 'x' } ]
+
+  result = ycm_core.FilterAndSortCandidatesWithMatchPositions( candidates,
+                                                               'word',
+                                                               'fob' )
+
+  assert_that( result, contains_exactly(
+    contains_exactly( { 'word': 'fooBar' }, has_properties( {
+      'byte_offsets': [ 0, 1, 3 ],
+      'code_point_offsets': [ 0, 1, 3 ] } ) ),
+    contains_exactly( { 'word': 'fòòbár' }, has_properties( {
+      'byte_offsets': [ 0, 1, 5 ],
+      'code_point_offsets': [ 0, 1, 3 ] } ) ) ) )
+
+
+def CppBindings_FilterSession_test():
+  candidates = [ { 'word': 'foo1' }, { 'word': 'foo2' }, { 'word': 'bar' } ]
+  filter_session = ycm_core.FilterSession( candidates, 'word' )
+
+  # The session is not affected by changes to the original list.
+  candidates.append( { 'word': 'foo3' } )
+  del candidates
+
+  assert_that( len( filter_session ), equal_to( 3 ) )
+  assert_that( filter_session.FilterAndSortCandidates( 'oo' ),
+               contains_exactly( { 'word': 'foo1' }, { 'word': 'foo2' } ) )
+  assert_that( filter_session.FilterAndSortCandidates( 'oo', 1 ),
+               contains_exactly( { 'word': 'foo1' } ) )
+  assert_that( filter_session.FilterAndSortCandidates( 'ar' ),
+               contains_exactly( { 'word': 'bar' } ) )
+
+
 def CppBindings_IdentifierCompleter_test():
   identifier_completer = ycm_core.IdentifierCompleter()
   identifiers = ycm_core.StringVector()
@@ -78,6 +130,165 @@ def CppBindings_IdentifierCompleter_test():
   query_a_10 = identifier_completer.CandidatesForQueryAndType( 'a', 'foo' )
   assert_that( query_a_10, contains_exactly( 'rab', 'zab' ) )
 
+  query_a_json = identifier_completer.CompletionsJsonForQueryAndType(
+    'a', 'foo', 10, 0, '[ID]' )
+  assert_that( json.loads( query_a_json ), contains_exactly(
+    { 'insertion_text': 'rab', 'extra_menu_info': '[ID]' },
+    { 'insertion_text': 'zab', 'extra_menu_info': '[ID]' } ) )
+
+  query_a_deadline, is_complete = (
+    identifier_completer.CandidatesForQueryAndTypeWithDeadline(
+      'a', 'foo', 'file', 10, 1000 ) )
+  assert_that( query_a_deadline, contains_exactly( 'rab', 'zab' ) )
+  assert_that( is_complete, equal_to( True ) )
+
+  query_a_positions = (
+    identifier_completer.CandidatesWithMatchPositionsForQueryAndType(
+      'a', 'foo' ) )
+  assert_that( query_a_positions, contains_exactly(
+    contains_exactly( 'rab', has_properties( {
+      'byte_offsets': [ 1 ], 'code_point_offsets': [ 1 ] } ) ),
+    contains_exactly( 'zab', has_properties( {
+      'byte_offsets': [ 1 ], 'code_point_offsets': [ 1 ] } ) ) ) )
+
+  filepaths = ycm_core.StringVector()
+  filepaths.append( 'file' )
+  query_a_in_paths = identifier_completer.CandidatesForQueryAndTypeInPaths(
+    'a', 'foo', filepaths )
+  assert_that( query_a_in_paths, contains_exactly( 'rab', 'zab' ) )
+  query_a_in_prefix = identifier_completer.CandidatesForQueryAndTypeInPaths(
+    'a', 'foo', ycm_core.StringVector(), 'other' )
+  assert_that( query_a_in_prefix, empty() )
+
+
+def CppBindings_IdentifierCompleterSnapshot_test():
+  identifier_completer = ycm_core.IdentifierCompleter()
+  identifiers = ycm_core.StringVector()
+  identifiers.append( 'foo' )
+  identifiers.append( 'fòô' )
+  identifier_completer.AddIdentifiersToDatabase( identifiers, 'c', 'file' )
+  identifiers = ycm_core.StringVector()
+  identifiers.append( 'bar' )
+  identifier_completer.AddIdentifiersToDatabase( identifiers, 'python', 'py' )
+
+  with TemporaryTestDir() as tmp_dir:
+    snapshot = os.path.join( tmp_dir, 'identifiers.snapshot' )
+    assert_that( identifier_completer.SaveSnapshot( snapshot ),
+                 equal_to( True ) )
+    del identifier_completer
+
+    identifier_completer = ycm_core.IdentifierCompleter()
+    assert_that( identifier_completer.LoadSnapshot( snapshot ),
+                 equal_to( True ) )
+
+  assert_that( identifier_completer.CandidatesForQueryAndType( 'fo', 'c' ),
+               contains_inanyorder( 'foo', 'fòô' ) )
+  assert_that( identifier_completer.CandidatesForQueryAndType( 'ba', 'python' ),
+               contains_exactly( 'bar' ) )
+  assert_that( identifier_completer.CandidatesForQueryAndType( 'ba', 'c' ),
+               empty() )
+  assert_that( identifier_completer.LoadSnapshot( 'missing.snapshot' ),
+               equal_to( False ) )
+
+
+def CppBindings_CompletionsToJson_test():
+  class Kind:
+    def __init__( self ):
+      self.name = 'FUNCTION'
+
+  completions = [
+    { 'insertion_text': 'fòô', 'extra_data': { 'kind': Kind() } },
+    { 'insertion_text': 'bar', 'menu_text': None }
+  ]
+  assert_that( json.loads( ycm_core.CompletionsToJson( completions ) ),
+               contains_exactly(
+                 { 'insertion_text': 'fòô',
+                   'extra_data': { 'kind': { 'name': 'FUNCTION',
+                                             'TYPE': 'Kind' } } },
+                 { 'insertion_text': 'bar', 'menu_text': None } ) )
+
+
+def CppBindings_LoneSurrogates_test():
+  # Such strings can't be encoded to UTF-8. The json module escapes them.
+  completions = [ { 'insertion_text': 'fo\udc80o', 'menu_text': '\ud800"' } ]
+  expected = json.dumps( completions, separators = ( ',', ':' ) )
+  assert_that( ycm_core.CompletionsToJson( completions ), equal_to( expected ) )
+
+  assert_that( ycm_core.FilterAndSortCandidates( [ 'fo\udc80o', 'bar' ],
+                                                 '',
+                                                 'fo' ),
+               contains_exactly( 'fo\udc80o' ) )
+
+
+def CppBindings_QueryStatistics_test():
+  ycm_core.FilterAndSortCandidates( [ 'foo', 'bar' ], '', 'fo' )
+
+  statistics = ycm_core.RecentQueryStatistics()[ -1 ]
+  assert_that( statistics, has_properties( {
+    'source': 'filter',
+    'query': 'fo',
+    'num_queries': 1,
+    'num_visited_candidates': 2,
+    'num_prefilter_rejections': 1,
+    'num_subsequence_failures': 0,
+    'num_matches': 1
+  } ) )
+  assert_that( ycm_core.TotalQueryStatistics(),
+               has_properties( { 'source': 'total' } ) )
+
+
+def CppBindings_LatencySnapshots_test():
+  ycm_core.ResetLatencyHistograms()
+  for _ in range( 10 ):
+    ycm_core.FilterAndSortCandidates( [ 'foo', 'bar' ], '', 'fo' )
+
+  snapshots = { snapshot.name: snapshot
+                for snapshot in ycm_core.LatencySnapshots() }
+  snapshot = snapshots[ 'FilterAndSortCandidates' ]
+  assert_that( snapshot.count, equal_to( 10 ) )
+  assert_that( snapshot.p50_ns, less_than_or_equal_to( snapshot.p99_ns ) )
+  assert_that( snapshot.p99_ns, less_than_or_equal_to( snapshot.max_ns ) )
+
+  ycm_core.ResetLatencyHistograms()
+  ycm_core.FilterAndSortCandidatesWithMatchPositions( [ 'foo', 'bar' ],
+                                                      '',
+                                                      'fo' )
+  filter_session = ycm_core.FilterSession( [ 'foo', 'bar' ], '' )
+  filter_session.FilterAndSortCandidates( 'f' )
+  filter_session.FilterAndSortCandidates( 'fo' )
+  identifier_completer = ycm_core.IdentifierCompleter()
+  identifier_completer.CompletionsJsonForQueryAndType( 'fo', '', 0, 0, '' )
+
+  snapshots = { snapshot.name: snapshot
+                for snapshot in ycm_core.LatencySnapshots() }
+  assert_that( snapshots, has_entries( {
+    'FilterAndSortCandidates': has_property( 'count', 0 ),
+    'FilterAndSortCandidatesWithMatchPositions': has_property( 'count', 1 ),
+    'FilterSession::FilterAndSortCandidates': has_property( 'count', 2 ),
+    'IdentifierCompleter::CompletionsJsonForQueryAndType':
+      has_property( 'count', 1 )
+  } ) )
+
+  ycm_core.ResetLatencyHistograms()
+  snapshots = { snapshot.name: snapshot
+                for snapshot in ycm_core.LatencySnapshots() }
+  assert_that( snapshots[ 'FilterAndSortCandidates' ].count, equal_to( 0 ) )
+
+
+def CppBindings_ThreadPool_test():
+  ycm_core.SetThreadPoolSize( 2 )
+  identifier_completer = ycm_core.IdentifierCompleter()
+  identifiers = ycm_core.StringVector()
+  for i in range( 5000 ):
+    identifiers.append( f'pool{ i }' )
+  identifier_completer.AddIdentifiersToDatabase( identifiers, 'c', 'file' )
+  ycm_core.ShutdownThreadPool()
+  ycm_core.SetThreadPoolSize( 0 )
+
+  assert_that( identifier_completer.CandidatesForQueryAndType( 'pool4999',
+                                                               'c' ),
+               contains_exactly( 'pool4999' ) )
+
 
 @ClangOnly
 def CppBindings_UnsavedFile_test():
@@ -248,6 +459,59 @@ def CppBindings_Candidates_test():
                            ) )
 
 
+@ClangOnly
+def CppBindings_FilteredCandidates_test():
+  translation_unit = PathToTestFile( 'foo.c' )
+  filename = PathToTestFile( 'foo.c' )
+  line = 11
+  column = 6
+  unsaved_file_vector = ycm_core.UnsavedFileVector()
+  flags = ycm_core.StringVector()
+  flags.append( '-xc' )
+  clang_completer = ycm_core.ClangCompleter()
+
+  candidates, num_completions = (
+    clang_completer.FilteredCandidatesForLocationInFile( translation_unit,
+                                                         filename,
+                                                         line,
+                                                         column,
+                                                         unsaved_file_vector,
+                                                         flags,
+                                                         'b',
+                                                         10 ) )
+  # Filtering again at the same location uses the cached completions.
+  all_candidates, _ = (
+    clang_completer.FilteredCandidatesForLocationInFile( translation_unit,
+                                                         filename,
+                                                         line,
+                                                         column,
+                                                         unsaved_file_vector,
+                                                         flags,
+                                                         '',
+                                                         0 ) )
+
+  del translation_unit
+  del filename
+  del line
+  del column
+  del unsaved_file_vector
+  del flags
+  del clang_completer
+  assert_that( num_completions, equal_to( 2 ) )
+  candidates = [ ConvertCompletionData( x ) for x in candidates ]
+  assert_that( candidates, contains_exactly(
+                             has_entries( {
+                               'detailed_info': 'float b\n',
+                               'extra_menu_info': 'float',
+                               'insertion_text': 'b',
+                               'kind': 'MEMBER',
+                               'menu_text': 'b'
+                             } )
+                           ) )
+  assert_that( [ x.TextToInsertInBuffer() for x in all_candidates ],
+               contains_exactly( 'a', 'b' ) )
+
+
 @ClangOnly
 def CppBindings_GetType_test():
   translation_unit = PathToTestFile( 'foo.c' )
@@ -50,5 +50,5 @@ class MockCoreClangCompleter:
   def GetFixItsForLocationInFile( self, *args ):
     pass
 
-  def UpdatingTranslationUnit( self, filename ):
+  def UpdatingTranslationUnit( self, filename, timeout_ms = 0 ):
     return True
@@ -15,6 +15,7 @@
 # You should have received a copy of the GNU General Public License
 # along with ycmd.  If not, see <http://www.gnu.org/licenses/>.
 
+from ycmd.completers import completer_utils
 from ycmd.tests.test_utils import DummyCompleter
 from ycmd.user_options_store import DefaultOptions
 from unittest.mock import patch
@@ -69,6 +70,24 @@ def FilterAndSortCandidates_Unicode_test():
                                   [ { 'insertion_text': 'ø' } ] )
 
 
+def FilterAndSortCandidates_ReuseFilterSession_test():
+  completer = DummyCompleter( DefaultOptions() )
+  candidates = [ 'foo', 'bar', 'baz' ]
+  with patch( 'ycmd.completers.completer_utils.FilterSessionWrap',
+              wraps = completer_utils.FilterSessionWrap ) as session_wrap:
+    assert_that( completer.FilterAndSortCandidates( candidates, 'b' ),
+                 equal_to( [ 'bar', 'baz' ] ) )
+    assert_that( completer.FilterAndSortCandidates( candidates, 'ba' ),
+                 equal_to( [ 'bar', 'baz' ] ) )
+    assert_that( completer.FilterAndSortCandidates( candidates, 'f' ),
+                 equal_to( [ 'foo' ] ) )
+    assert_that( session_wrap.call_count, equal_to( 1 ) )
+
+    assert_that( completer.FilterAndSortCandidates( [ 'foo' ], 'f' ),
+                 equal_to( [ 'foo' ] ) )
+    assert_that( session_wrap.call_count, equal_to( 2 ) )
+
+
 @patch( 'ycmd.tests.test_utils.DummyCompleter.GetSubcommandsMap',
         return_value = { 'Foo': '', 'StopServer': '' } )
 def DefinedSubcommands_RemoveStopServerSubcommand_test( subcommands_map ):
@@ -22,7 +22,8 @@ from ycmd.completers.all import identifier_completer as ic
 from ycmd.completers.all.identifier_completer import IdentifierCompleter
 from ycmd.request_wrap import RequestWrap
 from ycmd.tests import PathToTestFile
-from ycmd.tests.test_utils import BuildRequest
+from ycmd.tests.test_utils import BuildRequest, TemporaryTestDir
+from ycmd.utils import UserDataDirectory
 
 
 def BuildRequestWrap( contents, column_num, line_num = 1 ):
@@ -304,6 +305,38 @@ def FilterUnchangedTagFiles_SkipUnchangesFiles_test():
                empty() )
 
 
+def Snapshot_SavedOnShutdownAndLoadedOnStartup_test():
+  with TemporaryTestDir() as tmp_dir:
+    options = DefaultOptions()
+    options[ 'identifier_snapshots' ] = 1
+    options[ 'identifier_snapshot_file' ] = os.path.join( tmp_dir,
+                                                          'sub',
+                                                          'identifiers' )
+    ident_completer = IdentifierCompleter( options )
+    ident_completer._AddBufferIdentifiers(
+      RequestWrap( BuildRequest( contents = 'foobar foobaz',
+                                 filetype = 'cpp' ) ) )
+    ident_completer.Shutdown()
+    assert_that( os.path.isfile( options[ 'identifier_snapshot_file' ] ) )
+
+    ident_completer = IdentifierCompleter( options )
+    assert_that( ident_completer._completer.CandidatesForQueryAndType(
+                   'fooba', 'cpp' ),
+                 contains_exactly( 'foobar', 'foobaz' ) )
+
+
+def Snapshot_Disabled_test():
+  assert_that( ic._SnapshotPath( DefaultOptions() ), equal_to( None ) )
+
+
+def Snapshot_DefaultPath_test():
+  options = DefaultOptions()
+  options[ 'identifier_snapshots' ] = 1
+  assert_that( ic._SnapshotPath( options ),
+               equal_to( os.path.join( UserDataDirectory(),
+                                       'identifiers.snapshot' ) ) )
+
+
 def Dummy_test():
   # Workaround for https://github.com/pytest-dev/pytest-rerunfailures/issues/51
   assert True
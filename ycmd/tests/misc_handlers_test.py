@@ -189,6 +189,15 @@ def MiscHandlers_DebugInfo_NoExtraConfFound_test( app ):
         'path': None,
         'is_loaded': False
       } ),
+      'query_statistics': has_entries( {
+        'total': has_entries( {
+          'source': 'total',
+          'num_queries': instance_of( int ),
+          'matching_ns': instance_of( int )
+        } ),
+        'recent': instance_of( list )
+      } ),
+      'latencies': instance_of( dict ),
       'completer': None
     } )
   )
@@ -290,6 +290,20 @@ def ExpandVariablesInPath( path ):
   return os.path.expanduser( os.path.expandvars( path ) )
 
 
+def UserDataDirectory():
+  """Returns the directory where ycmd keeps the data that should persist across
+  restarts, e.g. ~/.local/share/ycmd on Linux. It may not exist yet."""
+  if OnWindows():
+    base = os.environ.get( 'LOCALAPPDATA',
+                           os.path.join( '~', 'AppData', 'Local' ) )
+  elif OnMac():
+    base = os.path.join( '~', 'Library', 'Application Support' )
+  else:
+    base = os.environ.get( 'XDG_DATA_HOME',
+                           os.path.join( '~', '.local', 'share' ) )
+  return os.path.join( os.path.expanduser( base ), 'ycmd' )
+
+
 def OnWindows():
   return sys.platform == 'win32'
 